@@ -43,6 +43,41 @@ Options:\n\
     -v              Display the version of wallet\n";
 
 
+/* The client options, in the form expected by getopt. */
+static const char options_string[] = "c:f:k:hp:S:s:u:v";
+
+
+/*
+ * Return the number of elements of argv, including the program name, that
+ * hold client options and their arguments.  Only these are given to getopt so
+ * that options after the command, such as --archive for history, are passed
+ * to the server.  Some getopt implementations would otherwise reorder the
+ * arguments and reject those options as unknown.
+ */
+static int
+options_end(int argc, char *argv[])
+{
+    int i;
+    const char *p, *option;
+
+    for (i = 1; i < argc; i++) {
+        if (argv[i][0] != '-' || argv[i][1] == '\0')
+            break;
+        if (strcmp(argv[i], "--") == 0)
+            return i + 1;
+        for (p = argv[i] + 1; *p != '\0'; p++) {
+            option = strchr(options_string, *p);
+            if (option != NULL && *p != ':' && option[1] == ':') {
+                if (p[1] == '\0')
+                    i++;
+                break;
+            }
+        }
+    }
+    return (i < argc) ? i : argc;
+}
+
+
 /*
  * Display the usage message for wallet.
  */
@@ -72,6 +107,7 @@ main(int argc, char *argv[])
     struct remctl *r;
     long tmp;
     char *end;
+    int options_count;
 
     /* Set up logging and identity. */
     message_program_name = "wallet";
@@ -83,7 +119,9 @@ main(int argc, char *argv[])
         die_krb5(ctx, retval, "cannot initialize Kerberos");
     default_options(ctx, &options);
 
-    while ((option = getopt(argc, argv, "c:f:k:hp:S:s:u:v")) != EOF) {
+    /* Stop at the command so that server options are passed through. */
+    options_count = options_end(argc, argv);
+    while ((option = getopt(options_count, argv, options_string)) != EOF) {
         switch (option) {
         case 'c':
             options.type = optarg;
@@ -17,7 +17,9 @@ use 5.008;
 use strict;
 use warnings;
 
-use DateTime;
+use Wallet::Cache;
+use Wallet::Config;
+use Wallet::History;
 use Wallet::Object::Base;
 
 our $VERSION = '1.05';
@@ -29,28 +31,37 @@ our $VERSION = '1.05';
 # Initialize a new ACL from the database.  Verify that the ACL already exists
 # in the database and, if so, return a new blessed object.  Stores the ACL ID
 # and the database handle to use for future operations.  If the object
-# doesn't exist, throws an exception.
+# doesn't exist, throws an exception.  If the caller has already loaded the
+# ACL, it can pass a reference to a hash with its id and name as the third
+# argument and the database lookup is skipped.  If that hash also has members,
+# the complete list of entries, list uses it rather than the database.
 sub new {
-    my ($class, $id, $schema) = @_;
-    my (%search, $data, $name);
-    if ($id =~ /^\d+\z/) {
-        $search{ac_id} = $id;
-    } else {
-        $search{ac_name} = $id;
-    }
-    eval {
-        $data = $schema->resultset('Acl')->find (\%search);
-    };
-    if ($@) {
-        die "cannot search for ACL $id: $@\n";
-    } elsif (not defined $data) {
-        die "ACL $id not found\n";
+    my ($class, $id, $schema, $loaded) = @_;
+    unless ($loaded) {
+        my (%search, $data);
+        if ($id =~ /^\d+\z/) {
+            $search{ac_id} = $id;
+        } else {
+            $search{ac_name} = $id;
+        }
+        eval {
+            $data = $schema->resultset('Acl')->find (\%search);
+        };
+        if ($@) {
+            die "cannot search for ACL $id: $@\n";
+        } elsif (not defined $data) {
+            die "ACL $id not found\n";
+        }
+        $loaded = { id => $data->ac_id, name => $data->ac_name };
     }
     my $self = {
         schema  => $schema,
-        id      => $data->ac_id,
-        name    => $data->ac_name,
+        id      => $loaded->{id},
+        name    => $loaded->{name},
     };
+    if ($loaded->{members}) {
+        $self->{members} = [ map { [ @$_ ] } @{ $loaded->{members} } ];
+    }
     bless ($self, $class);
     return $self;
 }
@@ -65,7 +76,7 @@ sub create {
     }
     $time ||= time;
     my $id;
-    eval {
+    my $code = sub {
         my $guard = $schema->txn_scope_guard;
 
         # Create the new record.
@@ -75,7 +86,7 @@ sub create {
         die "unable to retrieve new ACL ID" unless defined $id;
 
         # Add to the history table.
-        my $date = DateTime->from_epoch (epoch => $time);
+        my $date = Wallet::History->date ($time);
         %record = (ah_acl    => $id,
                    ah_name   => $name,
                    ah_action => 'create',
@@ -84,8 +95,14 @@ sub create {
                    ah_on     => $date);
         my $history = $schema->resultset('AclHistory')->create (\%record);
         die "unable to create new history entry" unless defined $history;
+
+        # The ADMIN ACL is cached by server processes.
+        if ($name eq 'ADMIN') {
+            Wallet::Cache->invalidate ($schema);
+        }
         $guard->commit;
     };
+    eval { $schema->txn_retry ($code) };
     if ($@) {
         die "cannot create ACL $name: $@\n";
     }
@@ -126,17 +143,12 @@ sub name {
     return $self->{name};
 }
 
-# Given an ACL scheme, return the mapping to a class by querying the
-# database, or undef if no mapping exists.  Also load the relevant module.
+# Given an ACL scheme, return the mapping to a class from the metadata
+# cache, or undef if no mapping exists.  Also load the relevant module.
 sub scheme_mapping {
     my ($self, $scheme) = @_;
     my $class;
-    eval {
-        my %search = (as_name => $scheme);
-        my $scheme_rec = $self->{schema}->resultset('AclScheme')
-            ->find (\%search);
-        $class = $scheme_rec->as_class;
-    };
+    eval { $class = Wallet::Cache->scheme_class ($self->{schema}, $scheme) };
     if ($@) {
         $self->error ($@);
         return;
@@ -161,7 +173,7 @@ sub log_acl {
     unless ($action =~ /^(add|remove|rename)\z/) {
         die "invalid history action $action";
     }
-    my $date = DateTime->from_epoch (epoch => $time);
+    my $date = Wallet::History->date ($time);
     my %record = (ah_acl        => $self->{id},
                   ah_name       => $self->{name},
                   ah_action     => $action,
@@ -187,7 +199,7 @@ sub rename {
         $self->error ("ACL name may not be all numbers");
         return;
     }
-    eval {
+    my $code = sub {
         my $guard = $self->{schema}->txn_scope_guard;
         my %search = (ac_id => $self->{id});
         my $acls = $self->{schema}->resultset('Acl')->find (\%search);
@@ -207,8 +219,13 @@ sub rename {
             $entry->update;
         }
 
+        # The ADMIN ACL is cached by server processes.
+        if ($self->{name} eq 'ADMIN' or $name eq 'ADMIN') {
+            Wallet::Cache->invalidate ($self->{schema});
+        }
         $guard->commit;
     };
+    eval { $self->{schema}->txn_retry ($code) };
     if ($@) {
         $self->error ("cannot rename ACL $self->{name} to $name: $@");
         return;
@@ -253,7 +270,7 @@ sub replace {
 sub destroy {
     my ($self, $user, $host, $time) = @_;
     $time ||= time;
-    eval {
+    my $code = sub {
         my $guard = $self->{schema}->txn_scope_guard;
 
         # Make certain no one is using the ACL.
@@ -294,7 +311,7 @@ sub destroy {
         $entry->delete if defined $entry;
 
         # Create new history line for the deletion.
-        my $date = DateTime->from_epoch (epoch => $time);
+        my $date = Wallet::History->date ($time);
         my %record = (ah_acl    => $self->{id},
                       ah_name   => $self->{name},
                       ah_action => 'destroy',
@@ -302,8 +319,12 @@ sub destroy {
                       ah_from   => $host,
                       ah_on     => $date);
         $self->{schema}->resultset('AclHistory')->create (\%record);
+        if ($self->{name} eq 'ADMIN') {
+            Wallet::Cache->invalidate ($self->{schema});
+        }
         $guard->commit;
     };
+    eval { $self->{schema}->txn_retry ($code) };
     if ($@) {
         $self->error ("cannot destroy ACL $self->{name}: $@");
         return;
@@ -339,7 +360,7 @@ sub add {
     };
 
     # Actually create the scheme.
-    eval {
+    my $code = sub {
         my $guard = $self->{schema}->txn_scope_guard;
         my %record = (ae_id         => $self->{id},
                       ae_scheme     => $scheme,
@@ -348,10 +369,12 @@ sub add {
         $self->log_acl ('add', $scheme, $identifier, $user, $host, $time);
         $guard->commit;
     };
+    eval { $self->{schema}->txn_retry ($code) };
     if ($@) {
         $self->error ("cannot add $scheme:$identifier to $self->{name}: $@");
         return;
     }
+    delete $self->{members};
     return 1;
 }
 
@@ -361,7 +384,7 @@ sub add {
 sub remove {
     my ($self, $scheme, $identifier, $user, $host, $time) = @_;
     $time ||= time;
-    eval {
+    my $code = sub {
         my $guard = $self->{schema}->txn_scope_guard;
         my %search = (ae_id         => $self->{id},
                       ae_scheme     => $scheme,
@@ -374,11 +397,13 @@ sub remove {
         $self->log_acl ('remove', $scheme, $identifier, $user, $host, $time);
         $guard->commit;
     };
+    eval { $self->{schema}->txn_retry ($code) };
     if ($@) {
         my $entry = "$scheme:$identifier";
         $self->error ("cannot remove $entry from $self->{name}: $@");
         return;
     }
+    delete $self->{members};
     return 1;
 }
 
@@ -388,10 +413,14 @@ sub remove {
 
 # List all of the entries in an ACL.  Returns an array of tuples, each of
 # which contains a scheme and identifier, or an array containing undef on
-# error.  Sets the internal error string on error.
+# error.  Sets the internal error string on error.  Uses the entries loaded
+# with the ACL if there are any.
 sub list {
     my ($self) = @_;
     undef $self->{error};
+    if ($self->{members}) {
+        return map { [ @$_ ] } @{ $self->{members} };
+    }
     my @entries;
     eval {
         my $guard = $self->{schema}->txn_scope_guard;
@@ -431,32 +460,53 @@ sub show {
     return $output;
 }
 
-# Return as a string the history of an ACL.  Returns undef on failure.
+# Return as a string the history of an ACL.  Takes an optional reference to
+# a hash of options.  If the archive option is set, history moved to the
+# archive by wallet-admin history archive is included.  The since, until, and
+# limit options are handled by Wallet::History.  Returns undef on failure.
 sub history {
-    my ($self) = @_;
+    my ($self, $options) = @_;
+    $options ||= {};
     my $output = '';
     eval {
-        my $guard = $self->{schema}->txn_scope_guard;
+        my $history = Wallet::History->new ($self->{schema}, $options);
         my %search  = (ah_acl => $self->{id});
-        my %options = (order_by => { -asc => [qw/ah_on ah_id/] });
-        my @data = $self->{schema}->resultset('AclHistory')
-            ->search (\%search, \%options);
-        for my $data (@data) {
-            my $date = $data->ah_on;
+        my $add = sub {
+            my ($data) = @_;
+            my $date = $data->{ah_on};
             $date->set_time_zone ('local');
             $output .= sprintf ("%s %s  ", $date->ymd, $date->hms);
-            if ($data->ah_action eq 'add' || $data->ah_action eq 'remove') {
-                $output .= sprintf ("%s %s %s", $data->ah_action,
-                                    $data->ah_scheme, $data->ah_identifier);
-            } elsif ($data->ah_action eq 'rename') {
-                $output .= 'rename from ' . $data->ah_name;
+            my $action = $data->{ah_action};
+            if ($action eq 'add' || $action eq 'remove') {
+                $output .= sprintf ("%s %s %s", $action, $data->{ah_scheme},
+                                    $data->{ah_identifier});
+            } elsif ($action eq 'rename') {
+                $output .= 'rename from ' . $data->{ah_name};
             } else {
-                $output .= $data->ah_action;
+                $output .= $action;
+            }
+            $output .= sprintf ("\n    by %s from %s\n", $data->{ah_by},
+                                $data->{ah_from});
+            return $history->add;
+        };
+        if ($options->{archive}) {
+            my $dir = $Wallet::Config::HISTORY_ARCHIVE_DIR;
+            die "history archive not configured\n" unless $dir;
+            require Wallet::Archive;
+            my $archive = Wallet::Archive->new ($dir);
+            my @archived = $archive->rows ('acl_history', \%search,
+                                           $history->range);
+            for my $data (@archived) {
+                next unless $history->in_range ($data->{ah_on}->epoch);
+                last unless $add->($data);
             }
-            $output .= sprintf ("\n    by %s from %s\n", $data->ah_by,
-                                $data->ah_from);
         }
-        $guard->commit;
+        if ($history->more) {
+            my $guard = $self->{schema}->txn_scope_guard;
+            $history->search ('AclHistory', 'ah_on', \%search,
+                              [qw/ah_on ah_id/], $add);
+            $guard->commit;
+        }
     };
     if ($@) {
         $self->error ("cannot read history for $self->{name}: $@");
@@ -465,18 +515,17 @@ sub history {
     return $output;
 }
 
-# Given a principal, a scheme, and an identifier, check whether that ACL
-# scheme and identifier grant access to that principal.  Return 1 if access
-# was granted, 0 if access was deined, and undef on some error.  On error, the
-# error message is also added to the check_errors variable.  This method is
+# Given a scheme and an identifier, return the ACL verifier for that scheme,
+# creating it if necessary.  Returns undef if no verifier could be created,
+# adding the error message to the check_errors variable.  This method is
 # internal to the class.
 #
 # Maintain ACL verifiers for all schemes we've seen in the local %verifier
 # hash so that we can optimize repeated ACL checks.
 {
     my %verifier;
-    sub check_line {
-        my ($self, $principal, $scheme, $identifier, $type, $name) = @_;
+    sub verifier {
+        my ($self, $scheme, $identifier) = @_;
         unless ($verifier{$scheme}) {
             my $class = $self->scheme_mapping ($scheme);
             unless ($class) {
@@ -489,38 +538,132 @@ sub history {
                 return;
             }
         }
-        my $result = ($verifier{$scheme})->check ($principal, $identifier,
-                                                  $type, $name);
-        if (not defined $result) {
-            push (@{ $self->{check_errors} }, ($verifier{$scheme})->error);
-            return;
-        } else {
-            return $result;
-        }
+        return $verifier{$scheme};
     }
 }
 
+# Given a principal, a scheme, and an identifier, check whether that ACL
+# scheme and identifier grant access to that principal.  Return 1 if access
+# was granted, 0 if access was deined, and undef on some error.  On error, the
+# error message is also added to the check_errors variable.  This method is
+# internal to the class.
+sub check_line {
+    my ($self, $principal, $scheme, $identifier, $type, $name) = @_;
+    my $verifier = $self->verifier ($scheme, $identifier);
+    return unless $verifier;
+    my $result = $verifier->check ($principal, $identifier, $type, $name);
+    if (not defined $result) {
+        push (@{ $self->{check_errors} }, $verifier->error);
+        return;
+    } else {
+        return $result;
+    }
+}
+
+# Given a principal, check whether this ACL contains a krb5 entry for exactly
+# that principal.  This is a single lookup on the acl_entries primary key, so
+# its cost doesn't depend on the size of the ACL.  Databases that compare
+# case-insensitively may return an entry for a principal differing only in
+# case, so the identifier is compared again.  Returns 1 if such an entry
+# exists, 0 if it doesn't, and undef on error.
+sub check_krb5 {
+    my ($self, $principal) = @_;
+    my $entry;
+    eval {
+        my %search = (ae_id         => $self->{id},
+                      ae_scheme     => 'krb5',
+                      ae_identifier => $principal);
+        $entry = $self->{schema}->resultset('AclEntry')->find (\%search);
+    };
+    if ($@) {
+        $self->error ("cannot check ACL $self->{name}: $@");
+        return;
+    }
+    return 0 unless defined $entry;
+    return ($entry->ae_identifier eq $principal) ? 1 : 0;
+}
+
 # Given a principal, object type, and object name, check whether that
 # principal should be granted access according to this ACL.  Returns 1 if
 # access was granted, 0 if access was denied, and undef on some error.  Errors
 # from ACL verifiers do not cause an error return, but are instead accumulated
 # in the check_errors variable returned by the check_errors() method.
+#
+# Most access is granted by a plain krb5 entry, so look for that directly
+# first.  If it isn't there, no other non-empty krb5 entry can match, so only
+# load and evaluate the remaining entries.  Empty krb5 entries are still
+# evaluated so that they're reported as malformed.
+#
+# If the caller has already loaded the entries that could match, as done by
+# Wallet::Query, it can pass them as a reference to an array of scheme and
+# identifier pairs and no database queries are made.
 sub check {
-    my ($self, $principal, $type, $name) = @_;
+    my ($self, $principal, $type, $name, $loaded) = @_;
+    undef $self->{error};
     unless ($principal) {
         $self->error ('no principal specified');
         return;
     }
-    my @entries = $self->list;
-    return if (not @entries and $self->error);
-    my %verifier;
     $self->{check_errors} = [];
+    my @entries;
+    if ($loaded) {
+        for my $entry (@$loaded) {
+            my ($scheme, $identifier) = @$entry;
+            if ($scheme eq 'krb5' and $identifier ne '') {
+                return 1 if $identifier eq $principal;
+                next;
+            }
+            push (@entries, $entry);
+        }
+    } else {
+        my $direct = $self->check_krb5 ($principal);
+        return unless defined $direct;
+        return 1 if $direct;
+        eval {
+            my %search = (ae_id => $self->{id},
+                          -or   => [ ae_scheme     => { '!=' => 'krb5' },
+                                     ae_identifier => '' ]);
+            my @entry_recs = $self->{schema}->resultset('AclEntry')
+                ->search (\%search);
+            for my $entry (@entry_recs) {
+                push (@entries, [ $entry->ae_scheme, $entry->ae_identifier ]);
+            }
+        };
+        if ($@) {
+            $self->error ("cannot retrieve ACL $self->{name}: $@");
+            return;
+        }
+    }
+
+    # Verifiers that provide check_multiple get all of the identifiers for
+    # their scheme at once so that they can check them with a single query.
+    my (@single, %multiple);
     for my $entry (@entries) {
+        my ($scheme, $identifier) = @$entry;
+        my $verifier = $self->verifier ($scheme, $identifier);
+        next unless $verifier;
+        if ($verifier->can ('check_multiple')) {
+            push (@{ $multiple{$scheme} }, $identifier);
+        } else {
+            push (@single, $entry);
+        }
+    }
+    for my $entry (@single) {
         my ($scheme, $identifier) = @$entry;
         my $result = $self->check_line ($principal, $scheme, $identifier,
                                         $type, $name);
         return 1 if $result;
     }
+    for my $scheme (sort keys %multiple) {
+        my $verifier = $self->verifier ($scheme);
+        my $result = $verifier->check_multiple ($principal, $multiple{$scheme},
+                                                $type, $name);
+        if (not defined $result) {
+            push (@{ $self->{check_errors} }, $verifier->error);
+        } elsif ($result) {
+            return 1;
+        }
+    }
     return 0;
 }
 
@@ -589,12 +732,19 @@ references.
 
 =over 4
 
-=item new(ACL, SCHEMA)
+=item new(ACL, SCHEMA [, DATA])
 
 Instantiate a new ACL object with the given ACL ID or name.  Takes the
 Wallet::Schema object to use for retrieving metadata from the wallet
 database.  Returns a new ACL object if the ACL was found and throws an
-exception if it wasn't or on any other error.
+exception if it wasn't or on any other error.  If DATA is given, it must
+be a reference to a hash with keys C<id> and C<name> for an ACL that the
+caller has already loaded, such as one returned by the acl() method of
+Wallet::Query, and the ACL is not looked up in the database.  If DATA
+also has the key C<members>, as returned by the acls() method of
+Wallet::Query, it is taken as the complete list of entries and list() and
+show() use it instead of the database until the entries are changed
+through this object.
 
 =item create(NAME, SCHEMA, PRINCIPAL, HOSTNAME [, DATETIME])
 
@@ -621,7 +771,7 @@ DATETIME are stored as history information.  PRINCIPAL should be the user
 who is adding the ACL entry.  If DATETIME isn't given, the current time is
 used.
 
-=item check(PRINCIPAL)
+=item check(PRINCIPAL [, TYPE, NAME [, ENTRIES]])
 
 Checks whether the given PRINCIPAL should be allowed access given ACL.
 Returns 1 if access was granted, 0 if access is declined, and undef on
@@ -632,7 +782,24 @@ result in an error return from check(); instead, the check will continue
 with the next entry in the ACL.
 
 check() returns success as soon as an entry in the ACL grants access to
-PRINCIPAL.  There is no provision for negative ACLs or exceptions.
+PRINCIPAL.  There is no provision for negative ACLs or exceptions.  A
+C<krb5> entry matching PRINCIPAL exactly is looked up directly before any
+other entries are evaluated, so access through such an entry costs a
+single indexed query however large the ACL is, and no verifier errors are
+collected in that case.
+
+TYPE and NAME, if given, identify the object being accessed and are passed
+to the verifiers.  If ENTRIES is given, it must be a reference to an array
+of the scheme and identifier pairs of this ACL's entries that could grant
+access to PRINCIPAL, as returned in the C<entries> key by the acl() method
+of Wallet::Query.  check() then uses those entries and makes no database
+queries of its own.
+
+=item check_krb5(PRINCIPAL)
+
+Returns 1 if this ACL contains a C<krb5> entry for exactly PRINCIPAL, 0
+if it doesn't, and undef on error.  This is the direct lookup used by
+check() and does not consult any other entries.
 
 =item check_errors()
 
@@ -658,7 +825,7 @@ Returns the error of the last failing operation or undef if no operations
 have failed.  Callers should call this function to get the error message
 after an undef return from any other instance method.
 
-=item history()
+=item history([OPTIONS])
 
 Returns the human-readable history of this ACL.  Each action that changes
 the ACL (not including changes to the name of the ACL) will be represented
@@ -668,6 +835,13 @@ made the change and the host from which the change was made.  On failure,
 returns undef, and the caller should call error() to get the error
 message.
 
+OPTIONS, if given, is a reference to a hash of options.  If the C<archive>
+option is set, history that has been moved to the archive with
+C<wallet-admin history archive> is included before the history in the
+database.  This requires HISTORY_ARCHIVE_DIR to be set.  The C<since>,
+C<until>, and C<limit> options restrict the history to a range of time
+and a maximum number of changes, as described in Wallet::History(3).
+
 =item id()
 
 Returns the numeric system-generated ID of this ACL.
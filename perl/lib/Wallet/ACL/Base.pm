@@ -107,6 +107,16 @@ implementation just declines all access.  TYPE and NAME are the type and
 name of the object being accessed, which may be used by some ACL schemes
 or may be ignored.
 
+=item check_multiple(PRINCIPAL, ACLS, TYPE, NAME)
+
+This method is optional and not provided by Wallet::ACL::Base.  If a
+child class provides it, Wallet::ACL will call it once with a reference to
+an array of all of the identifiers of that scheme in the ACL being checked
+instead of calling check() for each of them.  It should return 1 if any of
+the identifiers in ACLS grant access, 0 if none do, and undef on error.
+Child classes should only provide it if they can check several
+identifiers more cheaply than checking each one in turn.
+
 =item error([ERROR ...])
 
 Returns the error of the last failing operation or undef if no operations
@@ -14,19 +14,141 @@ use 5.008;
 use strict;
 use warnings;
 
-use POSIX qw(_exit);
+use IO::Select;
+use IPC::Open2 qw(open2);
+use POSIX qw(_exit WNOHANG);
+use Time::HiRes qw(sleep time);
 use Wallet::ACL::Base;
 use Wallet::Config;
 
 our @ISA     = qw(Wallet::ACL::Base);
 our $VERSION = '1.05';
 
+##############################################################################
+# Persistent helper
+##############################################################################
+
+# Start the external command as a persistent helper, storing its process ID
+# and file handles in the object.  Returns true on success and false on
+# failure, setting the error.
+sub helper_start {
+    my ($self) = @_;
+    my ($out, $in);
+    my $pid = eval { open2 ($out, $in, $Wallet::Config::EXTERNAL_COMMAND) };
+    if ($@) {
+        $self->error ("cannot run $Wallet::Config::EXTERNAL_COMMAND: $@");
+        return;
+    }
+    $in->autoflush (1);
+    $self->{helper} = {
+        pid    => $pid,
+        in     => $in,
+        out    => $out,
+        buffer => '',
+    };
+    return 1;
+}
+
+# Stop the persistent helper, if any, and reap it.  The helper is sent
+# SIGTERM and, if it hasn't exited after EXTERNAL_TIMEOUT seconds, SIGKILL, so
+# that a helper that ignores SIGTERM can't hang the wallet server.
+sub helper_stop {
+    my ($self) = @_;
+    my $helper = delete $self->{helper};
+    return unless $helper;
+    close $helper->{in};
+    close $helper->{out};
+    my $pid = $helper->{pid};
+    kill ('TERM', $pid);
+    my $deadline = time + ($Wallet::Config::EXTERNAL_TIMEOUT || 10);
+    while (waitpid ($pid, WNOHANG) == 0) {
+        if (time >= $deadline) {
+            kill ('KILL', $pid);
+            waitpid ($pid, 0);
+            last;
+        }
+        sleep (0.1);
+    }
+    return;
+}
+
+# Send one request line to the persistent helper and read one line of
+# response, waiting at most EXTERNAL_TIMEOUT seconds.  Returns the response
+# without the trailing newline.  On failure, stops the helper and returns
+# undef and the reason for the failure, either "exited" or "timed out".
+sub helper_request {
+    my ($self, $request) = @_;
+    my $helper = $self->{helper};
+    my $written = do {
+        local $SIG{PIPE} = 'IGNORE';
+        print { $helper->{in} } $request;
+    };
+    unless ($written) {
+        $self->helper_stop;
+        return (undef, 'exited');
+    }
+    my $select = IO::Select->new ($helper->{out});
+    my $deadline = time + ($Wallet::Config::EXTERNAL_TIMEOUT || 10);
+    while ($helper->{buffer} !~ /\n/) {
+        my $wait = $deadline - time;
+        unless ($wait > 0 and $select->can_read ($wait)) {
+            $self->helper_stop;
+            return (undef, 'timed out');
+        }
+        my $status = sysread ($helper->{out}, $helper->{buffer}, 4096,
+                              length ($helper->{buffer}));
+        unless ($status) {
+            $self->helper_stop;
+            return (undef, 'exited');
+        }
+    }
+    $helper->{buffer} =~ s/^([^\n]*)\n//;
+    return ($1);
+}
+
+# Check access by sending a request to the persistent helper, starting it if
+# needed.  If the helper had exited, restart it and retry the request once.
+# Returns 1 if access was granted, 0 if it was denied, and undef on error.
+sub check_persistent {
+    my ($self, @args) = @_;
+    for my $arg (@args) {
+        $arg = '' unless defined $arg;
+        if ($arg =~ /[\t\n]/) {
+            $self->error ('invalid character in external ACL request');
+            return;
+        }
+    }
+    my $request = join ("\t", @args) . "\n";
+    my ($response, $failure);
+    for my $attempt (1, 2) {
+        unless ($self->{helper}) {
+            return unless $self->helper_start;
+        }
+        ($response, $failure) = $self->helper_request ($request);
+        last if defined $response;
+        last if $failure ne 'exited';
+    }
+    if (not defined $response) {
+        my $command = $Wallet::Config::EXTERNAL_COMMAND;
+        $self->error ("external ACL command $command $failure");
+        return;
+    } elsif ($response eq 'yes') {
+        return 1;
+    } elsif ($response eq 'no') {
+        return 0;
+    } else {
+        $self->error ($response);
+        return;
+    }
+}
+
 ##############################################################################
 # Interface
 ##############################################################################
 
 # Creates a new persistent verifier.  This just checks if the configuration
-# is in place.
+# is in place.  The persistent helper, if configured, is started on the first
+# check.
 sub new {
     my $type = shift;
     unless ($Wallet::Config::EXTERNAL_COMMAND) {
@@ -37,8 +159,8 @@ sub new {
     return $self;
 }
 
-# The most trivial ACL verifier.  Returns true if the provided principal
-# matches the ACL.
+# Run the external command to check the ACL, either by sending a request to
+# the persistent helper or by running the command once for this check.
 sub check {
     my ($self, $principal, $acl, $type, $name) = @_;
     unless ($principal) {
@@ -46,6 +168,9 @@ sub check {
         return;
     }
     my @args = ($principal, $type, $name, $acl);
+    if ($Wallet::Config::EXTERNAL_PERSISTENT) {
+        return $self->check_persistent (@args);
+    }
     my $pid = open (EXTERNAL, '-|');
     if (not defined $pid) {
         $self->error ("cannot fork: $!");
@@ -75,6 +200,12 @@ sub check {
     }
 }
 
+# Stop the persistent helper when the verifier goes away.
+sub DESTROY {
+    my ($self) = @_;
+    $self->helper_stop;
+}
+
 1;
 __END__
 
@@ -118,6 +249,15 @@ The external command should exit with a non-zero status but no output to
 indicate a normal failure to satisfy the ACL.  Any output will be treated as
 an error.
 
+If $EXTERNAL_PERSISTENT is set in L<Wallet::Config>, the command is instead
+started once, with no arguments, and kept running.  Each check is sent to it
+as a line on its standard input containing the principal, object type, object
+name, and ACL identifier separated by tabs, and the command must answer with a
+single line: C<yes>, C<no>, or an error message.  If the command exits, it is
+restarted and the request is retried once.  If it does not answer within
+$EXTERNAL_TIMEOUT seconds, it is stopped and the check fails with an error;
+the command will be restarted for the next check.
+
 =head1 METHODS
 
 =over 4
@@ -166,6 +306,23 @@ the error() method):
 The attempt to fork in order to execute the external ACL verifier
 command failed, probably due to a lack of system resources.
 
+=item cannot run %s: %s
+
+The persistent external command could not be started.
+
+=item external ACL command %s exited
+
+=item external ACL command %s timed out
+
+The persistent external command exited without answering a request, even
+after being restarted once, or did not answer within the configured
+timeout.
+
+=item invalid character in external ACL request
+
+One of the values to send to the persistent external command contained a
+tab or newline, which cannot be represented in a request line.
+
 =item no principal specified
 
 The PRINCIPAL parameter to check() was undefined or the empty string.
@@ -22,12 +22,17 @@ use Wallet::ACL::Krb5;
 our @ISA     = qw(Wallet::ACL::Krb5);
 our $VERSION = '1.05';
 
+# Cache of compiled regular expressions, keyed by the ACL text.  Malformed
+# regular expressions are cached as undef.
+our %REGEX;
+
 ##############################################################################
 # Interface
 ##############################################################################
 
 # Returns true if the Perl regular expression specified by the ACL matches
-# the provided Kerberos principal.
+# the provided Kerberos principal.  Compiled regular expressions are cached
+# in %REGEX.
 sub check {
     my ($self, $principal, $acl) = @_;
     unless ($principal) {
@@ -38,8 +43,11 @@ sub check {
         $self->error ('no ACL specified');
         return;
     }
-    my $regex = eval { qr/$acl/ };
-    if ($@) {
+    unless (exists $REGEX{$acl}) {
+        $REGEX{$acl} = eval { qr/$acl/ };
+    }
+    my $regex = $REGEX{$acl};
+    unless (defined $regex) {
         $self->error ('malformed krb5-regex ACL');
         return;
     }
@@ -91,6 +99,8 @@ Creates a new ACL verifier.  For this verifier, there is no setup work.
 
 Returns true if the Perl regular expression specified by the ACL matches the
 PRINCIPAL, false if not, and undef on an error (see L<"DIAGNOSTICS"> below).
+Each regular expression is compiled only once per process and then reused
+for later checks.
 
 =item error()
 
@@ -18,13 +18,50 @@ use strict;
 use warnings;
 
 use Authen::SASL;
-use Net::LDAP qw(LDAP_COMPARE_TRUE);
+use Net::LDAP qw(LDAP_CONNECT_ERROR LDAP_SERVER_DOWN);
+use Net::LDAP::Util qw(escape_filter_value);
 use Wallet::ACL::Base;
 use Wallet::Config;
 
 our @ISA     = qw(Wallet::ACL::Base);
 our $VERSION = '1.05';
 
+##############################################################################
+# LDAP connection
+##############################################################################
+
+# Open a connection to the LDAP server and bind, storing the connection in
+# the object.  Throws an exception on failure to connect or bind, so that a
+# connection that failed to bind is never used for searches.
+sub ldap_connect {
+    my ($self) = @_;
+    local $ENV{KRB5CCNAME} = $Wallet::Config::LDAP_CACHE;
+    my $sasl = Authen::SASL->new (mechanism => 'GSSAPI');
+    my $ldap = Net::LDAP->new ($Wallet::Config::LDAP_HOST);
+    die "$@\n" unless $ldap;
+    my $mesg = $ldap->bind (undef, sasl => $sasl);
+    die $mesg->error . "\n" if $mesg->code;
+    $self->{ldap} = $ldap;
+    return 1;
+}
+
+# Run an LDAP search with the given options and return the search result.  If
+# the server has dropped the connection, reconnect and retry the search once.
+# Throws an exception on any error.
+sub ldap_search {
+    my ($self, @options) = @_;
+    my $search;
+    for my $attempt (1, 2) {
+        $self->ldap_connect unless $self->{ldap};
+        $search = $self->{ldap}->search (@options);
+        my $code = $search->code;
+        last unless ($code == LDAP_SERVER_DOWN or $code == LDAP_CONNECT_ERROR);
+        undef $self->{ldap};
+    }
+    die $search->error . "\n" if $search->code;
+    return $search;
+}
+
 ##############################################################################
 # Interface
 ##############################################################################
@@ -39,58 +76,59 @@ sub new {
         die "LDAP attribute ACL support not configured\n";
     }
 
-    # Ensure the required Perl modules are available and bind to the directory
-    # server.  Catch any errors with a try/catch block.
-    my $ldap;
-    eval {
-        local $ENV{KRB5CCNAME} = $Wallet::Config::LDAP_CACHE;
-        my $sasl = Authen::SASL->new (mechanism => 'GSSAPI');
-        $ldap = Net::LDAP->new ($host, onerror => 'die');
-        my $mesg = eval { $ldap->bind (undef, sasl => $sasl) };
-    };
+    # Bind to the directory server.  Catch any errors with a try/catch block.
+    my $self = {};
+    bless ($self, $type);
+    eval { $self->ldap_connect };
     if ($@) {
         my $error = $@;
         chomp $error;
         1 while ($error =~ s/ at \S+ line \d+\.?\z//);
         die "LDAP attribute ACL support not available: $error\n";
     }
-
-    # We successfully bound, so create our object and return it.
-    my $self = { ldap => $ldap };
-    bless ($self, $type);
     return $self;
 }
 
-# Check whether a given principal has the required LDAP attribute.  We first
-# map the principal to a DN by doing a search for that principal (and bailing
-# if we get more than one entry).  Then, we do a compare to see if that DN has
-# the desired attribute and value.
+# Check whether a given principal has the required LDAP attribute.  This is
+# just check_multiple with a single ACL.
+sub check {
+    my ($self, $principal, $acl) = @_;
+    return $self->check_multiple ($principal, [ $acl ]);
+}
+
+# Check whether a given principal has any of a list of LDAP attributes.  We do
+# a single search for the entry for that principal that also has one of the
+# desired attributes and values (and bail if we get more than one entry).
+# Malformed ACLs, including those whose attribute name isn't a plain word that
+# can be put in the filter as is, are skipped, but if no other ACL grants
+# access, the check is reported as an error.
 #
 # If the ldap_map_principal sub is defined in Wallet::Config, call it on the
 # principal first to map it to the value for which we'll search.
-#
-# The connection is configured to die on any error, so we do all the work in a
-# try/catch block to report errors.
-sub check {
-    my ($self, $principal, $acl) = @_;
+sub check_multiple {
+    my ($self, $principal, $acls) = @_;
     undef $self->{error};
     unless ($principal) {
         $self->error ('no principal specified');
         return;
     }
-    my ($attr, $value);
-    if ($acl) {
-        ($attr, $value) = split ('=', $acl, 2);
-    }
-    unless (defined ($attr) and defined ($value)) {
-        $self->error ('malformed ldap-attr ACL');
-        return;
+    my (@filters, $malformed);
+    for my $acl (@$acls) {
+        my ($attr, $value);
+        if ($acl) {
+            ($attr, $value) = split ('=', $acl, 2);
+        }
+        unless (defined ($attr) and defined ($value)
+                and $attr =~ /^[\w-]+\z/) {
+            $malformed = 1;
+            next;
+        }
+        push (@filters, "($attr=" . escape_filter_value ($value) . ')');
     }
-    my $ldap = $self->{ldap};
 
     # Map the principal name to an attribute value for our search if we're
     # doing a custom mapping.
-    if (defined &Wallet::Config::ldap_map_principal) {
+    if (@filters and defined &Wallet::Config::ldap_map_principal) {
         eval { $principal = Wallet::Config::ldap_map_principal ($principal) };
         if ($@) {
             $self->error ("mapping principal to LDAP failed: $@");
@@ -98,38 +136,39 @@ sub check {
         }
     }
 
-    # Now, map the user to a DN by doing a search.
-    my $entry;
-    eval {
-        my $fattr = $Wallet::Config::LDAP_FILTER_ATTR || 'krb5PrincipalName';
-        my $filter = "($fattr=$principal)";
-        my $base = $Wallet::Config::LDAP_BASE;
-        my @options = (base => $base, filter => $filter, attrs => [ 'dn' ]);
-        my $search = $ldap->search (@options);
-        if ($search->count == 1) {
-            $entry = $search->pop_entry;
-        } elsif ($search->count > 1) {
-            die $search->count . " LDAP entries found for $principal";
+    # Search for the principal's entry restricted to those that have one of
+    # the attributes.
+    my $count = 0;
+    if (@filters) {
+        eval {
+            my $fattr = $Wallet::Config::LDAP_FILTER_ATTR
+                || 'krb5PrincipalName';
+            my $attrs = join ('', @filters);
+            $attrs = "(|$attrs)" if @filters > 1;
+            my $filter = "(&($fattr=" . escape_filter_value ($principal)
+                . ")$attrs)";
+            my $base = $Wallet::Config::LDAP_BASE;
+            my @options = (base   => $base,
+                           filter => $filter,
+                           attrs  => [ '1.1' ]);
+            $count = $self->ldap_search (@options)->count;
+            if ($count > 1) {
+                die "$count LDAP entries found for $principal\n";
+            }
+        };
+        if ($@) {
+            $self->error ("cannot search for $principal in LDAP: $@");
+            return;
         }
-    };
-    if ($@) {
-        $self->error ("cannot search for $principal in LDAP: $@");
-        return;
     }
-    return 0 unless $entry;
-
-    # We have a user entry.  We can now check whether that user has the
-    # desired attribute and value.
-    my $result;
-    eval {
-        my $mesg = $ldap->compare ($entry, attr => $attr, value => $value);
-        $result = $mesg->code;
-    };
-    if ($@) {
-        $self->error ("cannot check LDAP attribute $attr for $principal: $@");
+    if ($count) {
+        return 1;
+    } elsif ($malformed) {
+        $self->error ('malformed ldap-attr ACL');
         return;
+    } else {
+        return 0;
     }
-    return ($result == LDAP_COMPARE_TRUE) ? 1 : 0;
 }
 
 1;
@@ -139,7 +178,7 @@ sub check {
 ##############################################################################
 
 =for stopwords
-ACL Allbery verifier LDAP PRINCIPAL's DN ldap-attr
+ACL ACLS Allbery verifier LDAP PRINCIPAL's DN ldap-attr
 
 =head1 NAME
 
@@ -183,10 +222,23 @@ server.
 
 Returns true if PRINCIPAL is granted access according to ACL, false if
 not, and undef on an error (see L<"DIAGNOSTICS"> below).  ACL must be an
-attribute name and a value, separated by an equal sign (with no
-whitespace).  PRINCIPAL will be granted access if its LDAP entry contains
+attribute name, which may contain only letters, digits, underscores, and
+hyphens, and a value, separated by an equal sign (with no whitespace).
+PRINCIPAL will be granted access if its LDAP entry contains
 that attribute with that value.
 
+The entry for PRINCIPAL and the attribute value are checked with a single
+LDAP search.  If the LDAP server has dropped the connection, check()
+reconnects and retries the search once.
+
+=item check_multiple(PRINCIPAL, ACLS)
+
+Like check(), but takes a reference to an array of ACLs and returns true
+if PRINCIPAL is granted access by any of them.  All of the ACLs are
+checked with a single LDAP search.  Wallet::ACL uses this method to check
+all of the C<ldap-attr> entries in an ACL at once.  If any of the ACLs are
+malformed and none of the others grant access, returns undef.
+
 =item error()
 
 Returns the error if check() returned undef.
@@ -215,25 +267,18 @@ Verifying an LDAP attribute ACL may fail with the following errors
 
 =over 4
 
-=item cannot check LDAP attribute %s for %s: %s
-
-The LDAP compare to check for the required attribute failed.  The
-attribute may have been misspelled, or there may be LDAP directory
-permission issues.  This error indicates that PRINCIPAL's entry was
-located in LDAP, but the check failed during the compare to verify the
-attribute value.
-
 =item cannot search for %s in LDAP: %s
 
-Searching for PRINCIPAL (possibly after ldap_map_principal() mapping)
-failed.  This is often due to LDAP directory permissions issues.  This
-indicates a failure during the mapping of PRINCIPAL to an LDAP DN.
+Searching for PRINCIPAL (possibly after ldap_map_principal() mapping) with
+the required attribute failed.  This is often due to LDAP directory
+permissions issues, or more than one entry may have matched PRINCIPAL.
 
 =item malformed ldap-attr ACL
 
 The ACL parameter to check() was malformed.  Usually this means that
-either the attribute or the value were empty or the required C<=> sign
-separating them was missing.
+either the attribute or the value were empty, the required C<=> sign
+separating them was missing, or the attribute name contained characters
+other than letters, digits, underscores, and hyphens.
 
 =item mapping principal to LDAP failed: %s
 
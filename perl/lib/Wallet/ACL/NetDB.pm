@@ -64,34 +64,22 @@ sub new {
     return $self;
 }
 
-# Check whether the given principal has one of the user, administrator, or
-# admin team roles in NetDB for the given host.  Returns 1 if it does, 0 if it
-# doesn't, and undef, setting the error, if there's some failure in making the
-# remctl call.
-sub check {
-    my ($self, $principal, $acl) = @_;
-    unless ($principal) {
-        $self->error ('no principal specified');
-        return;
-    }
-    unless ($acl) {
-        $self->error ('malformed netdb ACL');
-        return;
-    }
+# Run a netdb remctl command with the given arguments and return its standard
+# output.  Returns undef, setting the error, if there's some failure in making
+# the remctl call.
+sub remctl_command {
+    my ($self, @args) = @_;
     my $remctl = $self->{remctl};
-    if ($Wallet::Config::NETDB_REALM) {
-        $principal =~ s/\@\Q$Wallet::Config::NETDB_REALM\E\z//;
-    }
-    unless ($remctl->command ('netdb', 'node-roles', $principal, $acl)) {
+    unless ($remctl->command ('netdb', @args)) {
         $self->error ('cannot check NetDB ACL: ' . $remctl->error);
         return;
     }
-    my ($roles, $output, $status, $error);
+    my ($result, $output, $status, $error);
     do {
         $output = $remctl->output;
         if ($output->type eq 'output') {
             if ($output->stream == 1) {
-                $roles .= $output->data;
+                $result .= $output->data;
             } else {
                 $error .= $output->data;
             }
@@ -106,14 +94,7 @@ sub check {
         }
     } while ($output->type eq 'output');
     if ($status == 0) {
-        $roles ||= '';
-        my @roles = split (' ', $roles);
-        for my $role (@roles) {
-            return 1 if $role eq 'admin';
-            return 1 if $role eq 'team';
-            return 1 if $role eq 'user';
-        }
-        return 0;
+        return defined ($result) ? $result : '';
     } else {
         if ($error) {
             chomp $error;
@@ -126,6 +107,106 @@ sub check {
     }
 }
 
+# Given a principal (already in the form NetDB expects) and a list of nodes,
+# return a reference to a hash of nodes to references to arrays of the roles
+# that principal has for that node.  Results are cached for NETDB_CACHE_TTL
+# seconds.  If NETDB_REMCTL_BATCH is set, all nodes that aren't cached are
+# looked up with a single remctl call, and that call failing is an error.
+# Otherwise, each node is looked up separately, and a node whose lookup fails
+# is left out of the hash and not cached so that the other nodes can still be
+# checked.  Returns undef, setting the error, if the batched remctl call
+# fails.  If only some lookups fail, the error is set to that of the last
+# failure.
+sub roles {
+    my ($self, $principal, @nodes) = @_;
+    my $ttl = $Wallet::Config::NETDB_CACHE_TTL;
+    my $now = time;
+    my (%roles, @missing);
+    for my $node (@nodes) {
+        my $cached = $self->{cache}{$principal}{$node};
+        if ($ttl and $cached and $cached->[0] + $ttl > $now) {
+            $roles{$node} = $cached->[1];
+        } else {
+            push (@missing, $node);
+        }
+    }
+    my $batch = $Wallet::Config::NETDB_REMCTL_BATCH;
+    if ($batch and @missing > 1) {
+        my $output = $self->remctl_command ($batch, $principal, @missing);
+        return unless defined $output;
+        my %found;
+        for my $line (split ("\n", $output)) {
+            my ($node, @roles) = split (' ', $line);
+            next unless defined $node;
+            $found{$node} = [ @roles ];
+        }
+        for my $node (@missing) {
+            $roles{$node} = $found{$node} || [];
+        }
+    } else {
+        for my $node (@missing) {
+            my @args = ('node-roles', $principal, $node);
+            my $output = $self->remctl_command (@args);
+            next unless defined $output;
+            $roles{$node} = [ split (' ', $output) ];
+        }
+    }
+    if ($ttl) {
+        for my $node (grep { $roles{$_} } @missing) {
+            $self->{cache}{$principal}{$node} = [ $now, $roles{$node} ];
+        }
+    }
+    return \%roles;
+}
+
+# Check whether the given principal has one of the user, administrator, or
+# admin team roles in NetDB for the given host.  Returns 1 if it does, 0 if it
+# doesn't, and undef, setting the error, if there's some failure in making the
+# remctl call.
+sub check {
+    my ($self, $principal, $acl) = @_;
+    return $self->check_multiple ($principal, [ $acl ]);
+}
+
+# Check whether the given principal has one of the user, administrator, or
+# admin team roles in NetDB for any of a list of hosts, looking up the roles
+# for all of them at once.  Malformed ACLs and nodes whose roles couldn't be
+# looked up are skipped, but if no other ACL grants access, the check is
+# reported as an error, as Wallet::ACL does for separate entries.
+sub check_multiple {
+    my ($self, $principal, $acls) = @_;
+    unless ($principal) {
+        $self->error ('no principal specified');
+        return;
+    }
+    my @nodes = grep { $_ } @$acls;
+    if ($Wallet::Config::NETDB_REALM) {
+        $principal =~ s/\@\Q$Wallet::Config::NETDB_REALM\E\z//;
+    }
+    if (@nodes) {
+        my $roles = $self->roles ($principal, @nodes);
+        return unless $roles;
+        my $failed = 0;
+        for my $node (@nodes) {
+            unless ($roles->{$node}) {
+                $failed = 1;
+                next;
+            }
+            for my $role (@{ $roles->{$node} }) {
+                return 1 if $role eq 'admin';
+                return 1 if $role eq 'team';
+                return 1 if $role eq 'user';
+            }
+        }
+        return if $failed;
+    }
+    if (@nodes < @$acls) {
+        $self->error ('malformed netdb ACL');
+        return;
+    }
+    return 0;
+}
+
 1;
 __END__
 
@@ -134,7 +215,7 @@ __END__
 ##############################################################################
 
 =for stopwords
-ACL NetDB remctl DNS DHCP Allbery netdb verifier
+ACL ACLS NetDB remctl DNS DHCP Allbery netdb verifier
 
 =head1 NAME
 
@@ -180,10 +261,33 @@ not, and undef on an error (see L<"DIAGNOSTICS"> below).  ACL is a node,
 and PRINCIPAL will be granted access if it (with the realm stripped off if
 configured) has the user, admin, or team role for that node.
 
+Role lookups are cached for NETDB_CACHE_TTL seconds, so repeated checks of
+the same principal and node in one process only query NetDB once.
+
+=item check_multiple(PRINCIPAL, ACLS)
+
+Like check(), but takes a reference to an array of nodes and returns true
+if PRINCIPAL is granted access to any of them.  The roles for all of the
+nodes are looked up with roles().  Wallet::ACL uses this method to check
+all of the C<netdb> entries in an ACL at once.  If any of the ACLs are
+malformed, or the roles for any of the nodes couldn't be looked up, and
+none of the others grant access, returns undef.
+
 =item error()
 
 Returns the error if check() returned undef.
 
+=item roles(PRINCIPAL, NODE[, NODE ...])
+
+Returns a reference to a hash mapping each NODE to a reference to an array
+of the NetDB roles that PRINCIPAL has for that node, or undef on an error.
+PRINCIPAL is passed to NetDB as is, without stripping NETDB_REALM.  Results
+are cached for NETDB_CACHE_TTL seconds.  If NETDB_REMCTL_BATCH is set, all
+nodes not found in the cache are looked up with a single remctl call;
+otherwise, each node is looked up with C<netdb node-roles>.  If a single
+node's lookup fails, that node is left out of the returned hash, and the
+error is set, but the other nodes are still looked up.
+
 =back
 
 =head1 DIAGNOSTICS
@@ -227,7 +331,9 @@ error message or otherwise returned failure.
 =item malformed netdb ACL
 
 The ACL parameter to check() was malformed.  Currently, this error is only
-given if ACL is undefined or the empty string.
+given if ACL is undefined or the empty string, or, for check_multiple(),
+if one of the ACLs is undefined or the empty string and none of the others
+grant access.
 
 =item malformed NetDB remctl token: %s
 
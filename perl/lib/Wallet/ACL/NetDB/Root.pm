@@ -26,11 +26,13 @@ our $VERSION = '1.05';
 # Interface
 ##############################################################################
 
-# Override the check method of Wallet::ACL::NetDB to require that the
-# principal be a root instance and to strip /root out of the principal name
-# before checking roles.
-sub check {
-    my ($self, $principal, $acl) = @_;
+# Override the check_multiple method of Wallet::ACL::NetDB to require that
+# the principal be a root instance and to strip /root out of the principal
+# name before checking roles.  The check method of the parent class calls
+# check_multiple, so this covers it as well and it must not strip /root
+# itself.
+sub check_multiple {
+    my ($self, $principal, $acls) = @_;
     unless ($principal) {
         $self->error ('no principal specified');
         return;
@@ -38,7 +40,7 @@ sub check {
     unless ($principal =~ s%^([^/\@]+)/root(\@|\z)%$1$2%) {
         return 0;
     }
-    return $self->SUPER::check ($principal, $acl);
+    return $self->SUPER::check_multiple ($principal, $acls);
 }
 
 ##############################################################################
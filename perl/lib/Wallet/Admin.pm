@@ -18,6 +18,11 @@ use strict;
 use warnings;
 
 use Wallet::ACL;
+use Wallet::Archive;
+use Wallet::Cache;
+use Wallet::Config;
+use Wallet::Journal;
+use Wallet::Object::Base;
 use Wallet::Schema;
 
 our $VERSION = '1.05';
@@ -28,6 +33,10 @@ our $VERSION = '1.05';
 # work properly.
 our $BASE_VERSION = '0.07';
 
+# The number of objects to update in each transaction when backfilling the
+# host stored with each object.
+our $HOST_BATCH = 1000;
+
 ##############################################################################
 # Constructor, destructor, and accessors
 ##############################################################################
@@ -146,6 +155,15 @@ sub default_data {
     ($r1) = $self->{schema}->resultset('Enctype')->populate (\@record);
     warn "default Enctype not installed" unless defined $r1;
 
+    # The generation counter for cached metadata.  Start it at the current
+    # time so that a process that cached data from an earlier database with
+    # the same connection information won't mistake it for current.
+    @record = ([ qw/ge_name ge_generation/ ],
+               [ $Wallet::Cache::GENERATION, time ]);
+    ($r1) = $self->{schema}->resultset('Generation')->populate (\@record);
+    warn "default Generation not installed" unless defined $r1;
+    Wallet::Cache->clear ($self->{schema});
+
     return 1;
 }
 
@@ -167,13 +185,14 @@ sub destroy {
     my $dbh = $self->dbh;
     my @tables = qw(
       acl_entries duo object_history objects acls acl_history acl_schemes
-      enctypes flags keytab_enctypes keytab_sync sync_targets types
-      dbix_class_schema_versions
+      enctypes flags generations keytab_enctypes keytab_sync sync_targets
+      types dbix_class_schema_versions
     );
     for my $table (@tables) {
         my $sql = "DROP TABLE IF EXISTS $table";
         $dbh->do ($sql);
     }
+    Wallet::Cache->clear ($self->{schema});
 
     return 1;
 }
@@ -221,9 +240,112 @@ sub upgrade {
         return;
     }
 
+    # Upgrades may change the registered types and schemes.
+    eval { Wallet::Cache->invalidate ($self->{schema}) };
+    if ($@) {
+        $self->error ($@);
+        return;
+    }
+
     return 1;
 }
 
+##############################################################################
+# History maintenance
+##############################################################################
+
+# Archive history older than the given time, in seconds since epoch, into
+# HISTORY_ARCHIVE_DIR and remove it from the database.  Returns the number of
+# rows archived (which may be 0) on success and undef on failure, setting the
+# internal error.
+sub history_archive {
+    my ($self, $before) = @_;
+    my $dir = $Wallet::Config::HISTORY_ARCHIVE_DIR;
+    unless ($dir) {
+        $self->error ('history archive not configured');
+        return;
+    }
+    my $count = eval {
+        Wallet::Archive->new ($dir)->archive ($self->{schema}, $before);
+    };
+    if ($@) {
+        $self->error ("cannot archive history: $@");
+        return;
+    }
+    return $count;
+}
+
+# Flush the history journal into the database.  Returns the number of records
+# flushed (which may be 0) on success and undef on failure, setting the
+# internal error.
+sub history_flush {
+    my ($self) = @_;
+    my $path = $Wallet::Config::HISTORY_JOURNAL;
+    unless ($path) {
+        $self->error ('history journal not configured');
+        return;
+    }
+    my $count = eval { Wallet::Journal->new ($path)->flush ($self->{schema}) };
+    if ($@) {
+        $self->error ("cannot flush history journal: $@");
+        return;
+    }
+    return $count;
+}
+
+##############################################################################
+# Object hosts
+##############################################################################
+
+# Set the host stored with each object from the object_host function in the
+# wallet configuration.  This is needed for objects created before that
+# function was defined or before the host was stored, and after any change to
+# the host mapping.  Objects are read in batches in type and name order, and
+# the changes for each batch are made in their own transaction.  Returns the
+# number of objects whose host changed (which may be 0) on success and undef
+# on failure, setting the internal error.
+sub hosts_backfill {
+    my ($self) = @_;
+    unless (defined &Wallet::Config::object_host) {
+        $self->error ('no object host policy defined');
+        return;
+    }
+    my $schema = $self->{schema};
+    my $count = 0;
+    eval {
+        my $rs = $schema->resultset('Object');
+        my %attrs = (columns  => [ qw(ob_id ob_type ob_name ob_host) ],
+                     order_by => 'ob_id',
+                     rows     => $HOST_BATCH);
+        my %search;
+        while (1) {
+            my @objects = $rs->search (\%search, \%attrs)->all;
+            last unless @objects;
+            my $guard = $schema->txn_scope_guard;
+            for my $object (@objects) {
+                my ($type, $name) = ($object->ob_type, $object->ob_name);
+                my $host = Wallet::Object::Base->host_for ($type, $name);
+                my $old = $object->ob_host;
+                next if (!defined ($host) and !defined ($old));
+                next if (defined ($host) and defined ($old) and $host eq $old);
+                $object->ob_host ($host);
+                $object->update;
+                $count++;
+            }
+            $guard->commit;
+            last if @objects < $HOST_BATCH;
+
+            # Start the next batch after the last object in this one.
+            %search = (ob_id => { '>' => $objects[-1]->ob_id });
+        }
+    };
+    if ($@) {
+        $self->error ("cannot backfill object hosts: $@");
+        return;
+    }
+    return $count;
+}
+
 ##############################################################################
 # Object registration
 ##############################################################################
@@ -239,6 +361,7 @@ sub register_object {
         my %record = (ty_name  => $type,
                       ty_class => $class);
         $self->{schema}->resultset('Type')->create (\%record);
+        Wallet::Cache->invalidate ($self->{schema});
         $guard->commit;
     };
     if ($@) {
@@ -259,6 +382,7 @@ sub register_verifier {
         my %record = (as_name  => $scheme,
                       as_class => $class);
         $self->{schema}->resultset('AclScheme')->create (\%record);
+        Wallet::Cache->invalidate ($self->{schema});
         $guard->commit;
     };
     if ($@) {
@@ -331,6 +455,28 @@ Returns the error of the last failing operation or undef if no operations
 have failed.  Callers should call this function to get the error message
 after an undef return from any other instance method.
 
+=item history_archive (BEFORE)
+
+Moves all object and ACL history from before BEFORE, given in seconds
+since epoch, out of the database and into compressed archive files in
+HISTORY_ARCHIVE_DIR.  See Wallet::Archive(3) for details.  Returns the
+number of rows archived, which may be 0, on success and undef on failure.
+
+=item history_flush ()
+
+Flushes the history journal configured with HISTORY_JOURNAL into the
+database.  See Wallet::Journal(3) for details.  Returns the number of
+records flushed, which may be 0, on success and undef on failure.
+
+=item hosts_backfill ()
+
+Sets the host stored with each object in the database from the
+object_host() function in the wallet configuration, as is done when an
+object is created or renamed.  This should be run after first defining
+object_host() or after changing the host mapping.  Objects are updated in
+batches, each in its own transaction.  Returns the number of objects whose
+host changed, which may be 0, on success and undef on failure.
+
 =item initialize(PRINCIPAL)
 
 Initializes the database as configured in Wallet::Config and loads the
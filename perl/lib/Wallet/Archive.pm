@@ -0,0 +1,392 @@
+# Wallet::Archive -- Archive of old object and ACL history
+#
+# This module moves old rows from the object_history and acl_history tables
+# into compressed, date-partitioned archive files and reads them back when
+# archived history is requested.
+#
+# Written by Russ Allbery <eagle@eyrie.org>
+# Copyright 2026 Russ Allbery <eagle@eyrie.org>
+#
+# SPDX-License-Identifier: MIT
+
+##############################################################################
+# Modules and declarations
+##############################################################################
+
+package Wallet::Archive;
+
+use 5.008;
+use strict;
+use warnings;
+
+use DateTime;
+use IO::Compress::Gzip qw($GzipError);
+use IO::Handle;
+use IO::Uncompress::Gunzip qw($GunzipError);
+use Time::Local qw(timegm);
+
+our $VERSION = '1.05';
+
+# The history tables that can be archived, mapping the table name to the
+# result source, the primary key, the timestamp column, the columns in the
+# order in which they're stored in the archive, and the columns identifying
+# the object or ACL whose history it is, which are kept in an index for each
+# archive file.
+our %TABLES = (
+    acl_history => {
+        source  => 'AclHistory',
+        id      => 'ah_id',
+        date    => 'ah_on',
+        columns => [ qw(ah_id ah_acl ah_name ah_action ah_scheme
+                        ah_identifier ah_by ah_from ah_on) ],
+        index   => [ qw(ah_acl) ],
+    },
+    object_history => {
+        source  => 'ObjectHistory',
+        id      => 'oh_id',
+        date    => 'oh_on',
+        columns => [ qw(oh_id oh_type oh_name oh_action oh_field
+                        oh_type_field oh_old oh_new oh_by oh_from oh_on) ],
+        index   => [ qw(oh_type oh_name) ],
+    },
+);
+
+# The default number of rows to archive in each batch.
+our $BATCH = 1000;
+
+##############################################################################
+# Constructor
+##############################################################################
+
+# Create a new archive object for the given directory.
+sub new {
+    my ($class, $dir) = @_;
+    die "no archive directory specified\n" unless $dir;
+    my $self = { dir => $dir };
+    bless ($self, $class);
+    return $self;
+}
+
+##############################################################################
+# Encoding
+##############################################################################
+
+# Encode a row (a reference to an array of values) as a line.  Characters that
+# would break the line format are escaped as %XX, and undef is stored as %N.
+sub encode {
+    my ($self, $row) = @_;
+    my @values = @$row;
+    for my $value (@values) {
+        if (defined $value) {
+            $value =~ s/([%\t\n\r])/sprintf ('%%%02X', ord ($1))/ge;
+        } else {
+            $value = '%N';
+        }
+    }
+    return join ("\t", @values) . "\n";
+}
+
+# Decode a line into a reference to a hash of column names to values for the
+# given table.  Returns undef if the line is malformed.
+sub decode {
+    my ($self, $table, $line) = @_;
+    my $columns = $TABLES{$table}{columns};
+    return unless $line =~ s/\n\z//;
+    my @values = split (/\t/, $line, -1);
+    return unless @values == @$columns;
+    for my $value (@values) {
+        if ($value eq '%N') {
+            undef $value;
+        } else {
+            $value =~ s/%([0-9A-F]{2})/chr (hex ($1))/ge;
+        }
+    }
+    my %row;
+    @row{@$columns} = @values;
+    return \%row;
+}
+
+##############################################################################
+# Archiving
+##############################################################################
+
+# Append index lines, identifying objects or ACLs with history in the archive
+# file for a table and month, to the index for that file.  This is done
+# before the rows are appended to the archive file, so an interrupted archive
+# run can leave extra lines in the index but never leaves rows out of it.
+# The file is synced before we return.  Throws an exception on failure.
+sub append_index {
+    my ($self, $table, $month, @keys) = @_;
+    my $path = "$self->{dir}/$table-$month.idx";
+    open (my $fh, '>>', $path) or die "cannot open $path: $!\n";
+    print {$fh} @keys or die "cannot write to $path: $!\n";
+    $fh->flush or die "cannot write to $path: $!\n";
+    $fh->sync or die "cannot sync $path: $!\n";
+    close ($fh) or die "cannot close $path: $!\n";
+    return 1;
+}
+
+# Append lines to the archive file for a table and month.  Each call adds a
+# new gzip member to the end of the file, and the file is synced before we
+# return so that it's safe to delete the rows from the database.  Throws an
+# exception on failure.
+sub append {
+    my ($self, $table, $month, @lines) = @_;
+    my $path = "$self->{dir}/$table-$month.gz";
+    open (my $fh, '>>', $path) or die "cannot open $path: $!\n";
+    binmode $fh;
+    my $gzip = IO::Compress::Gzip->new ($fh, AutoClose => 0)
+        or die "cannot compress $path: $GzipError\n";
+    $gzip->print (@lines) or die "cannot write to $path: $GzipError\n";
+    $gzip->close or die "cannot write to $path: $GzipError\n";
+    $fh->flush or die "cannot write to $path: $!\n";
+    $fh->sync or die "cannot sync $path: $!\n";
+    close ($fh) or die "cannot close $path: $!\n";
+    return 1;
+}
+
+# Archive all history rows older than the given time (in seconds since epoch)
+# from the given schema.  Rows are read in batches in primary key order,
+# appended to one archive file per table and month, and then deleted from
+# the database in one transaction per batch.  Returns the number of rows
+# archived and throws an exception on failure.
+sub archive {
+    my ($self, $schema, $before, $batch) = @_;
+    $batch ||= $BATCH;
+    unless (-d $self->{dir}) {
+        die "archive directory $self->{dir} does not exist\n";
+    }
+    my $parser = $schema->storage->datetime_parser;
+    my $cutoff = DateTime->from_epoch (epoch => $before);
+    $cutoff = $parser->format_datetime ($cutoff);
+    my $inflator = 'DBIx::Class::ResultClass::HashRefInflator';
+    my $total = 0;
+    for my $table (sort keys %TABLES) {
+        my $info = $TABLES{$table};
+        my $rs = $schema->resultset ($info->{source});
+        my %search = ($info->{date} => { '<' => $cutoff });
+        my %attrs = (order_by     => $info->{id},
+                     rows         => $batch,
+                     result_class => $inflator);
+        while (1) {
+            my @rows = $rs->search (\%search, \%attrs)->all;
+            last unless @rows;
+
+            # Group the rows by month, converting the dates to epoch times,
+            # and collect the index lines for each month.
+            my (%months, %keys, @ids);
+            for my $row (@rows) {
+                my $date = $parser->parse_datetime ($row->{$info->{date}});
+                $row->{$info->{date}} = $date->epoch;
+                my $month = $date->strftime ('%Y-%m');
+                my $line = $self->encode ([ @$row{@{ $info->{columns} }} ]);
+                push (@{ $months{$month} }, $line);
+                my $key = $self->encode ([ @$row{@{ $info->{index} }} ]);
+                $keys{$month}{$key} = 1;
+                push (@ids, $row->{$info->{id}});
+            }
+            for my $month (sort keys %months) {
+                my @keys = sort keys %{ $keys{$month} };
+                $self->append_index ($table, $month, @keys);
+                $self->append ($table, $month, @{ $months{$month} });
+            }
+
+            # Now that the rows are safely in the archive, delete them.
+            my $guard = $schema->txn_scope_guard;
+            $rs->search ({ $info->{id} => { -in => \@ids } })->delete;
+            $guard->commit;
+            $total += @rows;
+        }
+    }
+    return $total;
+}
+
+##############################################################################
+# Retrieval
+##############################################################################
+
+# Returns true if the archive file for the given table and month may contain
+# rows with the given index line.  If there is no index for that file, we
+# have to assume that it may.  Throws an exception on failure.
+sub indexed {
+    my ($self, $table, $month, $key) = @_;
+    my $path = "$self->{dir}/$table-$month.idx";
+    open (my $fh, '<', $path) or return 1;
+    my $found = 0;
+    while (defined (my $line = <$fh>)) {
+        if ($line eq $key) {
+            $found = 1;
+            last;
+        }
+    }
+    close $fh;
+    return $found;
+}
+
+# Return the archived rows from the given table that match all of the column
+# values in the given hash, as references to hashes of column names to
+# values, in primary key order.  If the optional since and until times are
+# given, in seconds since epoch, archive files for months entirely outside
+# that range are skipped, although rows in the remaining months are not
+# filtered by time.  Files whose index shows that they have no history for
+# the object or ACL being searched for are also skipped.  Timestamps are
+# returned as floating DateTime objects in UTC, matching what's read from the
+# database.  Throws an exception on failure.
+sub rows {
+    my ($self, $table, $search, $since, $until) = @_;
+    my %search = %$search;
+    my $info = $TABLES{$table} or die "unknown history table $table\n";
+    my $dir = $self->{dir};
+    opendir (my $dh, $dir) or die "cannot open $dir: $!\n";
+    my @files = sort grep { /^\Q$table\E-\d{4}-\d{2}\.gz\z/ } readdir $dh;
+    closedir $dh;
+
+    # The index line to look for, if we're searching on the indexed columns.
+    my $key;
+    if (!grep { !exists $search{$_} } @{ $info->{index} }) {
+        $key = $self->encode ([ @search{@{ $info->{index} }} ]);
+    }
+
+    my @rows;
+    for my $file (@files) {
+        my ($year, $month) = ($file =~ /-(\d{4})-(\d{2})\.gz\z/);
+        my $start = timegm (0, 0, 0, 1, $month - 1, $year);
+        my $end = ($month == 12) ? timegm (0, 0, 0, 1, 0, $year + 1)
+                                 : timegm (0, 0, 0, 1, $month, $year);
+        next if (defined ($since) and $end <= $since);
+        next if (defined ($until) and $start >= $until);
+        next if (defined ($key) and !$self->indexed ($table, "$year-$month",
+                                                     $key));
+        my $gunzip = IO::Uncompress::Gunzip->new ("$dir/$file",
+                                                  MultiStream => 1)
+            or die "cannot open $dir/$file: $GunzipError\n";
+        while (defined (my $line = $gunzip->getline)) {
+            my $row = $self->decode ($table, $line);
+            next unless $row;
+            my $match = 1;
+            for my $column (keys %search) {
+                unless (defined ($row->{$column})
+                        and $row->{$column} eq $search{$column}) {
+                    $match = 0;
+                    last;
+                }
+            }
+            push (@rows, $row) if $match;
+        }
+        $gunzip->close;
+    }
+
+    # Rows are archived again if archiving was interrupted before they were
+    # deleted from the database, so keep only the first copy of each.
+    my $id = $info->{id};
+    my %seen;
+    @rows = grep { !$seen{ $_->{$id} }++ } @rows;
+    for my $row (@rows) {
+        my $epoch = $row->{$info->{date}};
+        $row->{$info->{date}}
+            = DateTime->from_epoch (epoch => $epoch, time_zone => 'floating');
+    }
+    return sort { $a->{$id} <=> $b->{$id} } @rows;
+}
+
+1;
+__END__
+
+##############################################################################
+# Documentation
+##############################################################################
+
+=for stopwords
+gzip DateTime YYYY-MM
+
+=head1 NAME
+
+Wallet::Archive - Archive of old object and ACL history
+
+=head1 SYNOPSIS
+
+    use Wallet::Archive;
+    my $archive = Wallet::Archive->new ($dir);
+    my $count = $archive->archive ($schema, $before);
+    my @rows = $archive->rows ('object_history',
+                               { oh_type => $type, oh_name => $name });
+
+=head1 DESCRIPTION
+
+Wallet::Archive moves old rows from the object_history and acl_history
+tables into compressed archive files and reads them back.  It is used by
+C<wallet-admin history archive> and, when archived history is requested,
+by the history methods of Wallet::Object::Base and Wallet::ACL.
+
+Archived rows are stored in one file per table and month, named after the
+table and the month of the row's timestamp (such as
+F<object_history-2020-01.gz>), in the directory given by
+HISTORY_ARCHIVE_DIR.  Each archive run appends a new gzip member to the
+end of the file.  Each line of the uncompressed file is one row, with the
+column values separated by tabs and the timestamp stored in seconds since
+epoch.  Any percent signs, tabs, carriage returns, or newlines in a value
+are encoded as C<%> followed by two hexadecimal digits, and NULL values
+are stored as C<%N>.
+
+Next to each archive file is an index with the same name but ending in
+F<.idx> instead of F<.gz>.  It lists, one per line and encoded in the same
+way, the values of the columns identifying the object or ACL for every
+row in that archive file: the type and name for object_history and the
+ACL ID for acl_history.  An index may list objects or ACLs with no rows in
+the archive file if archiving was interrupted, but never omits any.
+
+=head1 CLASS METHODS
+
+=over 4
+
+=item new(DIR)
+
+Creates a new archive object for the archive directory DIR.
+
+=back
+
+=head1 INSTANCE METHODS
+
+=over 4
+
+=item archive(SCHEMA, BEFORE[, BATCH])
+
+Archives all rows in the object_history and acl_history tables of the
+Wallet::Schema object SCHEMA with timestamps before BEFORE, given in
+seconds since epoch.  Rows are processed BATCH at a time (1000 by
+default): each batch is appended to the archive files, which are synced
+to disk, and then deleted from the database in its own transaction.
+Returns the number of rows archived and throws an exception on failure.
+
+If archiving is interrupted after a batch is written to the archive but
+before it is deleted from the database, those rows will be archived again
+the next time and will appear twice in the archive files.  rows() returns
+only one copy of each.
+
+=item rows(TABLE, SEARCH[, SINCE, UNTIL])
+
+Returns the archived rows from TABLE (either C<object_history> or
+C<acl_history>) whose columns have all of the values in the hash
+referenced by SEARCH, in the order of their original primary keys.  Each
+row is a reference to a hash of column names to values, with the
+timestamp as a DateTime object in the floating time zone holding the UTC
+time, as it would be read from the database.
+
+Only archive files that may contain matching rows are read.  If SEARCH
+includes all of the columns in the index, files whose index doesn't list
+those values are skipped.  If SINCE or UNTIL are given, in seconds since
+epoch, files for months that end before SINCE or start at or after UNTIL
+are skipped.  The returned rows are not otherwise limited to that range,
+so the caller should still check the timestamps.  Throws an exception on
+failure.
+
+=back
+
+=head1 SEE ALSO
+
+wallet-admin(8), Wallet::Config(3)
+
+This module is part of the wallet system.  The current version is
+available from L<https://www.eyrie.org/~eagle/software/wallet/>.
+
+=cut
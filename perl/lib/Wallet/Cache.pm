@@ -0,0 +1,228 @@
+# Wallet::Cache -- Process-wide cache of rarely-changing wallet metadata
+#
+# This module caches the mappings of object types and ACL schemes to the
+# classes that implement them and the ID and name of the ADMIN ACL, which are
+# otherwise looked up again on every request.  The cache is shared by all
+# connections to the same database in a process and is validated against a
+# generation counter stored in the database, which is incremented whenever
+# any of the cached data changes.
+#
+# Written by Russ Allbery <eagle@eyrie.org>
+# Copyright 2026 Russ Allbery <eagle@eyrie.org>
+#
+# SPDX-License-Identifier: MIT
+
+##############################################################################
+# Modules and declarations
+##############################################################################
+
+package Wallet::Cache;
+
+use 5.008;
+use strict;
+use warnings;
+
+use Wallet::Query;
+
+our $VERSION = '1.05';
+
+# The name of the generation counter row covering the cached data.
+our $GENERATION = 'metadata';
+
+# The cached data for each database, keyed by DBI data source.  Each value is
+# a reference to a hash with keys generation, types, schemes, and admin.
+our %CACHE;
+
+##############################################################################
+# Internal functions
+##############################################################################
+
+# Returns the key for the cache for the given schema.
+sub _key {
+    my ($schema) = @_;
+    return $schema->storage->connect_info->[0];
+}
+
+# Returns the cache for the given schema, checking the generation first if
+# this process hasn't checked it yet.
+sub _cache {
+    my ($class, $schema) = @_;
+    my $cache = $CACHE{_key ($schema)};
+    return $cache if $cache;
+    return $class->check ($schema);
+}
+
+##############################################################################
+# Validation
+##############################################################################
+
+# Read the generation counter from the database and discard the cache for
+# that database if the counter has changed since the cache was filled.  This
+# is one indexed query and should be done at the start of each request.
+# Returns the cache.  Throws an exception on database errors.
+sub check {
+    my ($class, $schema) = @_;
+    my $key = _key ($schema);
+    my $generation = Wallet::Query->new ($schema)->generation ($GENERATION);
+    $generation = 0 unless defined $generation;
+    my $cache = $CACHE{$key};
+    if (!$cache or $cache->{generation} != $generation) {
+        $cache = { generation => $generation };
+        $CACHE{$key} = $cache;
+    }
+    return $cache;
+}
+
+# Increment the generation counter, telling every process to discard its
+# cache, and discard the cache of this process.  This should be called in the
+# same transaction as the change to the cached data.  Throws an exception on
+# database errors.
+sub invalidate {
+    my ($class, $schema) = @_;
+    my $rs = $schema->resultset('Generation');
+    $rs->search ({ ge_name => $GENERATION })
+        ->update ({ ge_generation => \'ge_generation + 1' });
+    $class->clear ($schema);
+    return 1;
+}
+
+# Discard the cache of this process for the given schema without touching
+# the database.  This is used when the database is destroyed.
+sub clear {
+    my ($class, $schema) = @_;
+    delete $CACHE{_key ($schema)};
+    return 1;
+}
+
+##############################################################################
+# Lookups
+##############################################################################
+
+# Given an object type, return the class implementing it, or undef if the
+# type isn't known.  Throws an exception on database errors.
+sub type_class {
+    my ($class, $schema, $type) = @_;
+    my $cache = $class->_cache ($schema);
+    unless (exists $cache->{types}{$type}) {
+        my $row = $schema->resultset('Type')->find ({ ty_name => $type });
+        $cache->{types}{$type} = $row ? $row->ty_class : undef;
+    }
+    return $cache->{types}{$type};
+}
+
+# Given an ACL scheme, return the class implementing it, or undef if the
+# scheme isn't known.  Throws an exception on database errors.
+sub scheme_class {
+    my ($class, $schema, $scheme) = @_;
+    my $cache = $class->_cache ($schema);
+    unless (exists $cache->{schemes}{$scheme}) {
+        my %search = (as_name => $scheme);
+        my $row = $schema->resultset('AclScheme')->find (\%search);
+        $cache->{schemes}{$scheme} = $row ? $row->as_class : undef;
+    }
+    return $cache->{schemes}{$scheme};
+}
+
+# Return a reference to a hash of the id and name of the ADMIN ACL, suitable
+# for passing to Wallet::ACL->new, or undef if it doesn't exist.  Throws an
+# exception on database errors.
+sub admin {
+    my ($class, $schema) = @_;
+    my $cache = $class->_cache ($schema);
+    unless (exists $cache->{admin}) {
+        my $row = $schema->resultset('Acl')->find ({ ac_name => 'ADMIN' });
+        $cache->{admin}
+            = $row ? { id => $row->ac_id, name => $row->ac_name } : undef;
+    }
+    return $cache->{admin};
+}
+
+1;
+__END__
+
+##############################################################################
+# Documentation
+##############################################################################
+
+=for stopwords
+ACL DBI
+
+=head1 NAME
+
+Wallet::Cache - Process-wide cache of rarely-changing wallet metadata
+
+=head1 SYNOPSIS
+
+    use Wallet::Cache;
+    Wallet::Cache->check ($schema);
+    my $class = Wallet::Cache->type_class ($schema, 'keytab');
+    my $acl = Wallet::ACL->new ('ADMIN', $schema,
+                                Wallet::Cache->admin ($schema));
+
+=head1 DESCRIPTION
+
+Wallet::Cache holds the wallet metadata that almost never changes but that
+is otherwise looked up on every request: the classes implementing each
+object type and ACL scheme, and the ID and name of the C<ADMIN> ACL.
+Values are looked up in the database the first time they're needed and
+then kept for the life of the process, shared by all connections to the
+same database (as identified by its DBI data source).
+
+The database holds a generation counter in the C<generations> table that
+is incremented in the same transaction as any change to the cached data.
+check() compares that counter with the one seen when the cache was filled
+and discards the cache if it has changed, so a process that calls check()
+at the start of each request, as Wallet::Server does, will see changes
+made by other processes with the cost of one small query.  Changes made
+through Wallet::Admin and Wallet::ACL call invalidate() to increment the
+counter.
+
+All methods are class methods and throw exceptions on database errors.
+
+=head1 CLASS METHODS
+
+=over 4
+
+=item admin(SCHEMA)
+
+Returns a reference to a hash with keys C<id> and C<name> for the
+C<ADMIN> ACL, suitable for passing as the third argument to the new()
+method of Wallet::ACL, or undef if there is no such ACL.
+
+=item check(SCHEMA)
+
+Reads the generation counter for the database of the Wallet::Schema
+object SCHEMA and discards the cache for that database if the counter has
+changed since the cache was filled.
+
+=item clear(SCHEMA)
+
+Discards the cache of this process for the database of SCHEMA without
+changing the generation counter.
+
+=item invalidate(SCHEMA)
+
+Increments the generation counter, so that every process discards its
+cache at its next check(), and discards the cache of this process.  This
+should be called inside the transaction that changes the cached data.
+
+=item scheme_class(SCHEMA, SCHEME)
+
+Returns the class implementing the ACL scheme SCHEME, or undef if the
+scheme isn't registered.  This does not load the class.
+
+=item type_class(SCHEMA, TYPE)
+
+Returns the class implementing the object type TYPE, or undef if the type
+isn't registered.  This does not load the class.
+
+=back
+
+=head1 SEE ALSO
+
+Wallet::Admin(3), Wallet::Schema::Result::Generation(3), Wallet::Server(3)
+
+This module is part of the wallet system.  The current version is
+available from L<https://www.eyrie.org/~eagle/software/wallet/>.
+
+=cut
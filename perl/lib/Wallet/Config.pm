@@ -27,6 +27,7 @@ DBI DSN SQLite subdirectories KEYTAB keytab kadmind KDC add-ons kadmin DNS
 SRV kadmin keytabs remctl backend lowercased NETDB ACL NetDB unscoped
 usernames rekey hostnames Allbery wallet-backend keytab-backend Heimdal
 rekeys WebAuth WEBAUTH keyring LDAP DN GSS-API integrations msktutil CN DIT
+WAL fsync AES-GCM CryptX
 
 =head1 SYNOPSIS
 
@@ -177,6 +178,130 @@ backends, particularly SQLite, do not need this.
 
 our $DB_PASSWORD;
 
+=item DB_REPLICA_INFO
+
+Sets the remaining contents for the DBI DSN (everything after the driver)
+of a read-only replica of the wallet database, such as a streaming
+replica of a PostgreSQL database or a MySQL replica.  The replica is
+accessed with the same DB_DRIVER, DB_USER, and DB_PASSWORD as the primary
+database.  If this variable is set, the read-only server commands
+(C<check>, C<show>, C<history>, C<acl check>, C<acl history>, and C<acl
+show>) and all reports from B<wallet-report> are sent to the replica,
+leaving the primary database for commands that change the database.
+Within one Wallet::Server object, once anything has been changed in the
+primary database, later read-only commands are sent to the primary so
+that they see the change.  If the connection to the replica fails, the
+primary database is used instead.
+
+Since the replica may lag behind the primary, output from these commands
+may briefly not reflect changes made by other clients.  If this variable
+is not set, which is the default, all commands use the primary database.
+
+=cut
+
+our $DB_REPLICA_INFO;
+
+=item DB_RETRY_COUNT
+
+The number of times to retry a transaction that changes an object or an
+ACL if it fails because the database is locked by another connection or
+because it deadlocked or couldn't be serialized with a concurrent
+transaction.  Each retry waits a short, random, and increasing time first.
+Set this to 0 to disable retries.  The default value is 3.
+
+=cut
+
+our $DB_RETRY_COUNT = 3;
+
+=item DB_SQLITE_BUSY_TIMEOUT
+
+If DB_DRIVER is C<SQLite>, the number of milliseconds a connection will
+wait for a lock held by another connection before failing with a
+C<database is locked> error.  If not set, the default of the DBD::SQLite
+driver is used.
+
+=cut
+
+our $DB_SQLITE_BUSY_TIMEOUT;
+
+=item DB_SQLITE_JOURNAL_MODE
+
+If DB_DRIVER is C<SQLite>, the journal mode to set on the database, such
+as C<WAL>.  In WAL mode, readers don't block the writer and the writer
+doesn't block readers, which greatly reduces lock errors when many wallet
+server processes use the same database at once.  The WAL mode is stored
+in the database file, so it stays in effect for other programs using the
+database.  If not set, the journal mode is not changed.
+
+=cut
+
+our $DB_SQLITE_JOURNAL_MODE;
+
+=item DB_SQLITE_SYNCHRONOUS
+
+If DB_DRIVER is C<SQLite>, the synchronous setting to use for each
+connection, such as C<NORMAL> or C<FULL>.  C<NORMAL> is safe with the
+C<WAL> journal mode and avoids an fsync on every commit, at the risk of
+losing the most recent transactions (but not corrupting the database) on
+a power failure.  If not set, the SQLite default is used.
+
+=cut
+
+our $DB_SQLITE_SYNCHRONOUS;
+
+=back
+
+=head1 HISTORY CONFIGURATION
+
+By default, every get and store of an object immediately adds a row to the
+object history table and updates the download or store trace of the
+object in the same transaction.  On busy servers, these writes can instead
+be recorded in a local journal and applied to the database in batches.
+
+Old history can also be moved out of the database into compressed archive
+files with C<wallet-admin history archive>.
+
+=over 4
+
+=item HISTORY_ARCHIVE_DIR
+
+The directory in which to store history archived with C<wallet-admin
+history archive>.  Archived history is only shown by the C<history> and
+C<acl history> commands if the C<--archive> option is given.  This
+variable must be set to archive history.
+
+=cut
+
+our $HISTORY_ARCHIVE_DIR;
+
+=item HISTORY_JOURNAL
+
+If set, the path to a local file in which to record get and store actions
+on objects instead of writing them directly to the database.  The journal
+must then be flushed to the database periodically with C<wallet-admin
+history flush>, generally from cron or a similar scheduler.  Until it is
+flushed, the object history will still include actions in the journal,
+but the download and store information shown for the object will not
+reflect them.  The journal must be writable by the user running the wallet
+server.  If several wallet servers share a database, each server's journal
+must be flushed.
+
+=cut
+
+our $HISTORY_JOURNAL;
+
+=item HISTORY_JOURNAL_SYNC
+
+The number of records a process writes to HISTORY_JOURNAL before the
+journal is synced to disk.  Records are always synced when the process
+exits.  Larger values reduce the cost of recording many actions from one
+process at the risk of losing recent history in a system crash.  The
+default value is 1, which syncs after every record.
+
+=cut
+
+our $HISTORY_JOURNAL_SYNC = 1;
+
 =back
 
 =head1 DUO OBJECT CONFIGURATION
@@ -198,6 +323,39 @@ so that a test can run without needing a Duo account.
 
 our $DUO_AGENT;
 
+=item DUO_CACHE
+
+The directory in which to cache the secret keys of Duo integrations.  If
+this variable is set, the secret key of an integration is retrieved from
+Duo at most once every DUO_CACHE_TTL seconds rather than on every get,
+which avoids hitting the rate limits of the Duo Admin API when many
+systems retrieve their Duo configuration regularly.  Cached keys are also
+stored when an integration is created and removed when it is destroyed.
+
+Each key is stored in its own file, encrypted and authenticated with
+AES-GCM using a key derived from the secret key in DUO_KEY_FILE, so the
+cache can't be read without DUO_KEY_FILE and is ignored if the key in
+that file changes.  This requires the CryptX Perl module.  The directory
+should still only be readable by the user the wallet server runs as.  If
+this variable is not set, which is the default, secret keys are not
+cached.
+
+=cut
+
+our $DUO_CACHE;
+
+=item DUO_CACHE_TTL
+
+The number of seconds for which a secret key in DUO_CACHE is used before
+it is retrieved from Duo again.  This bounds how long a change made to an
+integration outside of the wallet, such as resetting its secret key in
+the Duo Admin Panel, takes to be seen.  The default value is 3600 (one
+hour).
+
+=cut
+
+our $DUO_CACHE_TTL = 3600;
+
 =item DUO_KEY_FILE
 
 The path to a file in JSON format that contains the key and hostname data
@@ -704,6 +862,37 @@ as an error.
 
 our $EXTERNAL_COMMAND;
 
+=item EXTERNAL_PERSISTENT
+
+If set to a true value, EXTERNAL_COMMAND is started once with no arguments
+and kept running for the life of the wallet server process, and each ACL
+check is sent to it as a request on its standard input rather than by
+running the command again.  This avoids the startup cost of the command
+for every check.  The default is false, which runs EXTERNAL_COMMAND once
+per check as described above.
+
+Each request is a single line containing the principal, the object type,
+the object name, and the ACL identifier, separated by tabs.  The command
+must answer each request with a single line on its standard output:
+C<yes> if access is granted, C<no> if access is denied, or any other text,
+which will be treated as an error message.  If the command exits or fails
+to answer within EXTERNAL_TIMEOUT seconds, it is stopped and will be
+restarted for the next check.
+
+=cut
+
+our $EXTERNAL_PERSISTENT;
+
+=item EXTERNAL_TIMEOUT
+
+The number of seconds to wait for a persistent external command (see
+EXTERNAL_PERSISTENT) to answer a request before treating the check as an
+error.  The default is 10 seconds.
+
+=cut
+
+our $EXTERNAL_TIMEOUT = 10;
+
 =back
 
 =head1 LDAP ACL CONFIGURATION
@@ -795,6 +984,18 @@ local usernames).
 
 =over 4
 
+=item NETDB_CACHE_TTL
+
+The number of seconds for which to cache the NetDB roles of a principal
+for a node.  Within that time, further checks of NetDB ACLs for the same
+principal and node in the same process will use the cached roles rather
+than querying NetDB again.  Set this to 0 to disable caching.  The default
+value is 60.
+
+=cut
+
+our $NETDB_CACHE_TTL = 60;
+
 =item NETDB_REALM
 
 The wallet uses fully-qualified principal names (including the realm), but
@@ -807,6 +1008,20 @@ to NetDB without modification.
 
 our $NETDB_REALM;
 
+=item NETDB_REMCTL_BATCH
+
+If set, the name of a C<netdb> remctl command on NETDB_REMCTL_HOST that
+takes a principal followed by one or more nodes and returns, for each
+node, a line containing the node name followed by the roles of that
+principal for that node, separated by whitespace.  When this variable is
+set, the roles for all of the nodes in an ACL are retrieved with a single
+remctl call.  By default, each node is looked up with a separate call to
+C<netdb node-roles>.
+
+=cut
+
+our $NETDB_REMCTL_BATCH;
+
 =item NETDB_REMCTL_CACHE
 
 Specifies the ticket cache to use when querying the NetDB remctl interface
@@ -958,6 +1173,29 @@ keytab objects for particular principals have fully-qualified hostnames:
 Objects that aren't of type C<keytab> or which aren't for a host-based key
 have no naming requirements enforced by this example.
 
+Naming audits of large databases can be slow if verify_name does much
+work for each object.  The following setting spreads an audit over
+several processes.
+
+=over 4
+
+=item AUDIT_WORKERS
+
+The number of worker processes to use for naming audits done via
+Wallet::Report.  The objects or ACLs are split into that many partitions,
+each checked by its own process, and the results are combined in the
+usual order.  The first object or ACL is checked before the workers are
+started, so anything that verify_name or verify_acl_name caches in Perl
+variables on its first call is loaded once and shared by all of the
+workers.  The default value is 1, which does the audit in a single
+process.
+
+=cut
+
+our $AUDIT_WORKERS = 1;
+
+=back
+
 =head1 OBJECT HOST-BASED NAMES
 
 The above demonstrates having a host-based naming convention, where we
@@ -986,6 +1224,28 @@ would be:
         return 0;
     }
 
+Searching for the objects of one host this way requires calling
+is_for_host for every object in the database.  A site can instead define
+a function named object_host, which takes an object type and name and
+returns the hostname that object is for, or undef if the object is not
+host-based.  If it exists, it is called whenever an object is created or
+renamed and its result is stored with the object, and objects_hostname
+looks up the stored host directly rather than calling is_for_host.  After
+defining object_host or changing the host mapping, run C<wallet-admin
+hosts backfill> to update the host stored for existing objects.  The
+equivalent of the above example would be:
+
+    sub object_host {
+        my ($type, $name) = @_;
+        my %host_based = map { $_ => 1 }
+            qw(HTTP cifs host imap ldap nfs pop sieve smtp webauth);
+        return unless $type eq 'keytab';
+        return unless $name =~ m%/%;
+        my ($service, $instance) = split ('/', $name, 2);
+        return unless $host_based{$service};
+        return $instance;
+    }
+
 =head1 ACL NAMING ENFORCEMENT
 
 Similar to object names, by default wallet permits administrators to
@@ -1029,6 +1289,40 @@ Obvious improvements could be made, such as checking that the part after
 the slash for a C<host/> ACL looked like a host name and the part after a
 slash for a C<user/> ACL look like a user name.
 
+=head1 POLICY DATABASE ACCESS
+
+The default_owner, verify_name, verify_acl_name, and is_for_host functions
+are passed two more arguments after the ones described above: the
+Wallet::Schema object for the database connection the wallet is already
+using, and a reference to a hash that the functions may use as a cache.
+Policy functions that need to look something up in the wallet database
+should use that schema rather than calling Wallet::Schema->connect, which
+opens a new database connection each time.
+
+The cache hash starts empty for each Wallet::Server or Wallet::Report
+object, which normally means for each request, and is shared by all of
+the policy functions, so use keys that won't collide with each other.  It
+is a good place to remember the results of lookups that may be repeated
+while handling one request.  Functions written for older versions of
+wallet that ignore these arguments continue to work.
+
+For example, this default_owner function gives file objects the same
+owner as the ACL named after their group, looking up that ACL only once
+per request:
+
+    sub default_owner {
+        my ($type, $name, $schema, $cache) = @_;
+        return unless $type eq 'file';
+        my ($group) = split ('/', $name);
+        my $acl_name = "group/$group";
+        unless ($cache->{members}{$acl_name}) {
+            my $acl = eval { Wallet::ACL->new ($acl_name, $schema) };
+            return unless $acl;
+            $cache->{members}{$acl_name} = [ $acl->list ];
+        }
+        return ($acl_name, @{ $cache->{members}{$acl_name} });
+    }
+
 =head1 ENVIRONMENT
 
 =over 4
@@ -0,0 +1,319 @@
+# Wallet::History -- Time-bounded, paginated reads of wallet history
+#
+# This module holds the support shared by the object history, ACL history,
+# and history report code for limiting history to a time range and a maximum
+# number of entries, and for reading history from the database in pages.
+#
+# Written by Russ Allbery <eagle@eyrie.org>
+# Copyright 2026 Russ Allbery <eagle@eyrie.org>
+#
+# SPDX-License-Identifier: MIT
+
+##############################################################################
+# Modules and declarations
+##############################################################################
+
+package Wallet::History;
+
+use 5.008;
+use strict;
+use warnings;
+
+use POSIX qw(strftime);
+use Time::Local qw(timegm);
+
+our $VERSION = '1.05';
+
+# The number of rows to read from the database at a time.
+our $PAGE_SIZE = 1000;
+
+##############################################################################
+# Constructor
+##############################################################################
+
+# Create a new history reader for the given schema and reference to a hash of
+# options.  The since and until options may be any date understood by
+# Date::Parse, and limit must be a positive integer.  Throws an exception if
+# any of the options are invalid.
+sub new {
+    my ($class, $schema, $options) = @_;
+    $options ||= {};
+    my $self = { schema => $schema, count => 0 };
+    for my $option (qw(since until)) {
+        my $value = $options->{$option};
+        next unless defined $value;
+        my $seconds = $value;
+        if ($value !~ /^\d+\z/) {
+            require Date::Parse;
+            $seconds = Date::Parse::str2time ($value);
+        }
+        die "invalid $option date $value\n" unless defined $seconds;
+        $self->{$option} = $seconds;
+    }
+    if (defined $options->{limit}) {
+        my $limit = $options->{limit};
+        die "invalid limit $limit\n" unless $limit =~ /^[1-9]\d*\z/;
+        $self->{limit} = $limit;
+    }
+    bless ($self, $class);
+    return $self;
+}
+
+##############################################################################
+# Range and limit checks
+##############################################################################
+
+# Returns true if the given time in seconds since epoch is within the range
+# requested by the since and until options.  since is inclusive and until is
+# exclusive.
+sub in_range {
+    my ($self, $time) = @_;
+    return 0 if (defined ($self->{since}) and $time < $self->{since});
+    return 0 if (defined ($self->{until}) and $time >= $self->{until});
+    return 1;
+}
+
+# Returns the requested since and until times in seconds since epoch, either
+# of which may be undef if not requested.
+sub range {
+    my ($self) = @_;
+    return ($self->{since}, $self->{until});
+}
+
+# Returns the search condition for the given timestamp column that limits it
+# to the requested range, or the empty list if no range was requested.
+sub range_search {
+    my ($self, $column) = @_;
+    my %range;
+    $range{'>='} = $self->date ($self->{since}) if defined $self->{since};
+    $range{'<'}  = $self->date ($self->{until}) if defined $self->{until};
+    return %range ? ($column => \%range) : ();
+}
+
+# Record that an entry is being returned.  Returns true if there is room for
+# more entries and false once the limit has been reached.
+sub add {
+    my ($self) = @_;
+    $self->{count}++;
+    return $self->more;
+}
+
+# Returns true if more entries should be returned.
+sub more {
+    my ($self) = @_;
+    return 1 unless defined $self->{limit};
+    return $self->{count} < $self->{limit};
+}
+
+##############################################################################
+# Database reads
+##############################################################################
+
+# Read the rows of the given result source that match the search and fall in
+# the requested time range, ordered by the given columns, and call the
+# callback with each row object.  The last column in the order must be
+# unique.  Rows are read a page at a time, starting each page after the last
+# row of the previous page rather than using an offset, so each page is a
+# short index range scan.  Stops when the callback returns false.  Throws an
+# exception on failure.
+sub search_rows {
+    my ($self, $source, $date, $search, $order, $callback) = @_;
+    my $rs = $self->{schema}->resultset ($source);
+    my %search = (%$search, $self->range_search ($date));
+    my @last;
+    while (1) {
+        my %where = %search;
+        if (@last) {
+            my @after;
+            for my $i (0 .. $#$order) {
+                my %key = map { $order->[$_] => $last[$_] } 0 .. $i - 1;
+                $key{$order->[$i]} = { '>' => $last[$i] };
+                push (@after, \%key);
+            }
+            $where{-or} = \@after;
+        }
+        my %attrs = (order_by => $order, rows => $PAGE_SIZE);
+        my @rows = $rs->search (\%where, \%attrs)->all;
+        for my $row (@rows) {
+            return unless $callback->($row);
+        }
+        return if @rows < $PAGE_SIZE;
+        @last = map { $rows[-1]->get_column ($_) } @$order;
+    }
+}
+
+# The same as search_rows, but call the callback with each row as a reference
+# to a hash of column names to inflated values and the row object.
+sub search {
+    my ($self, $source, $date, $search, $order, $callback) = @_;
+    my $each = sub {
+        my ($row) = @_;
+        my %data = $row->get_inflated_columns;
+        return $callback->(\%data, $row);
+    };
+    return $self->search_rows ($source, $date, $search, $order, $each);
+}
+
+##############################################################################
+# Utility functions
+##############################################################################
+
+# Convert a time in seconds since epoch to a timestamp in the form stored in
+# the database, which is in UTC.  Timestamps in this form can be passed to
+# DBIx::Class or in bind values without loading DateTime.
+sub date {
+    my ($self, $time) = @_;
+    return strftime ('%Y-%m-%d %H:%M:%S', gmtime $time);
+}
+
+# Convert a timestamp as returned by the database without inflation, which
+# is in UTC, to seconds since epoch.  This avoids creating a DateTime object
+# for each row when only the epoch time is needed.  Returns undef if the
+# value isn't a valid timestamp, such as the zero date MySQL may store, since
+# timegm throws an exception for those.
+sub epoch {
+    my ($self, $date) = @_;
+    return unless defined $date;
+    my $pattern = qr/^(\d{4})-(\d\d)-(\d\d)[ T](\d\d):(\d\d):(\d\d)/;
+    my ($year, $month, $day, $hour, $min, $sec) = ($date =~ $pattern);
+    return unless defined $year;
+    my $seconds = eval { timegm ($sec, $min, $hour, $day, $month - 1, $year) };
+    return $seconds;
+}
+
+1;
+__END__
+
+##############################################################################
+# Documentation
+##############################################################################
+
+=for stopwords
+DateTime Date::Parse keyset
+
+=head1 NAME
+
+Wallet::History - Time-bounded, paginated reads of wallet history
+
+=head1 SYNOPSIS
+
+    use Wallet::History;
+    my $history = Wallet::History->new ($schema, { since => '2020-01-01',
+                                                   limit => 100 });
+    my %search = (oh_type => $type, oh_name => $name);
+    $history->search ('ObjectHistory', 'oh_on', \%search, [qw(oh_on oh_id)],
+                      sub { print_row ($_[0]); return $history->add });
+
+=head1 DESCRIPTION
+
+Wallet::History provides the support shared by the object history, ACL
+history, and history report code for restricting history to a range of
+time and a maximum number of entries.  History is read from the database
+a page at a time using keyset pagination: each page is selected with a
+condition on the sort columns that starts after the last row of the
+previous page, so only one page is held in memory and each page can be
+read with an index range scan.
+
+=head1 CLASS METHODS
+
+=over 4
+
+=item new(SCHEMA[, OPTIONS])
+
+Creates a new history reader for the Wallet::Schema object SCHEMA.
+OPTIONS, if given, is a reference to a hash that may contain the
+following keys:
+
+=over 4
+
+=item since
+
+Only return history at or after this time, which may be in seconds since
+epoch or any format understood by Date::Parse.
+
+=item until
+
+Only return history before this time, which may be in seconds since epoch
+or any format understood by Date::Parse.
+
+=item limit
+
+Return at most this many entries.
+
+=back
+
+Throws an exception if any of the options are invalid.
+
+=back
+
+=head1 INSTANCE METHODS
+
+=over 4
+
+=item add()
+
+Records that an entry has been returned.  Returns true if more entries
+may be returned and false once the limit has been reached.
+
+=item in_range(TIME)
+
+Returns true if TIME, in seconds since epoch, is within the requested
+range and false otherwise.
+
+=item more()
+
+Returns true if more entries may be returned and false if the limit has
+been reached.
+
+=item range()
+
+Returns the requested since and until times, in seconds since epoch, as a
+list.  Either may be undef if that end of the range was not requested.
+
+=item range_search(COLUMN)
+
+Returns a search condition, suitable for adding to a DBIx::Class search
+hash, restricting the timestamp column COLUMN to the requested range, or
+the empty list if no range was requested.
+
+=item date(TIME)
+
+Converts TIME, in seconds since epoch, to a timestamp in UTC in the form
+C<YYYY-MM-DD HH:MM:SS>, which all of the supported databases accept for
+timestamp columns.  This can be stored with DBIx::Class or used in a
+search without creating a DateTime object.
+
+=item epoch(DATE)
+
+Converts DATE, a timestamp column value as returned by the database
+without inflation, to seconds since epoch, treating it as UTC as the
+wallet stores it.  Returns undef if DATE is undefined or isn't a valid
+timestamp, such as the C<0000-00-00 00:00:00> zero date MySQL may store.
+This is cheaper than inflating the column to a DateTime object.
+
+=item search(SOURCE, DATE, SEARCH, ORDER, CALLBACK)
+
+Reads the rows of the result source SOURCE that match the search hash
+SEARCH and whose timestamp column DATE is in the requested range, sorted
+by the columns in the array reference ORDER.  The last column in ORDER
+must be unique.  CALLBACK is called with each row as a reference to a
+hash of column names to inflated values and as the DBIx::Class row
+object, and reading stops when it returns false.  Throws an exception on
+failure.
+
+=item search_rows(SOURCE, DATE, SEARCH, ORDER, CALLBACK)
+
+The same as search(), except that CALLBACK is called with only the
+DBIx::Class row object, so the columns are not inflated unless the
+callback asks for them.
+
+=back
+
+=head1 SEE ALSO
+
+Wallet::ACL(3), Wallet::Object::Base(3), Wallet::Report(3)
+
+This module is part of the wallet system.  The current version is
+available from L<https://www.eyrie.org/~eagle/software/wallet/>.
+
+=cut
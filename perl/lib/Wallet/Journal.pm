@@ -0,0 +1,385 @@
+# Wallet::Journal -- Local journal of object get and store history
+#
+# This module maintains an append-only local file of get and store actions
+# on objects, which is periodically flushed into the object_history table
+# and the object trace fields.  It is used instead of writing those changes
+# directly to the database when HISTORY_JOURNAL is set.
+#
+# Written by Russ Allbery <eagle@eyrie.org>
+# Copyright 2026 Russ Allbery <eagle@eyrie.org>
+#
+# SPDX-License-Identifier: MIT
+
+##############################################################################
+# Modules and declarations
+##############################################################################
+
+package Wallet::Journal;
+
+use 5.008;
+use strict;
+use warnings;
+
+use Digest::MD5 qw(md5_hex);
+use Fcntl qw(:flock O_APPEND O_CREAT O_WRONLY);
+use IO::Handle;
+use Sys::Hostname qw(hostname);
+use Wallet::Config;
+use Wallet::History;
+
+our $VERSION = '1.05';
+
+# The fields of each journal record, in the order in which they're stored.
+our @FIELDS = qw(time action type name by from);
+
+##############################################################################
+# Constructor
+##############################################################################
+
+# Create a new journal object for the given path.  The journal file is not
+# opened until it's needed.
+sub new {
+    my ($class, $path) = @_;
+    die "no journal path specified\n" unless $path;
+    my $self = { path => $path, unsynced => 0 };
+    bless ($self, $class);
+    return $self;
+}
+
+# Make sure that any records we've written are on disk before exiting.
+sub DESTROY {
+    my ($self) = @_;
+    local $@;
+    eval { $self->sync };
+}
+
+##############################################################################
+# Encoding
+##############################################################################
+
+# Encode a journal record (a reference to a hash) as a line.  Characters that
+# would break the line format are escaped as %XX.
+sub encode {
+    my ($self, $record) = @_;
+    my @values = map { defined ($_) ? $_ : '' } @$record{@FIELDS};
+    for my $value (@values) {
+        $value =~ s/([%\t\n\r])/sprintf ('%%%02X', ord ($1))/ge;
+    }
+    return join ("\t", @values) . "\n";
+}
+
+# Decode a journal line into a reference to a hash.  Returns undef if the line
+# is malformed, which can happen with a partial write.
+sub decode {
+    my ($self, $line) = @_;
+    return unless $line =~ s/\n\z//;
+    my @values = split (/\t/, $line, -1);
+    return unless @values == @FIELDS;
+    for my $value (@values) {
+        $value =~ s/%([0-9A-F]{2})/chr (hex ($1))/ge;
+    }
+    my %record;
+    @record{@FIELDS} = @values;
+    return \%record;
+}
+
+# Read all of the records from an open file handle.  Flush markers are
+# skipped, since decode rejects them as malformed.
+sub read_records {
+    my ($self, $fh) = @_;
+    my @records;
+    while (defined (my $line = <$fh>)) {
+        my $record = $self->decode ($line);
+        push (@records, $record) if $record;
+    }
+    return @records;
+}
+
+# Read the records from an open file handle that haven't been flushed, given
+# the number of the last flush of this journal committed to the database.
+# The records before the marker of a committed flush are already in the
+# database; they are only still in the journal if the flush was interrupted
+# before the journal was truncated.
+sub unflushed_records {
+    my ($self, $fh, $flushed) = @_;
+    my @records;
+    while (defined (my $line = <$fh>)) {
+        if ($line =~ /^#flush\t(\d+)\n\z/) {
+            @records = () if $1 <= $flushed;
+            next;
+        }
+        my $record = $self->decode ($line);
+        push (@records, $record) if $record;
+    }
+    return @records;
+}
+
+# Return the name of the row in the generations table that counts the flushes
+# of this journal.  Each wallet server has its own journal, so the name is
+# derived from the host name and the journal path.
+sub counter {
+    my ($self) = @_;
+    my $id = md5_hex (hostname () . "\0" . $self->{path});
+    return 'journal-' . substr ($id, 0, 16);
+}
+
+##############################################################################
+# Interface
+##############################################################################
+
+# Append a record of a get or store action to the journal.  Takes the action,
+# the object type and name, and the trace information (user, host, and time).
+# The record is written immediately, but the file is only synced to disk
+# after HISTORY_JOURNAL_SYNC records (or when the object is destroyed).
+# Throws an exception on failure.
+sub append {
+    my ($self, $action, $type, $name, $user, $host, $time) = @_;
+    my %record = (time   => $time || time,
+                  action => $action,
+                  type   => $type,
+                  name   => $name,
+                  by     => $user,
+                  from   => $host);
+    unless ($self->{fh}) {
+        my $path = $self->{path};
+        sysopen ($self->{fh}, $path, O_WRONLY | O_APPEND | O_CREAT, 0600)
+            or die "cannot open journal $path: $!\n";
+        $self->{fh}->autoflush (1);
+    }
+    my $fh = $self->{fh};
+    flock ($fh, LOCK_EX) or die "cannot lock journal $self->{path}: $!\n";
+    my $status = print {$fh} $self->encode (\%record);
+    flock ($fh, LOCK_UN);
+    die "cannot write to journal $self->{path}: $!\n" unless $status;
+    $self->{unsynced}++;
+    my $batch = $Wallet::Config::HISTORY_JOURNAL_SYNC;
+    if (defined ($batch) and $self->{unsynced} >= $batch) {
+        $self->sync;
+    }
+    return 1;
+}
+
+# Sync any records we've written to disk.  Throws an exception on failure.
+sub sync {
+    my ($self) = @_;
+    return 1 unless ($self->{fh} and $self->{unsynced});
+    $self->{fh}->sync or die "cannot sync journal $self->{path}: $!\n";
+    $self->{unsynced} = 0;
+    return 1;
+}
+
+# Return the pending records in the journal, in the order in which they were
+# written, as references to hashes.  If a type and name are given, return
+# only the records for that object.  Throws an exception on failure.
+sub entries {
+    my ($self, $type, $name) = @_;
+    my $path = $self->{path};
+    my $fh;
+    unless (open ($fh, '<', $path)) {
+        return if $!{ENOENT};
+        die "cannot open journal $path: $!\n";
+    }
+    flock ($fh, LOCK_SH) or die "cannot lock journal $path: $!\n";
+    my @records = $self->read_records ($fh);
+    close $fh;
+    if (defined $type) {
+        @records = grep { $_->{type} eq $type and $_->{name} eq $name }
+            @records;
+    }
+    return @records;
+}
+
+# Empty the journal once its records have been committed to the database.
+# Throws an exception on failure.
+sub discard {
+    my ($self, $fh) = @_;
+    truncate ($fh, 0) or die "cannot truncate journal $self->{path}: $!\n";
+    return 1;
+}
+
+# Flush the journal into the database.  All pending records are inserted into
+# the object_history table in one bulk insert, and then the trace fields of
+# each object are updated from the latest get and store record for that
+# object.  The journal is locked for the duration so that no records are
+# added while we flush.
+#
+# So that a flush interrupted after committing but before truncating the
+# journal isn't repeated, each flush is numbered.  A marker with its number
+# is appended to the journal before the database changes, and the number is
+# stored in the generations table in the same transaction as those changes.
+# Records before the marker of a committed flush are then skipped.  Returns
+# the number of records flushed and throws an exception on failure.
+sub flush {
+    my ($self, $schema) = @_;
+    my $path = $self->{path};
+    my $fh;
+    unless (open ($fh, '+<', $path)) {
+        return 0 if $!{ENOENT};
+        die "cannot open journal $path: $!\n";
+    }
+    flock ($fh, LOCK_EX) or die "cannot lock journal $path: $!\n";
+    my $guard = $schema->txn_scope_guard;
+    my $name = $self->counter;
+    my $rs = $schema->resultset('Generation');
+    my $counter = $rs->find ({ ge_name => $name });
+    my $flushed = $counter ? $counter->ge_generation : 0;
+    my @records = $self->unflushed_records ($fh, $flushed);
+    unless (@records) {
+        $guard->commit;
+        $self->discard ($fh) if -s $fh;
+        close $fh;
+        return 0;
+    }
+
+    # Mark the end of this flush in the journal, starting a new line if the
+    # journal ends with a partial record.
+    my $batch = $flushed + 1;
+    seek ($fh, -1, 2) or die "cannot seek in journal $path: $!\n";
+    my $last = getc ($fh);
+    seek ($fh, 0, 2) or die "cannot seek in journal $path: $!\n";
+    my $marker = ($last eq "\n" ? '' : "\n") . "#flush\t$batch\n";
+    print {$fh} $marker or die "cannot write to journal $path: $!\n";
+    $fh->flush or die "cannot write to journal $path: $!\n";
+    $fh->sync or die "cannot sync journal $path: $!\n";
+
+    # Convert the timestamps to the database format once, since we bypass
+    # the usual column inflation for the bulk insert.
+    my (@rows, %latest);
+    for my $record (@records) {
+        $record->{date} = Wallet::History->date ($record->{time});
+        push (@rows, [ @$record{qw(type name action by from date)} ]);
+        my $key = join ("\0", @$record{qw(action type name)});
+        if (!$latest{$key} or $latest{$key}{time} <= $record->{time}) {
+            $latest{$key} = $record;
+        }
+    }
+
+    # Insert the history, apply the latest trace to each object, and record
+    # that this flush was committed.
+    my @columns = qw(oh_type oh_name oh_action oh_by oh_from oh_on);
+    $schema->resultset('ObjectHistory')->populate ([ \@columns, @rows ]);
+    for my $key (sort keys %latest) {
+        my $record = $latest{$key};
+        my $prefix = ($record->{action} eq 'get') ? 'downloaded' : 'stored';
+        my %search = (ob_type => $record->{type},
+                      ob_name => $record->{name});
+        my %update = ("ob_${prefix}_by"   => $record->{by},
+                      "ob_${prefix}_from" => $record->{from},
+                      "ob_${prefix}_on"   => $record->{date});
+        $schema->resultset('Object')->search (\%search)->update (\%update);
+    }
+    if ($counter) {
+        $counter->update ({ ge_generation => $batch });
+    } else {
+        $rs->create ({ ge_name => $name, ge_generation => $batch });
+    }
+    $guard->commit;
+
+    # Only discard the journal once the database changes are committed.
+    $self->discard ($fh);
+    close $fh;
+    return scalar (@records);
+}
+
+1;
+__END__
+
+##############################################################################
+# Documentation
+##############################################################################
+
+=for stopwords
+fsync DateTime
+
+=head1 NAME
+
+Wallet::Journal - Local journal of object get and store history
+
+=head1 SYNOPSIS
+
+    use Wallet::Journal;
+    my $journal = Wallet::Journal->new ($path);
+    $journal->append ('get', $type, $name, $user, $host, time);
+    my @pending = $journal->entries ($type, $name);
+    my $count = $journal->flush ($schema);
+
+=head1 DESCRIPTION
+
+Wallet::Journal maintains an append-only local file recording get and
+store actions on wallet objects.  When HISTORY_JOURNAL is set in
+Wallet::Config, Wallet::Object::Base records those actions in the journal
+rather than updating the database for each action, and the journal is
+periodically flushed into the database with C<wallet-admin history flush>.
+
+Each line in the journal is one record: the time in seconds since epoch,
+the action, the object type, the object name, the user, and the host,
+separated by tabs.  Any percent signs, tabs, carriage returns, or newlines
+in a field are encoded as C<%> followed by two hexadecimal digits.  The
+journal may also contain flush markers, lines consisting of C<#flush>, a
+tab, and a flush number, written by flush().
+
+=head1 CLASS METHODS
+
+=over 4
+
+=item new(PATH)
+
+Creates a new journal object for the journal file PATH.  The file is
+created when the first record is appended.
+
+=back
+
+=head1 INSTANCE METHODS
+
+=over 4
+
+=item append(ACTION, TYPE, NAME, PRINCIPAL, HOSTNAME, DATETIME)
+
+Appends a record of ACTION (either C<get> or C<store>) on the object of
+type TYPE and name NAME to the journal.  The record is written to the
+file immediately, but the file is only synced to disk after
+HISTORY_JOURNAL_SYNC records have been written through this object or
+when the object is destroyed.  Throws an exception on failure.
+
+=item entries([TYPE, NAME])
+
+Returns the records in the journal that have not yet been flushed, in the
+order in which they were written.  Each record is a reference to a hash
+with keys C<time>, C<action>, C<type>, C<name>, C<by>, and C<from>.  If
+TYPE and NAME are given, only records for that object are returned.
+Throws an exception on failure.
+
+=item flush(SCHEMA)
+
+Flushes the journal into the database using the Wallet::Schema object
+SCHEMA.  All pending records are inserted into the object_history table
+with one bulk insert, and then the download or store trace fields of each
+object are set from the latest get or store record for that object.  The
+journal is then truncated.  Returns the number of records flushed and
+throws an exception on failure.
+
+The journal is locked while flushing, so processes recording actions will
+wait until the flush is complete.  Flushes are numbered, with a separate
+count for each host and journal path kept in a row of the generations
+table.  Before changing the database, flush() appends a marker with the
+number of the new flush to the journal.  It then records that number in
+the same transaction as the history.  If the flushing process is killed
+after committing the database changes but before truncating the journal,
+the next flush skips the records before that marker, so they are not
+added to the history twice.  Until then, entries() still returns them.
+
+=item sync()
+
+Syncs any records written through this object to disk.  Throws an
+exception on failure.
+
+=back
+
+=head1 SEE ALSO
+
+wallet-admin(8), Wallet::Config(3), Wallet::Object::Base(3)
+
+This module is part of the wallet system.  The current version is
+available from L<https://www.eyrie.org/~eagle/software/wallet/>.
+
+=cut
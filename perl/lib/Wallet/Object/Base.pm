@@ -17,10 +17,11 @@ use 5.008;
 use strict;
 use warnings;
 
-use DateTime;
-use Date::Parse qw(str2time);
-use Text::Wrap qw(wrap);
+use POSIX qw(strftime);
 use Wallet::ACL;
+use Wallet::Config;
+use Wallet::History;
+use Wallet::Query;
 
 our $VERSION = '1.05';
 
@@ -31,21 +32,28 @@ our $VERSION = '1.05';
 # Initialize an object from the database.  Verifies that the object already
 # exists with the given type, and if it does, returns a new blessed object of
 # the specified class.  Stores the database handle to use, the name, and the
-# type in the object.  If the object doesn't exist, returns undef.  This will
-# probably be usable as-is by most object types.
+# type in the object.  If the object doesn't exist, dies.  This will probably
+# be usable as-is by most object types.
+#
+# The object row, its flags, and its type-specific data are loaded with one
+# query and kept in the object for its life; see _load.  If the caller has
+# already loaded the object with Wallet::Query, it can pass the loaded data
+# as the fourth argument.  The lookup is then skipped and the loaded flags
+# are kept, and the rest is loaded the first time it's needed.
 sub new {
-    my ($class, $type, $name, $schema) = @_;
-    my %search = (ob_type => $type,
-                  ob_name => $name);
-    my $object = $schema->resultset('Object')->find (\%search);
-    die "cannot find ${type}:${name}\n"
-        unless ($object and $object->ob_name eq $name);
+    my ($class, $type, $name, $schema, $loaded) = @_;
     my $self = {
         schema => $schema,
         name   => $name,
         type   => $type,
     };
     bless ($self, $class);
+    if ($loaded) {
+        $self->{id} = $loaded->{ob_id};
+        $self->{flags} = { %{ $loaded->{flags} } };
+    } else {
+        $self->_load;
+    }
     return $self;
 }
 
@@ -58,15 +66,18 @@ sub create {
     $time ||= time;
     die "invalid object type\n" unless $type;
     die "invalid object name\n" unless $name;
-    my $guard = $schema->txn_scope_guard;
-    eval {
-        my $date = DateTime->from_epoch (epoch => $time);
+    my $id;
+    my $code = sub {
+        my $guard = $schema->txn_scope_guard;
+        my $date = Wallet::History->date ($time);
         my %record = (ob_type         => $type,
                       ob_name         => $name,
                       ob_created_by   => $user,
                       ob_created_from => $host,
-                      ob_created_on   => $date);
-        $schema->resultset('Object')->create (\%record);
+                      ob_created_on   => $date,
+                      ob_host         => $class->host_for ($type, $name));
+        my $object = $schema->resultset('Object')->create (\%record);
+        $id = $object->ob_id;
         %record = (oh_type   => $type,
                    oh_name   => $name,
                    oh_action => 'create',
@@ -76,6 +87,7 @@ sub create {
         $schema->resultset('ObjectHistory')->create (\%record);
         $guard->commit;
     };
+    eval { $schema->txn_retry ($code) };
     if ($@) {
         die "cannot create object ${type}:${name}: $@\n";
     }
@@ -83,11 +95,61 @@ sub create {
         schema => $schema,
         name   => $name,
         type   => $type,
+        id     => $id,
+        flags  => {},
     };
     bless ($self, $class);
     return $self;
 }
 
+##############################################################################
+# Cached data
+##############################################################################
+
+# The relationships of Wallet::Schema::Result::Object holding type-specific
+# data for this class, which are loaded along with the object.  Subclasses
+# that store data in their own tables should override this.
+sub type_data_relations {
+    return ();
+}
+
+# Load the object row, its flags, and the rows of its type-specific data
+# relationships with a single prefetching query and cache them in the object,
+# replacing anything cached before.  The columns are kept as stored in the
+# database and each type-specific relationship as a list of hashes of
+# columns.  Dies if the object doesn't exist or on a database error.
+sub _load {
+    my ($self) = @_;
+    my $name = $self->{name};
+    my $type = $self->{type};
+    my @relations = $self->type_data_relations;
+    my %search = (ob_type => $type,
+                  ob_name => $name);
+    my %attrs = (prefetch => [ 'flags', @relations ]);
+    my $object = $self->{schema}->resultset('Object')->find (\%search,
+                                                            \%attrs);
+    die "cannot find ${type}:${name}\n"
+        unless ($object and $object->ob_name eq $name);
+    $self->{id} = $object->ob_id;
+    $self->{columns} = { $object->get_columns };
+    $self->{flags} = { map { $_->fl_flag => 1 } $object->flags };
+    $self->{type_data} = {};
+    for my $relation (@relations) {
+        my @rows = grep { defined } $object->$relation;
+        $self->{type_data}{$relation} = [ map { { $_->get_columns } } @rows ];
+    }
+    return 1;
+}
+
+# Return the cached rows of one of the type-specific data relationships of
+# this class as a list of references to hashes of columns, loading the object
+# if it hasn't been loaded yet.  Dies on a database error.
+sub type_data {
+    my ($self, $relation) = @_;
+    $self->_load unless $self->{type_data};
+    return @{ $self->{type_data}{$relation} || [] };
+}
+
 ##############################################################################
 # Utility functions
 ##############################################################################
@@ -116,6 +178,39 @@ sub name {
     return $self->{name};
 }
 
+# Returns the numeric ID of the object, loading the object if it was created
+# from data that didn't include it.  Dies on a database error.
+sub id {
+    my ($self) = @_;
+    $self->_load unless defined $self->{id};
+    return $self->{id};
+}
+
+# Returns the host that the object with the given type and name is for, as
+# determined by the object_host function in the wallet configuration, or
+# undef if there is no such function or the object isn't host-based.  This
+# is stored with the object so that host-based reports can search on it.
+sub host_for {
+    my ($class, $type, $name) = @_;
+    return unless defined &Wallet::Config::object_host;
+    my $host = Wallet::Config::object_host ($type, $name);
+    return $host ? $host : undef;
+}
+
+# Return the Wallet::Journal object for the history journal, or undef if
+# history should be written directly to the database.  Journal objects are
+# kept for the life of the process so that syncs can be batched.
+{
+    my %journal;
+    sub journal {
+        my $path = $Wallet::Config::HISTORY_JOURNAL;
+        return unless $path;
+        require Wallet::Journal;
+        $journal{$path} ||= Wallet::Journal->new ($path);
+        return $journal{$path};
+    }
+}
+
 # Record a global object action for this object.  Takes the action (which must
 # be one of get or store), and the trace information: user, host, and time.
 # Returns true on success and false on failure, setting error appropriately.
@@ -129,41 +224,44 @@ sub log_action {
         return;
     }
 
+    # If we're using a journal, just record the action there.
+    my $journal = $self->journal;
+    if ($journal) {
+        my ($type, $name) = ($self->{type}, $self->{name});
+        eval { $journal->append ($action, $type, $name, $user, $host, $time) };
+        if ($@) {
+            $self->error ("cannot update history for $type:$name: $@");
+            return;
+        }
+        return 1;
+    }
+
     # We have two traces to record, one in the object_history table and one in
     # the object record itself.  Commit both changes as a transaction.  We
     # assume that AutoCommit is turned off.
-    my $guard = $self->{schema}->txn_scope_guard;
-    eval {
-        my $date = DateTime->from_epoch (epoch => $time);
-        my %record = (oh_type   => $self->{type},
-                      oh_name   => $self->{name},
-                      oh_action => $action,
-                      oh_by     => $user,
-                      oh_from   => $host,
-                      oh_on     => $date);
-        $self->{schema}->resultset('ObjectHistory')->create (\%record);
-
-        # Add in more timestamps based on the action type.
-        my %search = (ob_type   => $self->{type},
-                      ob_name   => $self->{name});
-        my $object = $self->{schema}->resultset('Object')->find (\%search);
-        if ($action eq 'get') {
-            $object->ob_downloaded_by   ($user);
-            $object->ob_downloaded_from ($host);
-            $object->ob_downloaded_on   ($date);
-        } elsif ($action eq 'store') {
-            $object->ob_stored_by   ($user);
-            $object->ob_stored_from ($host);
-            $object->ob_stored_on   ($date);
-        }
-        $object->update;
+    # These are the most common writes, so use the prepared statements in
+    # Wallet::Query rather than loading the object row.
+    my $code = sub {
+        my $guard = $self->{schema}->txn_scope_guard;
+        my $query = Wallet::Query->new ($self->{schema});
+        $query->log_action ($action, $self->{type}, $self->{name}, $user,
+                            $host, $time);
         $guard->commit;
     };
+    eval { $self->{schema}->txn_retry ($code) };
     if ($@) {
         my $id = $self->{type} . ':' . $self->{name};
         $self->error ("cannot update history for $id: $@");
         return;
     }
+
+    # Keep the cached trace fields in sync with the database.
+    if ($self->{columns}) {
+        my $prefix = ($action eq 'get') ? 'ob_downloaded' : 'ob_stored';
+        $self->{columns}{"${prefix}_by"}   = $user;
+        $self->{columns}{"${prefix}_from"} = $host;
+        $self->{columns}{"${prefix}_on"}   = Wallet::History->date ($time);
+    }
     return 1;
 }
 
@@ -188,7 +286,7 @@ sub log_set {
         die "invalid history field $field";
     }
 
-    my $date = DateTime->from_epoch (epoch => $time);
+    my $date = Wallet::History->date ($time);
     my %record = (oh_type       => $self->{type},
                   oh_name       => $self->{name},
                   oh_action     => 'set',
@@ -207,7 +305,10 @@ sub log_set {
 ##############################################################################
 
 # Set a particular attribute.  Takes the attribute to set and its new value.
-# Returns undef on failure and true on success.
+# Returns undef on failure and true on success.  The value of a timestamp
+# attribute is given in seconds since epoch and is recorded in the history in
+# local time, so no DateTime objects are needed.  The old value is taken from
+# the cached object row, which is updated once the change is committed.
 sub _set_internal {
     my ($self, $attr, $value, $user, $host, $time) = @_;
     if ($attr !~ /^[a-z_]+\z/) {
@@ -222,27 +323,31 @@ sub _set_internal {
         return;
     }
 
-    my $guard = $self->{schema}->txn_scope_guard;
-    eval {
-        my %search = (ob_type => $type,
-                      ob_name => $name);
-        my $object = $self->{schema}->resultset('Object')->find (\%search);
+    my $code = sub {
+        my $guard = $self->{schema}->txn_scope_guard;
+        $self->_load unless $self->{columns};
         my $column = "ob_$attr";
-        my $old = $object->$column;
+        my $info = $self->{schema}->source ('Object')->column_info ($column);
+        my $old = $self->{columns}{$column};
         my $new = $value;
-        $object->update ({ $column => $value });
-
-        if (ref ($old) && $old->isa ('DateTime')) {
-            $old->set_time_zone ('local');
-            $old = $old->ymd . q{ } . $old->hms;
-        }
-        if (ref ($new) && $new->isa ('DateTime')) {
-            $new->set_time_zone ('local');
-            $new = $new->ymd . q{ } . $new->hms;
+        if ($info->{data_type} eq 'datetime') {
+            my $seconds = Wallet::History->epoch ($old);
+            $old = defined ($seconds) ? Wallet::History->date ($seconds)
+                                      : undef;
+            if (defined $value) {
+                $value = Wallet::History->date ($value);
+                $new = strftime ('%Y-%m-%d %H:%M:%S', localtime $new);
+            }
         }
+        my %search = (ob_type => $type,
+                      ob_name => $name);
+        $self->{schema}->resultset('Object')->search (\%search)
+            ->update ({ $column => $value });
         $self->log_set ($attr, $old, $new, $user, $host, $time);
         $guard->commit;
+        $self->{columns}{$column} = $value;
     };
+    eval { $self->{schema}->txn_retry ($code) };
     if ($@) {
         my $id = $self->{type} . ':' . $self->{name};
         $self->error ("cannot set $attr on $id: $@");
@@ -253,7 +358,9 @@ sub _set_internal {
 
 # Get a particular attribute.  Returns the attribute value or undef if the
 # value isn't set or on a database error.  The two cases can be distinguished
-# by whether $self->{error} is set.
+# by whether $self->{error} is set.  Timestamps are returned as stored in the
+# database rather than inflated to DateTime objects.  The value comes from the
+# cached object row, which is loaded if necessary.
 sub _get_internal {
     my ($self, $attr) = @_;
     undef $self->{error};
@@ -262,14 +369,11 @@ sub _get_internal {
         return;
     }
     $attr = 'ob_' . $attr;
-    my $name = $self->{name};
-    my $type = $self->{type};
     my $value;
     eval {
-        my %search = (ob_type => $type,
-                      ob_name => $name);
-        my $object = $self->{schema}->resultset('Object')->find (\%search);
-        $value = $object->$attr;
+        $self->_load unless $self->{columns};
+        die "no such column $attr\n" unless exists $self->{columns}{$attr};
+        $value = $self->{columns}{$attr};
     };
     if ($@) {
         $self->error ($@);
@@ -348,20 +452,20 @@ sub comment {
 sub expires {
     my ($self, $expires, $user, $host, $time) = @_;
     if ($expires) {
-        my $seconds = str2time ($expires);
+        require Date::Parse;
+        my $seconds = Date::Parse::str2time ($expires);
         unless (defined $seconds) {
             $self->error ("malformed expiration time $expires");
             return;
         }
-        my $date = DateTime->from_epoch (epoch => $seconds);
-        return $self->_set_internal ('expires', $date, $user, $host, $time);
+        return $self->_set_internal ('expires', $seconds, $user, $host, $time);
     } elsif (defined $expires) {
         return $self->_set_internal ('expires', undef, $user, $host, $time);
     } else {
         my $date = $self->_get_internal ('expires');
-        if (defined $date) {
-            $date->set_time_zone ('local');
-            return $date->ymd . q{ } . $date->hms;
+        my $seconds = Wallet::History->epoch ($date);
+        if (defined $seconds) {
+            return Wallet::History->date ($seconds);
         } else {
             return;
         }
@@ -399,30 +503,17 @@ sub owner {
 ##############################################################################
 
 # Check whether a flag is set on the object.  Returns true if set, 0 if not
-# set, and undef on error.
+# set, and undef on error.  The flags are loaded with the object and kept up
+# to date by flag_set and flag_clear, so this normally needs no query.
 sub flag_check {
     my ($self, $flag) = @_;
-    my $name = $self->{name};
-    my $type = $self->{type};
-    my $schema = $self->{schema};
-    my $value;
-    eval {
-        my %search = (fl_type => $type,
-                      fl_name => $name,
-                      fl_flag => $flag);
-        my $flag = $schema->resultset('Flag')->find (\%search);
-        if (not defined $flag) {
-            $value = 0;
-        } else {
-            $value = $flag->fl_flag;
-        }
-    };
+    eval { $self->_load unless $self->{flags} };
     if ($@) {
-        $self->error ("cannot check flag $flag for ${type}:${name}: $@");
+        my $id = $self->{type} . ':' . $self->{name};
+        $self->error ("cannot check flag $flag for $id: $@");
         return;
-    } else {
-        return ($value) ? 1 : 0;
     }
+    return $self->{flags}{$flag} ? 1 : 0;
 }
 
 # Clear a flag on an object.  Takes the flag and trace information.  Returns
@@ -433,11 +524,10 @@ sub flag_clear {
     my $name = $self->{name};
     my $type = $self->{type};
     my $schema = $self->{schema};
-    my $guard = $schema->txn_scope_guard;
-    eval {
-        my %search = (fl_type => $type,
-                      fl_name => $name,
-                      fl_flag => $flag);
+    my $code = sub {
+        my $guard = $schema->txn_scope_guard;
+        my %search = (fl_object => $self->id,
+                      fl_flag   => $flag);
         my $flag = $schema->resultset('Flag')->find (\%search);
         unless (defined $flag) {
             die "flag not set\n";
@@ -446,10 +536,12 @@ sub flag_clear {
         $self->log_set ('flags', $flag->fl_flag, undef, $user, $host, $time);
         $guard->commit;
     };
+    eval { $schema->txn_retry ($code) };
     if ($@) {
         $self->error ("cannot clear flag $flag on ${type}:${name}: $@");
         return;
     }
+    delete $self->{flags}{$flag};
     return 1;
 }
 
@@ -459,24 +551,13 @@ sub flag_clear {
 sub flag_list {
     my ($self) = @_;
     undef $self->{error};
-    my @flags;
-    eval {
-        my %search = (fl_type => $self->{type},
-                      fl_name => $self->{name});
-        my %attrs  = (order_by => 'fl_flag');
-        my @flags_rs = $self->{schema}->resultset('Flag')->search (\%search,
-                                                                   \%attrs);
-        for my $flag (@flags_rs) {
-            push (@flags, $flag->fl_flag);
-        }
-    };
+    eval { $self->_load unless $self->{flags} };
     if ($@) {
         my $id = $self->{type} . ':' . $self->{name};
         $self->error ("cannot retrieve flags for $id: $@");
         return;
-    } else {
-        return @flags;
     }
+    return sort keys %{ $self->{flags} };
 }
 
 # Set a flag on an object.  Takes the flag and trace information.  Returns
@@ -487,11 +568,10 @@ sub flag_set {
     my $name = $self->{name};
     my $type = $self->{type};
     my $schema = $self->{schema};
-    my $guard = $schema->txn_scope_guard;
-    eval {
-        my %search = (fl_type => $type,
-                      fl_name => $name,
-                      fl_flag => $flag);
+    my $code = sub {
+        my $guard = $schema->txn_scope_guard;
+        my %search = (fl_object => $self->id,
+                      fl_flag   => $flag);
         my $flag = $schema->resultset('Flag')->find (\%search);
         if (defined $flag) {
             die "flag already set\n";
@@ -500,10 +580,12 @@ sub flag_set {
         $self->log_set ('flags', undef, $flag->fl_flag, $user, $host, $time);
         $guard->commit;
     };
+    eval { $schema->txn_retry ($code) };
     if ($@) {
         $self->error ("cannot set flag $flag on ${type}:${name}: $@");
         return;
     }
+    $self->{flags}{$flag} = 1;
     return 1;
 }
 
@@ -512,10 +594,16 @@ sub flag_set {
 ##############################################################################
 
 # Expand a given ACL id to add its name, for readability.  Returns the
-# original id alone if there was a problem finding the name.
+# original id alone if there was a problem finding the name.  Takes an
+# optional reference to a hash of ACL ids to names, as returned by the
+# acl_names method of Wallet::Query, to use instead of looking up the name.
 sub format_acl_id {
-    my ($self, $id) = @_;
+    my ($self, $id, $names) = @_;
     my $name = $id;
+    if ($names) {
+        $name = $names->{$id} . " ($id)" if defined $names->{$id};
+        return $name;
+    }
 
     my %search = (ac_id => $id);
     my $acl_rs = $self->{schema}->resultset('Acl')->find (\%search);
@@ -526,68 +614,157 @@ sub format_acl_id {
     return $name;
 }
 
-# Return the formatted history for a given object or undef on error.
-# Currently always returns the complete history, but eventually will need to
-# provide some way of showing only recent entries.
+# Given a list of object history rows, return a reference to a hash mapping
+# the ids of all ACLs they refer to to their names, looked up with one query.
+# Dies on a database error.
+sub history_acl_names {
+    my ($self, @rows) = @_;
+    my @ids;
+    for my $row (@rows) {
+        next unless defined $row->{oh_field};
+        next unless ($row->{oh_field} eq 'owner'
+                     or $row->{oh_field} =~ /^acl_/);
+        for my $id ($row->{oh_old}, $row->{oh_new}) {
+            push (@ids, $id) if (defined $id and $id =~ /^\d+\z/);
+        }
+    }
+    return {} unless @ids;
+    my %names = Wallet::Query->new ($self->{schema})->acl_names (@ids);
+    return \%names;
+}
+
+# Convert a pending action from the history journal into the same form as an
+# object history row.  Database timestamps are stored and displayed without
+# conversion from UTC, so do the same here.
+sub journal_history_row {
+    my ($self, $entry) = @_;
+    require DateTime;
+    my $date = DateTime->from_epoch (epoch     => $entry->{time},
+                                     time_zone => 'floating');
+    my %row = (oh_action => $entry->{action},
+               oh_by     => $entry->{by},
+               oh_from   => $entry->{from},
+               oh_on     => $date);
+    return \%row;
+}
+
+# Format one object history row, given as a reference to a hash of column
+# names to values with the timestamp as a DateTime object.  Takes an optional
+# reference to a hash of ACL ids to names to pass to format_acl_id.
+sub format_history_row {
+    my ($self, $row, $names) = @_;
+    my $date = $row->{oh_on};
+    $date->set_time_zone ('local');
+    my $output = sprintf ("%s %s  ", $date->ymd, $date->hms);
+
+    my $old    = $row->{oh_old};
+    my $new    = $row->{oh_new};
+    my $action = $row->{oh_action};
+    my $field  = $row->{oh_field};
+
+    if ($action eq 'set' and $field eq 'flags') {
+        if (defined ($new)) {
+            $output .= "set flag $new";
+        } elsif (defined ($old)) {
+            $output .= "clear flag $old";
+        }
+    } elsif ($action eq 'set' and $field eq 'type_data') {
+        my $attr = $row->{oh_type_field};
+        if (defined ($old) and defined ($new)) {
+            $output .= "set attribute $attr to $new (was $old)";
+        } elsif (defined ($old)) {
+            $output .= "remove $old from attribute $attr";
+        } elsif (defined ($new)) {
+            $output .= "add $new to attribute $attr";
+        }
+    } elsif ($action eq 'set'
+             and ($field eq 'owner' or $field =~ /^acl_/)) {
+        $old = $self->format_acl_id ($old, $names) if defined ($old);
+        $new = $self->format_acl_id ($new, $names) if defined ($new);
+        if (defined ($old) and defined ($new)) {
+            $output .= "set $field to $new (was $old)";
+        } elsif (defined ($new)) {
+            $output .= "set $field to $new";
+        } elsif (defined ($old)) {
+            $output .= "unset $field (was $old)";
+        }
+    } elsif ($action eq 'set') {
+        if (defined ($old) and defined ($new)) {
+            $output .= "set $field to $new (was $old)";
+        } elsif (defined ($new)) {
+            $output .= "set $field to $new";
+        } elsif (defined ($old)) {
+            $output .= "unset $field (was $old)";
+        }
+    } else {
+        $output .= $action;
+    }
+    $output .= sprintf ("\n    by %s from %s\n", $row->{oh_by},
+                        $row->{oh_from});
+    return $output;
+}
+
+# Return the formatted history for a given object or undef on error.  Takes
+# an optional reference to a hash of options.  If the archive option is set,
+# history moved to the archive by wallet-admin history archive is included.
+# The since, until, and limit options restrict the history to a range of time
+# and a maximum number of entries, as described in Wallet::History.  Actions
+# still pending in the history journal are merged in by timestamp.  The rows
+# are collected first so that the names of all the ACLs they refer to can be
+# looked up at once.
 sub history {
-    my ($self) = @_;
+    my ($self, $options) = @_;
+    $options ||= {};
     my $output = '';
     eval {
+        my @rows;
+        my $history = Wallet::History->new ($self->{schema}, $options);
         my %search = (oh_type => $self->{type},
                       oh_name => $self->{name});
-        my %attrs = (order_by => 'oh_id');
-        my @history = $self->{schema}->resultset('ObjectHistory')
-            ->search (\%search, \%attrs);
-
-        for my $history_rs (@history) {
-            my $date = $history_rs->oh_on;
-            $date->set_time_zone ('local');
-            $output .= sprintf ("%s %s  ", $date->ymd, $date->hms);
-
-            my $old    = $history_rs->oh_old;
-            my $new    = $history_rs->oh_new;
-            my $action = $history_rs->oh_action;
-            my $field  = $history_rs->oh_field;
-
-            if ($action eq 'set' and $field eq 'flags') {
-                if (defined ($new)) {
-                    $output .= "set flag $new";
-                } elsif (defined ($old)) {
-                    $output .= "clear flag $old";
-                }
-            } elsif ($action eq 'set' and $field eq 'type_data') {
-                my $attr = $history_rs->oh_type_field;
-                if (defined ($old) and defined ($new)) {
-                    $output .= "set attribute $attr to $new (was $old)";
-                } elsif (defined ($old)) {
-                    $output .= "remove $old from attribute $attr";
-                } elsif (defined ($new)) {
-                    $output .= "add $new to attribute $attr";
-                }
-            } elsif ($action eq 'set'
-                     and ($field eq 'owner' or $field =~ /^acl_/)) {
-                $old = $self->format_acl_id ($old) if defined ($old);
-                $new = $self->format_acl_id ($new) if defined ($new);
-                if (defined ($old) and defined ($new)) {
-                    $output .= "set $field to $new (was $old)";
-                } elsif (defined ($new)) {
-                    $output .= "set $field to $new";
-                } elsif (defined ($old)) {
-                    $output .= "unset $field (was $old)";
-                }
-            } elsif ($action eq 'set') {
-                if (defined ($old) and defined ($new)) {
-                    $output .= "set $field to $new (was $old)";
-                } elsif (defined ($new)) {
-                    $output .= "set $field to $new";
-                } elsif (defined ($old)) {
-                    $output .= "unset $field (was $old)";
-                }
-            } else {
-                $output .= $action;
+        my @pending;
+        if (my $journal = $self->journal) {
+            @pending = $journal->entries ($self->{type}, $self->{name});
+            @pending = grep { $history->in_range ($_->{time}) } @pending;
+        }
+
+        # Add a row to the output after any pending journal entries that
+        # precede it, returning false once we've reached the limit.
+        my $add = sub {
+            my ($row) = @_;
+            while (@pending and $pending[0]{time} < $row->{oh_on}->epoch) {
+                my $entry = shift @pending;
+                push (@rows, $self->journal_history_row ($entry));
+                return 0 unless $history->add;
             }
-            $output .= sprintf ("\n    by %s from %s\n", $history_rs->oh_by,
-                               $history_rs->oh_from);
+            push (@rows, $row);
+            return $history->add;
+        };
+
+        # Archived history, if requested, followed by the database history.
+        if ($options->{archive}) {
+            my $dir = $Wallet::Config::HISTORY_ARCHIVE_DIR;
+            die "history archive not configured\n" unless $dir;
+            require Wallet::Archive;
+            my $archive = Wallet::Archive->new ($dir);
+            my @rows = $archive->rows ('object_history', \%search,
+                                       $history->range);
+            for my $row (@rows) {
+                next unless $history->in_range ($row->{oh_on}->epoch);
+                last unless $add->($row);
+            }
+        }
+        if ($history->more) {
+            $history->search ('ObjectHistory', 'oh_on', \%search,
+                              [qw(oh_on oh_id)], $add);
+        }
+        for my $entry (@pending) {
+            last unless $history->more;
+            push (@rows, $self->journal_history_row ($entry));
+            $history->add;
+        }
+        my $names = $self->history_acl_names (@rows);
+        for my $row (@rows) {
+            $output .= $self->format_history_row ($row, $names);
         }
     };
     if ($@) {
@@ -653,13 +830,15 @@ sub show {
                  [ ob_downloaded_by   => 'Downloaded by'   ],
                  [ ob_downloaded_from => 'Downloaded from' ],
                  [ ob_downloaded_on   => 'Downloaded on'   ]);
-    my $fields = join (', ', map { $_->[0] } @attrs);
-    my @data;
-    my $object_rs;
+
+    # Load the object if needed and all of the ACLs it references, with their
+    # entries, in one query.
+    my %acls;
     eval {
-        my %search = (ob_type => $type,
-                      ob_name => $name);
-        $object_rs = $self->{schema}->resultset('Object')->find (\%search);
+        $self->_load unless $self->{columns};
+        my @fields = grep { /^ob_(owner|acl_)/ } map { $_->[0] } @attrs;
+        my @ids = grep { defined } @{ $self->{columns} }{@fields};
+        %acls = Wallet::Query->new ($self->{schema})->acls (@ids) if @ids;
     };
     if ($@) {
         $self->error ("cannot retrieve data for ${type}:${name}: $@");
@@ -670,17 +849,24 @@ sub show {
 
     # Format the results.  We use a hack to insert the flags before the first
     # trace field since they're not a field in the object in their own right.
-    # The comment should be word-wrapped at 80 columns.
+    # The comment should be word-wrapped at 80 columns.  Timestamps are shown
+    # as stored, skipping any that aren't valid.
     for my $i (0 .. $#attrs) {
         my $field = $attrs[$i][0];
         my $fieldtext = $attrs[$i][1];
-        my $value = $object_rs->$field;
+        my $value = $self->{columns}{$field};
         next unless defined($value);
+        if ($field =~ /_on\z/ or $field eq 'ob_expires') {
+            my $seconds = Wallet::History->epoch ($value);
+            next unless defined $seconds;
+            $value = Wallet::History->date ($seconds);
+        }
 
         if ($field eq 'ob_comment' && length ($value) > 79 - 17) {
+            require Text::Wrap;
             local $Text::Wrap::columns = 80;
             local $Text::Wrap::unexpand = 0;
-            $value = wrap (' ' x 17, ' ' x 17, $value);
+            $value = Text::Wrap::wrap (' ' x 17, ' ' x 17, $value);
             $value =~ s/^ {17}//;
         } elsif ($field eq 'ob_created_by') {
             my @flags = $self->flag_list;
@@ -695,15 +881,11 @@ sub show {
                 return;
             }
             $output .= $attr_output;
-        } elsif (ref ($value) && $value->isa ('DateTime')) {
-            $value->set_time_zone ('local');
-            $value = sprintf ("%s %s", $value->ymd, $value->hms);
-        } elsif ($field =~ /^ob_(owner|acl_)/) {
-            my $acl = eval { Wallet::ACL->new ($value, $self->{schema}) };
-            if ($acl and not $@) {
-                $value = $acl->name || $value;
-                push (@acls, [ $acl, $value ]);
-            }
+        } elsif ($field =~ /^ob_(owner|acl_)/ and $acls{$value}) {
+            my $schema = $self->{schema};
+            my $acl = Wallet::ACL->new ($value, $schema, $acls{$value});
+            $value = $acl->name || $value;
+            push (@acls, [ $acl, $value ]);
         }
         $output .= sprintf ("%15s: %s\n", $fieldtext, $value);
     }
@@ -729,12 +911,11 @@ sub destroy {
         $self->error ("cannot destroy ${type}:${name}: object is locked");
         return;
     }
-    my $guard = $self->{schema}->txn_scope_guard;
-    eval {
+    my $code = sub {
+        my $guard = $self->{schema}->txn_scope_guard;
 
         # Remove any flags that may exist for the record.
-        my %search = (fl_type => $type,
-                      fl_name => $name);
+        my %search = (fl_object => $self->id);
         $self->{schema}->resultset('Flag')->search (\%search)->delete;
 
         # Remove any object records
@@ -743,7 +924,7 @@ sub destroy {
         $self->{schema}->resultset('Object')->search (\%search)->delete;
 
         # And create a new history object for the destroy action.
-        my $date = DateTime->from_epoch (epoch => $time);
+        my $date = Wallet::History->date ($time);
         my %record = (oh_type => $type,
                       oh_name => $name,
                       oh_action => 'destroy',
@@ -753,10 +934,14 @@ sub destroy {
         $self->{schema}->resultset('ObjectHistory')->create (\%record);
         $guard->commit;
     };
+    eval { $self->{schema}->txn_retry ($code) };
     if ($@) {
         $self->error ("cannot destroy ${type}:${name}: $@");
         return;
     }
+    delete $self->{columns};
+    delete $self->{type_data};
+    $self->{flags} = {};
     return 1;
 }
 
@@ -802,7 +987,7 @@ called with the desired wallet object class as the first argument
 
 =over 4
 
-=item new(TYPE, NAME, DBH)
+=item new(TYPE, NAME, DBH [, DATA])
 
 Creates a new object with the given object type and name, based on data
 already in the database.  This method will only succeed if an object of
@@ -812,7 +997,18 @@ blessed into the class used for the new() call (so subclasses can leave
 this method alone and not override it).
 
 Takes a Wallet::Schema object, which is stored in the object and used
-for any further operations.
+for any further operations.  The object row, its flags, and the rows of
+the relationships named by type_data_relations() are loaded with a single
+query and cached for the life of the object.  Changes made through the
+object's methods update the cache as well as the database, but changes
+made elsewhere aren't seen, so objects should not be kept across
+requests.
+
+If DATA is given, it must be the object as already loaded by the object()
+method of Wallet::Query.  The object is then not looked up again, its
+flags are taken from DATA, and the rest of its data is loaded the first
+time it's needed.  Subclasses that override new() should pass DATA
+through.
 
 =item create(TYPE, NAME, DBH, PRINCIPAL, HOSTNAME [, DATETIME])
 
@@ -822,8 +1018,16 @@ exists in the database or if creating the database record fails.
 Otherwise, a new database entry will be created with that type and name,
 no owner, no ACLs, no expiration, no flags, and with created by, from, and
 on set to the PRINCIPAL, HOSTNAME, and DATETIME parameters.  If DATETIME
-isn't given, the current time is used.  The database handle is treated as
-with new().
+isn't given, the current time is used.  The host of the object is set
+from host_for().  The database handle is treated as with new().
+
+=item host_for(TYPE, NAME)
+
+Returns the hostname that the object of type TYPE and name NAME is for,
+as determined by the object_host() function in the wallet configuration,
+or undef if that function is not defined or the object is not host-based.
+This is stored with the object when it is created or renamed so that
+host-based reports can find objects by host.  See Wallet::Config(3).
 
 =back
 
@@ -962,7 +1166,7 @@ either the data of the object or undef on some error, using the provided
 arguments to update history information.  The Wallet::Object::Base
 implementation just throws an exception.
 
-=item history()
+=item history([OPTIONS])
 
 Returns the formatted history for the object.  There will be two lines for
 each action on the object.  The first line has the timestamp of the action
@@ -970,6 +1174,28 @@ and the action, and the second line gives the user who performed the
 action and the host from which they performed it (based on the trace
 information passed into the other object methods).
 
+If HISTORY_JOURNAL is set, get and store actions that have not yet been
+flushed from the journal into the database are included, ordered by their
+timestamps.
+
+OPTIONS, if given, is a reference to a hash of options.  If the C<archive>
+option is set, history that has been moved to the archive with
+C<wallet-admin history archive> is included before the history in the
+database.  This requires HISTORY_ARCHIVE_DIR to be set and reads every
+archive file, so it may be slow.  The C<since> and C<until> options limit
+the history to actions at or after and before the given times, and the
+C<limit> option returns at most that many actions, starting with the
+oldest.  See Wallet::History(3) for the accepted formats.  History is
+read from the database a page at a time, so limiting it avoids reading
+the rest of the history.
+
+=item id()
+
+Returns the object's numeric ID, which is assigned when the object is
+created and used to refer to it from the tables holding its flags and
+type-specific data.  Objects are still identified by type and name
+everywhere else, including in the object history.
+
 =item name()
 
 Returns the object's name.
@@ -1026,6 +1252,10 @@ This function commits its transaction when complete and therefore should
 not be called inside another transaction.  Normally it's called as a
 separate transaction after the data is successfully stored or retrieved.
 
+If HISTORY_JOURNAL is set in Wallet::Config, the action is instead
+appended to the history journal (see Wallet::Journal(3)) and the database
+is not changed.
+
 =item log_set (FIELD, OLD, NEW, PRINCIPAL, HOSTNAME, DATETIME)
 
 Updates the history tables for the change in a setting value for an
@@ -1041,6 +1271,22 @@ This function does not commit and does not catch database exceptions.  It
 should normally be called as part of a larger transaction that implements
 the change in the setting.
 
+=item type_data (RELATIONSHIP)
+
+Returns the rows of RELATIONSHIP, which must be one of the relationships
+returned by type_data_relations(), as loaded with the object.  Each row is
+a reference to a hash of column names to values.  Throws an exception on
+a database error.  Subclasses that change these rows should update the
+cached copy in C<< $self->{type_data}{RELATIONSHIP} >> once the change is
+committed.
+
+=item type_data_relations ()
+
+Returns the names of the relationships of Wallet::Schema::Result::Object
+that hold type-specific data for this class and should be loaded with the
+object.  The default returns the empty list.  Subclasses that store data
+in their own tables should override this.
+
 =back
 
 =head1 SEE ALSO
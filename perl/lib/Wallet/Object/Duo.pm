@@ -17,6 +17,8 @@ use 5.008;
 use strict;
 use warnings;
 
+use Digest::SHA qw(hmac_sha256);
+use Fcntl qw(O_WRONLY O_CREAT O_TRUNC);
 use JSON;
 use Perl6::Slurp qw(slurp);
 use Wallet::Config;
@@ -25,6 +27,11 @@ use Wallet::Object::Base;
 our @ISA     = qw(Wallet::Object::Base);
 our $VERSION = '1.05';
 
+# The parsed contents of each Duo key file, keyed by path.  Each value is a
+# reference to a hash with keys mtime, the modification time of the file when
+# it was read, and config, the decoded JSON.
+our %KEY_FILES;
+
 # Mappings from our types into what Duo calls the integration types.
 our %DUO_TYPES = (
                   'duo'        => {
@@ -118,22 +125,155 @@ sub _output_ldap {
     return $output;
 }
 
+##############################################################################
+# Duo API and secrets cache
+##############################################################################
+
+# Return the parsed contents of DUO_KEY_FILE as a reference to a hash.  The
+# file is only read again if its modification time changes, since it would
+# otherwise be read and decoded for every object.  Dies on failure.
+sub _key_file {
+    my $path = $Wallet::Config::DUO_KEY_FILE;
+    my $mtime = (stat $path)[9];
+    my $cached = $KEY_FILES{$path};
+    if (!$cached || !defined ($mtime) || $cached->{mtime} != $mtime) {
+        my $json = JSON->new->utf8 (1)->relaxed (1);
+        my $config = $json->decode (scalar slurp $path);
+        $cached = { mtime => $mtime, config => $config };
+        $KEY_FILES{$path} = $cached;
+    }
+    return $cached->{config};
+}
+
+# Load the modules needed for Duo support and return a new Net::Duo::Admin
+# object using the key and hostname from DUO_KEY_FILE.  Dies on failure.
+sub _admin {
+    eval {
+        require Net::Duo;
+        require Net::Duo::Admin;
+        require Net::Duo::Admin::Integration;
+        if ($Wallet::Config::DUO_CACHE) {
+            require Crypt::AuthEnc::GCM;
+            require Crypt::PRNG;
+        }
+    };
+    if ($@) {
+        my $error = $@;
+        chomp $error;
+        1 while ($error =~ s/ at \S+ line \d+\.?\z//);
+        die "Duo object support not available: $error\n";
+    }
+    my $config = _key_file;
+    my $duo = Net::Duo::Admin->new (
+        {
+            api_hostname    => $config->{api_hostname},
+            integration_key => $config->{integration_key},
+            secret_key      => $config->{secret_key},
+            user_agent      => $Wallet::Config::DUO_AGENT,
+        }
+    );
+    return $duo;
+}
+
+# Return the path to the cache file for the given integration key, or undef
+# if the secrets cache is not configured.
+sub _cache_path {
+    my ($key) = @_;
+    return unless $Wallet::Config::DUO_CACHE;
+    $key =~ s/([^\w-])/sprintf ('%%%02X', ord ($1))/ge;
+    return "$Wallet::Config::DUO_CACHE/$key";
+}
+
+# Return the key used to encrypt the secrets cache.  It is derived from the
+# secret key of the Duo Admin API integration, so the cache is useless
+# without DUO_KEY_FILE and is discarded if that key changes.
+sub _cache_key {
+    my $config = _key_file;
+    return hmac_sha256 ('wallet duo cache', $config->{secret_key});
+}
+
+# Return the cached secret key for the given integration key, or undef if it
+# isn't cached, was cached more than DUO_CACHE_TTL seconds ago, or can't be
+# read or decrypted.  The integration key is authenticated along with the
+# secret so that a cache file can't be used for another integration.
+sub _cache_read {
+    my ($key) = @_;
+    my $path = _cache_path ($key);
+    return unless defined $path;
+    open (my $fh, '<', $path) or return;
+    binmode $fh;
+    my $data = do { local $/; <$fh> };
+    close $fh;
+    return unless defined ($data) && length ($data) > 28;
+    my ($iv, $tag, $ciphertext) = unpack ('a12 a16 a*', $data);
+    my $plaintext = eval {
+        Crypt::AuthEnc::GCM::gcm_decrypt_verify ('AES', _cache_key (), $iv,
+                                                 $key, $ciphertext, $tag);
+    };
+    return unless defined $plaintext;
+    my ($cached, $secret) = split (' ', $plaintext, 2);
+    my $ttl = $Wallet::Config::DUO_CACHE_TTL || 0;
+    return if time - $cached >= $ttl;
+    return $secret;
+}
+
+# Store the secret key for the given integration key in the cache, encrypted
+# and with the current time.  The file is written under a temporary name and
+# then renamed so that other processes never see a partial file.  Failures
+# are ignored, since the integration can always be retrieved from Duo.
+sub _cache_write {
+    my ($key, $secret) = @_;
+    my $path = _cache_path ($key);
+    return unless defined $path;
+    my $tmp = "$path.$$";
+    eval {
+        my $iv = Crypt::PRNG::random_bytes (12);
+        my ($ciphertext, $tag)
+            = Crypt::AuthEnc::GCM::gcm_encrypt_authenticate ('AES',
+                _cache_key (), $iv, $key, time . " $secret");
+        my $flags = O_WRONLY | O_CREAT | O_TRUNC;
+        sysopen (my $fh, $tmp, $flags, 0600) or die "$!\n";
+        binmode $fh;
+        print {$fh} $iv, $tag, $ciphertext or die "$!\n";
+        close ($fh) or die "$!\n";
+        rename ($tmp, $path) or die "$!\n";
+    };
+    unlink $tmp if $@;
+    return;
+}
+
+# Remove the given integration key from the cache.
+sub _cache_delete {
+    my ($key) = @_;
+    my $path = _cache_path ($key);
+    unlink $path if defined $path;
+    return;
+}
+
 ##############################################################################
 # Core methods
 ##############################################################################
 
+# Load the Duo integration key with the object.
+sub type_data_relations {
+    return qw(duo);
+}
+
+# Return the Duo integration key for this object from the data loaded with
+# the object.  Dies if there is no key or on a database error.
+sub _key {
+    my ($self) = @_;
+    my ($row) = $self->type_data ('duo');
+    die "no Duo integration key for $self->{type}:$self->{name}\n"
+        unless $row;
+    return $row->{du_key};
+}
+
 # Override attr_show to display the Duo integration key attribute.
 sub attr_show {
     my ($self) = @_;
     my $output = '';
-    my $key;
-    eval {
-        my %search = (du_name => $self->{name},
-                      du_type => $self->{type},
-                     );
-        my $row = $self->{schema}->resultset ('Duo')->find (\%search);
-        $key = $row->get_column ('du_key');
-    };
+    my $key = eval { $self->_key };
     if ($@) {
         $self->error ($@);
         return;
@@ -144,38 +284,18 @@ sub attr_show {
 # Override new to start by creating a Net::Duo::Admin object for subsequent
 # calls.
 sub new {
-    my ($class, $type, $name, $schema) = @_;
+    my ($class, $type, $name, $schema, $loaded) = @_;
 
     # We have to have a Duo integration key file set.
     if (not $Wallet::Config::DUO_KEY_FILE) {
         die "duo object implementation not configured\n";
     }
-    my $key_file = $Wallet::Config::DUO_KEY_FILE;
-    my $agent    = $Wallet::Config::DUO_AGENT;
-
-    # Check that we can load all of the required modules.
-    eval {
-        require Net::Duo;
-        require Net::Duo::Admin;
-        require Net::Duo::Admin::Integration;
-    };
-    if ($@) {
-        my $error = $@;
-        chomp $error;
-        1 while ($error =~ s/ at \S+ line \d+\.?\z//);
-        die "Duo object support not available: $error\n";
-    }
 
     # Construct the Net::Duo::Admin object.
-    my $duo = Net::Duo::Admin->new (
-        {
-            key_file   => $key_file,
-            user_agent => $agent,
-        }
-    );
+    my $duo = _admin;
 
     # Construct the object.
-    my $self = $class->SUPER::new ($type, $name, $schema);
+    my $self = $class->SUPER::new ($type, $name, $schema, $loaded);
     $self->{duo} = $duo;
     return $self;
 }
@@ -191,8 +311,6 @@ sub create {
     if (not $Wallet::Config::DUO_KEY_FILE) {
         die "duo object implementation not configured\n";
     }
-    my $key_file = $Wallet::Config::DUO_KEY_FILE;
-    my $agent    = $Wallet::Config::DUO_AGENT;
 
     # Make sure this is actually a type we know about, since this handler
     # can handle many types.
@@ -200,26 +318,8 @@ sub create {
         die "$type is not a valid duo integration\n";
     }
 
-    # Check that we can load all of the required modules.
-    eval {
-        require Net::Duo;
-        require Net::Duo::Admin;
-        require Net::Duo::Admin::Integration;
-    };
-    if ($@) {
-        my $error = $@;
-        chomp $error;
-        1 while ($error =~ s/ at \S+ line \d+\.?\z//);
-        die "Duo object support not available: $error\n";
-    }
-
     # Construct the Net::Duo::Admin object.
-    my $duo = Net::Duo::Admin->new (
-        {
-            key_file   => $key_file,
-            user_agent => $agent,
-        }
-    );
+    my $duo = _admin;
 
     # Create the object in Duo.
     my $duo_type = $DUO_TYPES{$type}{integration};
@@ -239,13 +339,15 @@ sub create {
     my $guard = $self->{schema}->txn_scope_guard;
     eval {
         my %record = (
-            du_name => $name,
-            du_type => $type,
-            du_key  => $integration->integration_key,
+            du_object => $self->id,
+            du_key    => $integration->integration_key,
         );
         $self->{schema}->resultset ('Duo')->create (\%record);
         $guard->commit;
+        $self->{type_data} = { duo => [ \%record ] };
     };
+    _cache_write ($integration->integration_key, $integration->secret_key)
+        unless $@;
     if ($@) {
         my $id = $self->{type} . ':' . $self->{name};
         $self->error ("cannot set Duo key for $id: $@");
@@ -267,14 +369,12 @@ sub destroy {
     my $schema = $self->{schema};
     my $guard = $schema->txn_scope_guard;
     eval {
-        my %search = (du_name => $self->{name},
-                      du_type => $self->{type},
-                     );
-        my $row = $schema->resultset ('Duo')->find (\%search);
-        my $key = $row->get_column ('du_key');
+        my %search = (du_object => $self->id);
+        my $key = $self->_key;
+        _cache_delete ($key);
         my $int = Net::Duo::Admin::Integration->new ($self->{duo}, $key);
         $int->delete;
-        $row->delete;
+        $schema->resultset ('Duo')->search (\%search)->delete;
         $guard->commit;
     };
     if ($@) {
@@ -297,25 +397,23 @@ sub get {
         return;
     }
 
-    # Retrieve the integration from Duo.
-    my $key;
-    eval {
-        my %search = (du_name => $self->{name},
-                      du_type => $self->{type},
-                     );
-        my $row = $self->{schema}->resultset ('Duo')->find (\%search);
-        $key = $row->get_column ('du_key');
-    };
+    # Retrieve the integration secret from the cache or from Duo.
+    my $key = eval { $self->_key };
     if ($@) {
         $self->error ($@);
         return;
     }
-    my $integration = Net::Duo::Admin::Integration->new ($self->{duo}, $key);
+    my $secret = _cache_read ($key);
+    if (!defined $secret) {
+        my $duo = $self->{duo};
+        my $integration = Net::Duo::Admin::Integration->new ($duo, $key);
+        $secret = $integration->secret_key;
+        _cache_write ($key, $secret);
+    }
 
     # We also need the admin server name, which we can get from the Duo object
-    # configuration with a bit of JSON decoding.
-    my $json = JSON->new->utf8 (1)->relaxed (1);
-    my $config = $json->decode (scalar slurp $Wallet::Config::DUO_KEY_FILE);
+    # configuration.
+    my $config = _key_file;
 
     # Construct the returned file.  Assume the generic handler in case there
     # is no valid handler, though that shouldn't happen.
@@ -326,8 +424,7 @@ sub get {
     } else {
         $output_sub = \&_output_generic;
     }
-    my $output = $output_sub->($key, $integration->secret_key,
-                               $config->{api_hostname});
+    my $output = $output_sub->($key, $secret, $config->{api_hostname});
 
     # Log the action and return.
     $self->log_action ('get', $user, $host, $time);
@@ -400,17 +497,19 @@ time is used.
 
 When a new Duo integration object is created, a new integration will be
 created in the configured Duo account and the integration key will be
-stored in the wallet object.  If the integration already exists, create()
-will fail.  If an integration type isn't given, the new integration's type
-is controlled by the DUO_TYPE configuration variable, which defaults to
-C<unix>.  See L<Wallet::Config> for more information.
+stored in the wallet object.  If DUO_CACHE is set, the secret key of the
+new integration is stored in the cache.  If the integration already
+exists, create() will fail.  If an integration type isn't given, the new
+integration's type is controlled by the DUO_TYPE configuration variable,
+which defaults to C<unix>.  See L<Wallet::Config> for more information.
 
 If create() fails, it throws an exception.
 
 =item destroy(PRINCIPAL, HOSTNAME [, DATETIME])
 
 Destroys a Duo integration object by removing it from the database and
-deleting the integration from Duo.  If deleting the Duo integration fails,
+deleting the integration from Duo, and removes its secret key from the
+cache if DUO_CACHE is set.  If deleting the Duo integration fails,
 destroy() fails.  Returns true on success and false on failure.  The
 caller should call error() to get the error message after a failure.
 PRINCIPAL, HOSTNAME, and DATETIME are stored as history information.
@@ -432,7 +531,11 @@ The returned configuration look look like:
     host = <api-hostname>
 
 The C<host> parameter will be taken from the configuration file pointed
-to by the DUO_KEY_FILE configuration variable.
+to by the DUO_KEY_FILE configuration variable, which is read once and
+then only again if it changes.  If DUO_CACHE is set, the secret key is
+taken from the encrypted cache in that directory if it was stored there
+less than DUO_CACHE_TTL seconds ago, and otherwise is retrieved from Duo
+and stored in the cache.  See L<Wallet::Config>.
 
 PRINCIPAL, HOSTNAME, and DATETIME are stored as history information.
 PRINCIPAL should be the user who is downloading the keytab.  If DATETIME
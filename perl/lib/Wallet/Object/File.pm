@@ -73,8 +73,9 @@ sub rename {
         die "cannot find ${type}:${old_name}\n"
             unless ($object and $object->ob_name eq $old_name);
 
-        # Update the object name but don't yet commit.
+        # Update the object name and host but don't yet commit.
         $object->ob_name ($new_name);
+        $object->ob_host ($self->host_for ($type, $new_name));
 
         # Update the file to the path for the new name, and die if we can't.
         # If the old path isn't there, then assume we haven't yet stored and
@@ -93,6 +94,10 @@ sub rename {
         $self->error ("cannot rename object $type $old_name: $!");
         return;
     }
+    if ($self->{columns}) {
+        $self->{columns}{ob_name} = $new_name;
+        $self->{columns}{ob_host} = $self->host_for ($type, $new_name);
+    }
 
     eval {
         $self->log_set ('name', $old_name, $new_name, $user, $host, $time);
@@ -66,12 +66,13 @@ sub enctypes_set {
     my ($self, $enctypes, $user, $host, $time) = @_;
     $time ||= time;
     my @trace = ($user, $host, $time);
-    my $name = $self->{name};
     my %enctypes = map { $_ => 1 } @$enctypes;
+    my @final = sort keys %enctypes;
     my $guard = $self->{schema}->txn_scope_guard;
     eval {
         # Find all enctypes for the given keytab.
-        my %search = (ke_name => $name);
+        my $object = $self->id;
+        my %search = (ke_object => $object);
         my @enctypes = $self->{schema}->resultset('KeytabEnctype')
             ->search (\%search);
         my (@current);
@@ -86,7 +87,7 @@ sub enctypes_set {
             if ($enctypes{$enctype}) {
                 delete $enctypes{$enctype};
             } else {
-                %search = (ke_name    => $name,
+                %search = (ke_object  => $object,
                            ke_enctype => $enctype);
                 $self->{schema}->resultset('KeytabEnctype')->find (\%search)
                     ->delete;
@@ -105,7 +106,7 @@ sub enctypes_set {
             unless (defined $enctype_rs) {
                 die "unknown encryption type $enctype\n";
             }
-            my %record = (ke_name    => $name,
+            my %record = (ke_object  => $object,
                           ke_enctype => $enctype);
             $self->{schema}->resultset('KeytabEnctype')->create (\%record);
             $self->log_set ('type_data enctypes', undef, $enctype, @trace);
@@ -116,24 +117,25 @@ sub enctypes_set {
         $self->error ($@);
         return;
     }
+    if ($self->{type_data}) {
+        my $object = $self->{id};
+        $self->{type_data}{keytab_enctypes}
+            = [ map { { ke_object => $object, ke_enctype => $_ } } @final ];
+    }
     return 1;
 }
 
 # Return a list of the encryption types current set for a keytab.  Called by
 # attr() or get().  Returns the empty list on failure or on an empty list of
 # enctype restrictions, but sets the object error on failure so the caller
-# should use that to determine success.
+# should use that to determine success.  The enctypes are loaded with the
+# object.
 sub enctypes_list {
     my ($self) = @_;
     my @enctypes;
     eval {
-        my %search = (ke_name => $self->{name});
-        my %attrs = (order_by => 'ke_enctype');
-        my @enctypes_rs = $self->{schema}->resultset('KeytabEnctype')
-            ->search (\%search, \%attrs);
-        for my $enctype_rs (@enctypes_rs) {
-            push (@enctypes, $enctype_rs->ke_enctype);
-        }
+        my @rows = $self->type_data ('keytab_enctypes');
+        @enctypes = sort map { $_->{ke_enctype} } @rows;
     };
     if ($@) {
         $self->error ($@);
@@ -166,8 +168,7 @@ sub sync_set {
     } else {
         my $guard = $self->{schema}->txn_scope_guard;
         eval {
-            my $name = $self->{name};
-            my %search = (ks_name => $name);
+            my %search = (ks_object => $self->id);
             my $sync_rs = $self->{schema}->resultset('KeytabSync')
                 ->find (\%search);
             if (defined $sync_rs) {
@@ -181,6 +182,7 @@ sub sync_set {
             $self->error ($@);
             return;
         }
+        $self->{type_data}{keytab_sync} = [] if $self->{type_data};
     }
     return 1;
 }
@@ -188,18 +190,13 @@ sub sync_set {
 # Return a list of the current synchronization targets.  Returns the empty
 # list on failure or on an empty list of enctype restrictions, but sets
 # the object error on failure so the caller should use that to determine
-# success.
+# success.  The targets are loaded with the object.
 sub sync_list {
     my ($self) = @_;
     my @targets;
     eval {
-        my %search = (ks_name => $self->{name});
-        my %attrs = (order_by => 'ks_target');
-        my @syncs = $self->{schema}->resultset('KeytabSync')->search (\%search,
-                                                                      \%attrs);
-        for my $sync_rs (@syncs) {
-            push (@targets, $sync_rs->ks_target);
-        }
+        my @rows = $self->type_data ('keytab_sync');
+        @targets = sort map { $_->{ks_target} } @rows;
     };
     if ($@) {
         $self->error ($@);
@@ -212,6 +209,11 @@ sub sync_list {
 # Core methods
 ##############################################################################
 
+# Load the enctype restrictions and synchronization targets with the object.
+sub type_data_relations {
+    return qw(keytab_enctypes keytab_sync);
+}
+
 # Override attr to support setting the enctypes and sync attributes.  Note
 # that the sync attribute has no supported targets at present and hence will
 # always return an error, but the code is still here so that it doesn't have
@@ -267,7 +269,7 @@ sub attr_show {
 # Override new to start by creating a handle for the kadmin module we're
 # using.
 sub new {
-    my ($class, $type, $name, $schema) = @_;
+    my ($class, $type, $name, $schema, $loaded) = @_;
      my $self = {
         schema => $schema,
         kadmin => undef,
@@ -276,7 +278,7 @@ sub new {
     my $kadmin = Wallet::Kadmin->new ();
     $self->{kadmin} = $kadmin;
 
-    $self = $class->SUPER::new ($type, $name, $schema);
+    $self = $class->SUPER::new ($type, $name, $schema, $loaded);
     $self->{kadmin} = $kadmin;
     return $self;
 }
@@ -315,11 +317,11 @@ sub destroy {
     my $schema = $self->{schema};
     my $guard = $schema->txn_scope_guard;
     eval {
-        my %search = (ks_name => $self->{name});
+        my %search = (ks_object => $self->id);
         my $sync_rs = $schema->resultset('KeytabSync')->search (\%search);
         $sync_rs->delete_all if defined $sync_rs;
 
-        %search = (ke_name => $self->{name});
+        %search = (ke_object => $self->id);
         my $enctype_rs = $schema->resultset('KeytabEnctype')->search (\%search);
         $enctype_rs->delete_all if defined $enctype_rs;
 
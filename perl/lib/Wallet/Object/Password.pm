@@ -70,11 +70,9 @@ sub retrieve {
 
     # If nothing is yet stored, or we have requested an update, generate a
     # random password and save it to the file.
-    my $schema = $self->{schema};
-    my %search = (ob_type => $self->{type},
-                  ob_name => $self->{name});
-    my $object = $schema->resultset('Object')->find (\%search);
-    if (!$object->ob_stored_on || $operation eq 'update') {
+    my $stored = $self->_get_internal ('stored_on');
+    return if $self->error;
+    if (!$stored || $operation eq 'update') {
         unless (open (FILE, '>', $path)) {
             $self->error ("cannot store initial settings for $id: $!\n");
             return;
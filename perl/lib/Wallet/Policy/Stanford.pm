@@ -27,7 +27,7 @@ our (@EXPORT_OK, $VERSION);
 # consistency is good).
 BEGIN {
     $VERSION   = '1.05';
-    @EXPORT_OK = qw(default_owner verify_name is_for_host);
+    @EXPORT_OK = qw(default_owner verify_name is_for_host object_host);
 }
 
 ##############################################################################
@@ -124,17 +124,26 @@ our $ROOT_REQUIRED = '/etc/remctl/acl/its-idg';
 
 # Retrieve an existing ACL and return its members as a list.
 #
-# $name - Name of the ACL to retrieve
+# $name   - Name of the ACL to retrieve
+# $schema - The database schema to use, if the caller passed one
+# $cache  - The policy cache for this request, if the caller passed one
 #
 # Returns: Members of the ACL as a list of pairs
 #          The empty list on any failure to retrieve the ACL
 sub _acl_members {
-    my ($name) = @_;
-    my $schema = eval { Wallet::Schema->connect };
+    my ($name, $schema, $cache) = @_;
+    if ($cache && $cache->{acl_members}{$name}) {
+        return @{ $cache->{acl_members}{$name} };
+    }
+
+    # Older wallet servers don't pass the schema, so connect ourselves.
+    $schema ||= eval { Wallet::Schema->connect };
     return if (!$schema || $@);
     my $acl = eval { Wallet::ACL->new ($name, $schema) };
     return if (!$acl || $@);
-    return $acl->list;
+    my @members = $acl->list;
+    $cache->{acl_members}{$name} = [ @members ] if $cache;
+    return @members;
 }
 
 # Retrieve an existing ACL and check whether it contains a netdb-root member.
@@ -145,13 +154,34 @@ sub _acl_members {
 #
 # On any failure, just return an empty ACL to use the default.
 sub _acl_has_netdb_root {
-    my ($name) = @_;
-    for my $line (_acl_members($name)) {
+    my ($name, $schema, $cache) = @_;
+    for my $line (_acl_members($name, $schema, $cache)) {
         return 1 if $line->[0] eq 'netdb-root';
     }
     return;
 }
 
+# Return a reference to a hash of the staff members who must use a root
+# instance, read from $ROOT_REQUIRED.  The result is remembered in the policy
+# cache, if there is one, so the file is only read once per request.
+sub _root_required {
+    my ($cache) = @_;
+    return $cache->{root_required} if ($cache && $cache->{root_required});
+    my %staff;
+    if (open (STAFF, '<', $ROOT_REQUIRED)) {
+        local $_;
+        while (<STAFF>) {
+            s/^\s+//;
+            s/\s+$//;
+            next if m,/root\@,;
+            $staff{$_} = 1;
+        }
+        close STAFF;
+    }
+    $cache->{root_required} = \%staff if $cache;
+    return \%staff;
+}
+
 # Map a file object name to a hostname for the legacy file object naming
 # scheme and return it.  Returns undef if this file object name doesn't map to
 # a hostname.
@@ -217,21 +247,22 @@ sub _host_for_duo {
     return $name;
 }
 
+# Take an object type and name and return the host that the object is for,
+# or undef if the object is not host-based.
+sub object_host {
+    my ($type, $name) = @_;
+    return unless defined($HOST_FOR{$type});
+    my $host = $HOST_FOR{$type}->($name);
+    return $host ? $host : undef;
+}
+
 # Take a object type and name, along with a host name, and use these to
 # decide if the given object is host-based and matches the given host.
 sub is_for_host {
     my ($type, $name, $host) = @_;
-
-    # If we have a possible host mapping, get the host and see if it matches.
-    if (defined($HOST_FOR{$type})) {
-        my $object_host = $HOST_FOR{$type}->($name);
-        return 0 unless $object_host;
-        if ($host eq $object_host) {
-            return 1;
-        }
-    }
-
-    return 0;
+    my $object_host = object_host($type, $name);
+    return 0 unless $object_host;
+    return ($host eq $object_host) ? 1 : 0;
 }
 
 # The default owner of host-based objects should be the host keytab and the
@@ -239,7 +270,7 @@ sub is_for_host {
 # using a root instance, we want to require everyone managing that node be
 # using root instances by default.
 sub default_owner {
-    my ($type, $name) = @_;
+    my ($type, $name, $schema, $cache) = @_;
 
     # If we have a possible host mapping, see if we can use that.
     if (defined($HOST_FOR{$type})) {
@@ -248,7 +279,7 @@ sub default_owner {
             my $acl_name = "host/$host";
             my @acl;
             if ($ENV{REMOTE_USER} =~ m,/root,
-                || _acl_has_netdb_root ($acl_name)) {
+                || _acl_has_netdb_root ($acl_name, $schema, $cache)) {
                 @acl = ([ 'netdb-root', $host ],
                         [ 'krb5', "host/$host\@$REALM" ]);
             } else {
@@ -279,7 +310,7 @@ sub default_owner {
     # return the whole ACL.
     my $acl = $ACL_FOR_GROUP{$group};
     return if !defined($acl);
-    my @members = _acl_members($acl);
+    my @members = _acl_members($acl, $schema, $cache);
     return if @members == 0;
     return ($acl, @members);
 }
@@ -291,21 +322,10 @@ sub default_owner {
 # Also use this function to require that ACS staff always do implicit object
 # creation using a */root instance.
 sub verify_name {
-    my ($type, $name, $user) = @_;
-    my %staff;
-    if (open (STAFF, '<', $ROOT_REQUIRED)) {
-        local $_;
-        while (<STAFF>) {
-            s/^\s+//;
-            s/\s+$//;
-            next if m,/root\@,;
-            $staff{$_} = 1;
-        }
-        close STAFF;
-    }
+    my ($type, $name, $user, $schema, $cache) = @_;
 
     # Check for a staff member not using their root instance.
-    if (defined ($user) && $staff{$user}) {
+    if (defined ($user) && _root_required ($cache)->{$user}) {
         return 'use a */root instance for wallet object creation';
     }
 
@@ -533,10 +553,11 @@ policy as described in F<docs/stanford-naming> in the wallet distribution.
 It is primarily intended as an example for other sites, but it is used at
 Stanford to implement that policy.
 
-This module provides the default_owner() and verify_name() functions that
-are part of the wallet configuration interface (as documented in
-L<Wallet::Config>).  They can be imported directly into a wallet
-configuration file from this module or wrapped to apply additional rules.
+This module provides the default_owner(), verify_name(), is_for_host(),
+and object_host() functions that are part of the wallet configuration
+interface (as documented in L<Wallet::Config>).  They can be imported
+directly into a wallet configuration file from this module or wrapped to
+apply additional rules.
 
 =head1 SEE ALSO
 
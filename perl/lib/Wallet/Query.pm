@@ -0,0 +1,317 @@
+# Wallet::Query -- Prepared statements for the common object operations
+#
+# This module runs the few queries needed by the most common wallet
+# operations (get, store, check, and show) directly through DBI with cached
+# prepared statements, loading the object, its type, its flags, and the
+# relevant ACL entries with one joined query each rather than through a
+# series of DBIx::Class lookups.
+#
+# Written by Russ Allbery <eagle@eyrie.org>
+# Copyright 2026 Russ Allbery <eagle@eyrie.org>
+#
+# SPDX-License-Identifier: MIT
+
+##############################################################################
+# Modules and declarations
+##############################################################################
+
+package Wallet::Query;
+
+use 5.008;
+use strict;
+use warnings;
+
+use Wallet::History;
+
+our $VERSION = '1.05';
+
+# The columns of the objects table loaded with each object.
+our @OBJECT_COLUMNS = qw(ob_id ob_type ob_name ob_owner ob_acl_get
+                         ob_acl_store ob_acl_show ob_acl_destroy
+                         ob_acl_flags);
+
+# The maximum number of values passed to a single query ending in an IN
+# clause, kept below the SQLite limit on the number of bind values.
+our $LIST_SIZE = 500;
+
+# The SQL for each query, keyed by the name used by the methods below.  The
+# queries used with execute_list end in an IN to which the list is appended.
+our %SQL = (
+    object => 'SELECT ' . join (', ', @OBJECT_COLUMNS) . ', ty_class, fl_flag'
+        . ' FROM objects JOIN types ON ty_name = ob_type'
+        . ' LEFT JOIN flags ON fl_object = ob_id'
+        . ' WHERE ob_type = ? AND ob_name = ?',
+    acl => 'SELECT ac_id, ac_name, ae_scheme, ae_identifier FROM acls'
+        . ' LEFT JOIN acl_entries ON ae_id = ac_id'
+        . " AND (ae_scheme <> 'krb5' OR ae_identifier = ?"
+        . " OR ae_identifier = '')"
+        . ' WHERE ac_id = ?',
+    history => 'INSERT INTO object_history'
+        . ' (oh_type, oh_name, oh_action, oh_by, oh_from, oh_on)'
+        . ' VALUES (?, ?, ?, ?, ?, ?)',
+    get => 'UPDATE objects SET ob_downloaded_by = ?, ob_downloaded_from = ?,'
+        . ' ob_downloaded_on = ? WHERE ob_type = ? AND ob_name = ?',
+    store => 'UPDATE objects SET ob_stored_by = ?, ob_stored_from = ?,'
+        . ' ob_stored_on = ? WHERE ob_type = ? AND ob_name = ?',
+    generation => 'SELECT ge_generation FROM generations WHERE ge_name = ?',
+    acls => 'SELECT ac_id, ac_name, ae_scheme, ae_identifier FROM acls'
+        . ' LEFT JOIN acl_entries ON ae_id = ac_id WHERE ac_id IN',
+    acl_names => 'SELECT ac_id, ac_name FROM acls WHERE ac_id IN',
+);
+
+##############################################################################
+# Constructor
+##############################################################################
+
+# Create a new query object for the given schema.  The statements are cached
+# on the schema's database handle, so creating more than one query object for
+# the same schema is cheap.
+sub new {
+    my ($class, $schema) = @_;
+    my $self = { schema => $schema };
+    bless ($self, $class);
+    return $self;
+}
+
+##############################################################################
+# Queries
+##############################################################################
+
+# Run the named query with the given bind values and return the statement
+# handle.  Throws an exception on failure.
+sub execute {
+    my ($self, $query, @bind) = @_;
+    my $dbh = $self->{schema}->storage->dbh;
+    my $sth = $dbh->prepare_cached ($SQL{$query});
+    $sth->execute (@bind);
+    return $sth;
+}
+
+# Run the named query, whose SQL ends in an IN clause, with the given list of
+# values, splitting the list into chunks of at most $LIST_SIZE values.  Calls
+# the given function with the columns of each row returned.  Statements are
+# cached for each chunk size.  Throws an exception on failure.
+sub execute_list {
+    my ($self, $query, $values, $callback) = @_;
+    my @values = @$values;
+    my $dbh = $self->{schema}->storage->dbh;
+    while (my @chunk = splice (@values, 0, $LIST_SIZE)) {
+        my $sql = $SQL{$query} . ' (' . join (', ', ('?') x @chunk) . ')';
+        my $sth = $dbh->prepare_cached ($sql);
+        $sth->execute (@chunk);
+        while (my @row = $sth->fetchrow_array) {
+            $callback->(@row);
+        }
+    }
+    return 1;
+}
+
+# Load the object with the given type and name.  Returns a reference to a
+# hash of its objects columns, plus class holding the class for its type and
+# flags holding a reference to a hash whose keys are the flags set on the
+# object, or undef if the object or its type doesn't exist.  Throws an
+# exception on failure.
+sub object {
+    my ($self, $type, $name) = @_;
+    my $sth = $self->execute ('object', $type, $name);
+    my $object;
+    while (my @row = $sth->fetchrow_array) {
+
+        # Databases that compare case-insensitively may return other names.
+        next unless $row[2] eq $name;
+        unless ($object) {
+            $object = {};
+            @$object{@OBJECT_COLUMNS} = @row[0 .. $#OBJECT_COLUMNS];
+            $object->{class} = $row[@OBJECT_COLUMNS];
+            $object->{flags} = {};
+        }
+        my $flag = $row[@OBJECT_COLUMNS + 1];
+        $object->{flags}{$flag} = 1 if defined $flag;
+    }
+    return $object;
+}
+
+# Load the ACL with the given ID along with its entries that could grant
+# access to the given principal: a krb5 entry for that principal, if there
+# is one, and all the entries that aren't krb5 entries or that are empty
+# krb5 entries.  Returns a reference to a hash with keys id, name, and
+# entries, the last a reference to an array of scheme and identifier pairs,
+# or undef if the ACL doesn't exist.  Throws an exception on failure.
+sub acl {
+    my ($self, $id, $principal) = @_;
+    my $sth = $self->execute ('acl', $principal, $id);
+    my $acl;
+    while (my ($acl_id, $name, $scheme, $identifier) = $sth->fetchrow_array) {
+        $acl ||= { id => $acl_id, name => $name, entries => [] };
+        if (defined $scheme) {
+            push (@{ $acl->{entries} }, [ $scheme, $identifier ]);
+        }
+    }
+    return $acl;
+}
+
+# Load all of the ACLs with the given IDs along with all of their entries.
+# Returns a hash of ACL IDs to references to hashes with keys id, name, and
+# members, the last a reference to an array of scheme and identifier pairs.
+# IDs of ACLs that don't exist are left out.  Throws an exception on failure.
+sub acls {
+    my ($self, @ids) = @_;
+    my %seen;
+    @ids = grep { !$seen{$_}++ } @ids;
+    my %acls;
+    my $add = sub {
+        my ($id, $name, $scheme, $identifier) = @_;
+        $acls{$id} ||= { id => $id, name => $name, members => [] };
+        if (defined $scheme) {
+            push (@{ $acls{$id}{members} }, [ $scheme, $identifier ]);
+        }
+    };
+    $self->execute_list ('acls', \@ids, $add);
+    return %acls;
+}
+
+# Return a hash of the given ACL IDs to the names of those ACLs, leaving out
+# any that don't exist.  Throws an exception on failure.
+sub acl_names {
+    my ($self, @ids) = @_;
+    my %seen;
+    @ids = grep { !$seen{$_}++ } @ids;
+    my %names;
+    my $add = sub { $names{$_[0]} = $_[1] };
+    $self->execute_list ('acl_names', \@ids, $add);
+    return %names;
+}
+
+# Return the value of the named generation counter, or undef if there is no
+# such counter.  Throws an exception on failure.
+sub generation {
+    my ($self, $name) = @_;
+    my $sth = $self->execute ('generation', $name);
+    my ($generation) = $sth->fetchrow_array;
+    $sth->finish;
+    return $generation;
+}
+
+# Record a get or store action on an object in the object history and in
+# the object's trace fields.  Takes the action, object type and name, and the
+# trace information (user, host, and time in seconds since epoch).  Does not
+# start or commit a transaction.  Throws an exception on failure.
+sub log_action {
+    my ($self, $action, $type, $name, $user, $host, $time) = @_;
+    my $date = Wallet::History->date ($time);
+    $self->execute ('history', $type, $name, $action, $user, $host, $date);
+    $self->execute ($action, $user, $host, $date, $type, $name);
+    return 1;
+}
+
+1;
+__END__
+
+##############################################################################
+# Documentation
+##############################################################################
+
+=for stopwords
+DBI DBIx::Class ACL ACLs krb5
+
+=head1 NAME
+
+Wallet::Query - Prepared statements for the common object operations
+
+=head1 SYNOPSIS
+
+    use Wallet::Query;
+    my $query = Wallet::Query->new ($schema);
+    my $object = $query->object ($type, $name);
+    my $acl = $query->acl ($object->{ob_acl_get}, $principal);
+
+=head1 DESCRIPTION
+
+Wallet::Query runs the queries needed by the most common wallet
+operations directly through DBI using statements prepared once and cached
+on the database handle.  An object is loaded along with the class for its
+type and its flags in one query, and an ACL is loaded along with only the
+entries that could grant access to a given principal in another, avoiding
+the separate lookups and row object inflation that DBIx::Class would
+otherwise do.  It is used by Wallet::Server for the get, store, check, and
+show commands and by Wallet::Object::Base to record history.
+
+=head1 CLASS METHODS
+
+=over 4
+
+=item new(SCHEMA)
+
+Creates a new query object for the Wallet::Schema object SCHEMA.
+
+=back
+
+=head1 INSTANCE METHODS
+
+Each of these methods throws an exception on a database error.
+
+=over 4
+
+=item acl(ID, PRINCIPAL)
+
+Loads the ACL with the numeric ID ID.  Returns undef if there is no such
+ACL and otherwise a reference to a hash with keys C<id>, C<name>, and
+C<entries>.  C<entries> is a reference to an array of the ACL entries,
+each a reference to a pair of scheme and identifier, that could grant
+access to PRINCIPAL: a C<krb5> entry for exactly PRINCIPAL, if present,
+and all entries that aren't C<krb5> entries or are empty C<krb5> entries.
+These can be passed to the check() method of Wallet::ACL.
+
+=item acl_names(ID, ...)
+
+Returns a hash of the given ACL IDs to the names of those ACLs, all
+looked up with one query.  IDs of ACLs that don't exist are omitted.
+
+=item acls(ID, ...)
+
+Loads all of the ACLs with the given IDs, with all of their entries, in
+one query.  Returns a hash of ACL IDs to references to hashes with keys
+C<id>, C<name>, and C<members>, the last a reference to an array of pairs
+of scheme and identifier.  These hashes can be passed as the third
+argument to the new() method of Wallet::ACL.  IDs of ACLs that don't
+exist are omitted.
+
+=item execute_list(QUERY, VALUES, CALLBACK)
+
+Runs the query named QUERY, whose SQL ends in an C<IN> clause, for the
+values in the array referenced by VALUES, calling CALLBACK with the
+columns of each row returned.  Long lists are split so that no single
+statement has more than $Wallet::Query::LIST_SIZE bind values.
+
+=item generation(NAME)
+
+Returns the value of the generation counter NAME from the C<generations>
+table, or undef if there is no such counter.  See Wallet::Cache.
+
+=item log_action(ACTION, TYPE, NAME, USER, HOST, TIME)
+
+Records ACTION, which must be C<get> or C<store>, on the object identified
+by TYPE and NAME in the object history and in the object's download or
+store trace fields.  USER and HOST are the user and host performing the
+action and TIME is the time in seconds since epoch.  This does not start
+or commit a transaction.
+
+=item object(TYPE, NAME)
+
+Loads the object identified by TYPE and NAME.  Returns undef if either the
+object or its type doesn't exist, and otherwise a reference to a hash of
+the object's ID, owner, and ACL columns (such as C<ob_id>, C<ob_owner>,
+and C<ob_acl_get>) and its type and name, plus C<class>, the class
+implementing its type, and C<flags>, a reference to a hash whose keys are
+the flags set on the object.
+
+=back
+
+=head1 SEE ALSO
+
+Wallet::Object::Base(3), Wallet::Server(3)
+
+This module is part of the wallet system.  The current version is
+available from L<https://www.eyrie.org/~eagle/software/wallet/>.
+
+=cut
@@ -17,22 +17,38 @@ use 5.008;
 use strict;
 use warnings;
 
+use Digest::MD5;
+use IO::Select;
+use POSIX qw(_exit);
 use Wallet::ACL;
+use Wallet::Config;
+use Wallet::History;
 use Wallet::Schema;
 
 our $VERSION = '1.05';
 
+# The number of rows to read from the database at a time for reports.
+our $PAGE_SIZE = 1000;
+
+# The number of items an audit checks between reports of its progress.
+our $AUDIT_PROGRESS = 1000;
+
 ##############################################################################
 # Constructor, destructor, and accessors
 ##############################################################################
 
 # Create a new wallet report object.  Opens a connection to the database that
-# will be used for all of the wallet configuration information.  Throw an
-# exception if anything goes wrong.
+# will be used for all of the wallet configuration information.  The policy
+# cache is passed to the policy functions in the wallet configuration so that
+# they can remember what they've looked up for the life of this object.
+# Since reports only read from the database, they use the replica given by
+# DB_REPLICA_INFO if it is set, falling back on the primary database if the
+# replica can't be reached.  Throw an exception if anything goes wrong.
 sub new {
     my ($class) = @_;
-    my $schema = Wallet::Schema->connect;
-    my $self = { schema => $schema };
+    my $schema = eval { Wallet::Schema->connect_replica };
+    $schema ||= Wallet::Schema->connect;
+    my $self = { schema => $schema, policy => {} };
     bless ($self, $class);
     return $self;
 }
@@ -67,6 +83,46 @@ sub DESTROY {
     $self->{schema}->storage->dbh->disconnect;
 }
 
+##############################################################################
+# Paged searches
+##############################################################################
+
+# Search the given result source with the given search and options, ordered
+# by the given key columns, and call the callback with each row object.  The
+# key columns must be selected and together must be unique.  Rows are read a
+# page of $PAGE_SIZE rows at a time, starting each page after the last row of
+# the previous page, so that only one page is held in memory no matter how
+# large the result.  Stops when the callback returns false.  Throws an
+# exception on failure.
+sub paged_search {
+    my ($self, $source, $search, $options, $keys, $callback) = @_;
+    my $rs = $self->{schema}->resultset ($source);
+    if (ref ($search) eq 'ARRAY') {
+        $search = { -or => $search };
+    }
+    my %options = (%$options, order_by => $keys, rows => $PAGE_SIZE);
+    my @last;
+    while (1) {
+        my $where = $search;
+        if (@last) {
+            my @after;
+            for my $i (0 .. $#$keys) {
+                my %key = map { $keys->[$_] => $last[$_] } 0 .. $i - 1;
+                $key{$keys->[$i]} = { '>' => $last[$i] };
+                push (@after, \%key);
+            }
+            $where = %$search ? { -and => [ $search, { -or => \@after } ] }
+                              : { -or => \@after };
+        }
+        my @rows = $rs->search ($where, \%options)->all;
+        for my $row (@rows) {
+            return unless $callback->($row);
+        }
+        return if @rows < $PAGE_SIZE;
+        @last = map { $rows[-1]->get_column ($_) } @$keys;
+    }
+}
+
 ##############################################################################
 # Object reports
 ##############################################################################
@@ -127,7 +183,6 @@ sub objects_flag {
 
     my %search = ('flags.fl_flag' => $flag);
     my %options = (join     => 'flags',
-                   prefetch => 'flags',
                    order_by => [ qw/ob_type ob_name/ ],
                    select   => [ qw/ob_type ob_name/ ]);
 
@@ -163,8 +218,6 @@ sub objects_acl {
 # have never been retrieved (via get).
 sub objects_unused {
     my ($self) = @_;
-    my @objects;
-
     my %search = (ob_downloaded_on => undef);
     my %options = (order_by => [ qw/ob_type ob_name/ ],
                    select   => [ qw/ob_type ob_name/ ]);
@@ -172,12 +225,10 @@ sub objects_unused {
     return (\%search, \%options);
 }
 
-# Return the SQL statement to find all fiel objects that have been created
+# Return the SQL statement to find all file objects that have been created
 # but have never had information stored (via store).
 sub objects_unstored {
     my ($self) = @_;
-    my @objects;
-
     my %search = (ob_stored_on => undef,
                   ob_type      => 'file');
     my %options = (order_by => [ qw/ob_type ob_name/ ],
@@ -186,14 +237,13 @@ sub objects_unstored {
     return (\%search, \%options);
 }
 
-# Returns a list of all objects stored in the wallet database in the form of
-# type and name pairs.  On error and for an empty database, the empty list
-# will be returned.  To distinguish between an empty list and an error, call
-# error(), which will return undef if there was no error.  Farms out specific
-# statement to another subroutine for specific search types, but each case
-# should return ob_type and ob_name in that order.
-sub objects {
-    my ($self, $type, @args) = @_;
+# Calls the callback with each object stored in the wallet database, in
+# order, as a reference to a pair of type and name.  Stops if the callback
+# returns false.  Returns true on success and undef on failure, setting the
+# error.  Farms out specific statement to another subroutine for specific
+# search types.
+sub each_object {
+    my ($self, $callback, $type, @args) = @_;
     undef $self->{error};
 
     # Get the search and options array refs from specific functions.
@@ -218,66 +268,94 @@ sub objects {
         } else {
             $self->error ("do not know search type: $type");
         }
-        return unless $search_ref;
+
+        # An unknown owner or ACL is an empty report rather than an error.
+        return ($self->{error} ? undef : 1) unless $search_ref;
     }
 
     # Perform the search and return on any errors.
-    my @objects;
-    my $schema = $self->{schema};
     eval {
-        my @objects_rs = $schema->resultset('Object')->search ($search_ref,
-                                                               $options_ref);
-        for my $object_rs (@objects_rs) {
-            push (@objects, [ $object_rs->ob_type, $object_rs->ob_name ]);
-        }
+        my $each = sub {
+            my ($object_rs) = @_;
+            return $callback->([ $object_rs->ob_type, $object_rs->ob_name ]);
+        };
+        $self->paged_search ('Object', $search_ref, $options_ref,
+                             [ qw(ob_type ob_name) ], $each);
     };
     if ($@) {
         $self->error ("cannot list objects: $@");
         return;
     }
+    return 1;
+}
 
+# Returns a list of all objects stored in the wallet database in the form of
+# type and name pairs.  On error and for an empty database, the empty list
+# will be returned.  To distinguish between an empty list and an error, call
+# error(), which will return undef if there was no error.  Takes the same
+# arguments as each_object after the callback.
+sub objects {
+    my ($self, @args) = @_;
+    my @objects;
+    my $add = sub { push (@objects, $_[0]); return 1 };
+    $self->each_object ($add, @args) or return;
     return @objects;
 }
 
-# Returns a list of all object_history records stored in the wallet database
-# including all of their fields.  On error and for an empty database, the
-# empty list will be returned.  To distinguish between an empty list and an
-# error, call error(), which will return undef if there was no error.
-# Farms out specific statement to another subroutine for specific search
-# types, but each case should return ob_type and ob_name in that order.
-sub objects_history {
-    my ($self, $search_type, @args) = @_;
+# Calls the callback with each object_history record stored in the wallet
+# database, oldest first, as a reference to a list of its fields.  Stops if
+# the callback returns false.  Returns true on success and undef on failure,
+# setting the error.  Takes an optional reference to a hash of options: type
+# and name restrict the history to one object, epoch returns the time in
+# seconds since epoch rather than as the database string, and since, until,
+# and limit are handled by Wallet::History.
+sub each_history {
+    my ($self, $callback, $search_type, $options) = @_;
     undef $self->{error};
+    $options ||= {};
 
     # All fields in the order we want to see them.
     my @fields = ('oh_on', 'oh_by', 'oh_type', 'oh_name', 'oh_action',
                   'oh_from');
 
-    # Get the search and options array refs from specific functions.
-    my %search  = ();
-    my %options = (order_by => \@fields,
-                   select   => \@fields);
+    # Restrict to one object if requested.
+    my %search;
+    if (defined $options->{type}) {
+        $search{oh_type} = $options->{type};
+        $search{oh_name} = $options->{name};
+    }
 
     # Perform the search and return on any errors.
-    my @objects;
     my $schema = $self->{schema};
     eval {
-        my @objects_rs
-            = $schema->resultset('ObjectHistory')->search (\%search,
-                                                           \%options);
-        for my $object_rs (@objects_rs) {
-            my @rec;
-            for my $field (@fields) {
-                push (@rec, $object_rs->get_column($field));
-            }
-            push (@objects, \@rec);
-        }
+        my $history = Wallet::History->new ($schema, $options);
+        my $each = sub {
+            my ($row) = @_;
+            my @entry = map { $row->get_column ($_) } @fields;
+            $entry[0] = $history->epoch ($entry[0]) if $options->{epoch};
+            return unless $callback->(\@entry);
+            return $history->add;
+        };
+        $history->search_rows ('ObjectHistory', 'oh_on', \%search,
+                               [qw(oh_on oh_id)], $each);
     };
     if ($@) {
         $self->error ("cannot list objects: $@");
         return;
     }
+    return 1;
+}
 
+# Returns a list of all object_history records stored in the wallet database
+# including all of their fields.  On error and for an empty database, the
+# empty list will be returned.  To distinguish between an empty list and an
+# error, call error(), which will return undef if there was no error.  Takes
+# the same arguments as each_history after the callback.
+sub objects_history {
+    my ($self, @args) = @_;
+    my @objects;
+    my $add = sub { push (@objects, $_[0]); return 1 };
+    $self->each_history ($add, @args) or return;
     return @objects;
 }
 
@@ -297,19 +375,36 @@ sub objects_hostname {
         return;
     }
 
+    # If the host of each object is stored, search on it directly.
+    my %options = (order_by => [ qw/ob_type ob_name/ ],
+                   select   => [ qw/ob_type ob_name/ ]);
+    my @objects;
+    my $schema = $self->{schema};
+    if (defined &Wallet::Config::object_host) {
+        eval {
+            my %search = (ob_host => $hostname);
+            my @objects_rs = $schema->resultset('Object')->search (\%search,
+                                                                   \%options);
+            for my $object_rs (@objects_rs) {
+                push (@objects, [ $object_rs->ob_type, $object_rs->ob_name ]);
+            }
+        };
+        if ($@) {
+            $self->error ("cannot list objects: $@");
+            return;
+        }
+        return @objects;
+    }
+
     # If we don't have a way to get host-based object lists, quit.
     unless (defined &Wallet::Config::is_for_host) {
         $self->error ('no host-based policy defined');
         return;
     }
 
-    # Search on all objects.
+    # Otherwise, search on all objects.
     my %search = ();
-    my %options = (order_by => [ qw/ob_type ob_name/ ],
-                   select   => [ qw/ob_type ob_name/ ]);
-
-    my @objects;
-    my $schema = $self->{schema};
+    my @policy = ($schema, $self->{policy});
     eval {
         my @objects_rs = $schema->resultset('Object')->search (\%search,
                                                                \%options);
@@ -319,7 +414,8 @@ sub objects_hostname {
         for my $object_rs (@objects_rs) {
             my $type = $object_rs->ob_type;
             my $name = $object_rs->ob_name;
-            next unless &Wallet::Config::is_for_host($type, $name, $hostname);
+            next unless &Wallet::Config::is_for_host($type, $name, $hostname,
+                                                     @policy);
             push (@objects, [ $type, $name ]);
         }
     };
@@ -356,278 +452,234 @@ sub types {
 # ACL reports
 ##############################################################################
 
-# Returns the array of all ACLs in the database.
+# Return the search and options to find all ACLs in the database.
 sub acls_all {
     my ($self) = @_;
-    my @acls;
-
-    my $schema = $self->{schema};
     my %search = ();
-    my %options = (order_by => [ qw/ac_id/ ],
-                   select   => [ qw/ac_id ac_name/ ]);
-
-    eval {
-        my @acls_rs = $schema->resultset('Acl')->search (\%search, \%options);
-        for my $acl_rs (@acls_rs) {
-            push (@acls, [ $acl_rs->ac_id, $acl_rs->ac_name ]);
-        }
-    };
-
-    if ($@) {
-        $self->error ("cannot list ACLs: $@");
-        return;
-    }
-    return (@acls);
+    my %options = (select => [ qw/ac_id ac_name/ ]);
+    return (\%search, \%options);
 }
 
-# Returns the array of all empty ACLs in the database.
+# Return the search and options to find all empty ACLs in the database.
 sub acls_empty {
     my ($self) = @_;
-    my @acls;
-
-    my $schema = $self->{schema};
     my %search = (ae_id => undef);
-    my %options = (join     => 'acl_entries',
-                   prefetch => 'acl_entries',
-                   order_by => [ qw/ac_id/ ],
-                   select   => [ qw/ac_id ac_name/ ]);
-
-    eval {
-        my @acls_rs = $schema->resultset('Acl')->search (\%search, \%options);
-        for my $acl_rs (@acls_rs) {
-            push (@acls, [ $acl_rs->ac_id, $acl_rs->ac_name ]);
-        }
-    };
-
-    if ($@) {
-        $self->error ("cannot list ACLs: $@");
-        return;
-    }
-    return (@acls);
+    my %options = (join   => 'acl_entries',
+                   select => [ qw/ac_id ac_name/ ]);
+    return (\%search, \%options);
 }
 
-# Returns the array of ACLs that nest a given ACL.
+# Return the search and options to find the ACLs that nest a given ACL.
 sub acls_nesting {
     my ($self, $name) = @_;
-    my @acls;
-
-    my $schema = $self->{schema};
     my %search = (ae_scheme     => 'nested',
                   ae_identifier => $name);
-    my %options = (join     => 'acl_entries',
-                   prefetch => 'acl_entries',
-                   order_by => [ qw/ac_id/ ],
-                   select   => [ qw/ac_id ac_name/ ]);
-
-    eval {
-        my @acls_rs = $schema->resultset('Acl')->search (\%search, \%options);
-        for my $acl_rs (@acls_rs) {
-            push (@acls, [ $acl_rs->ac_id, $acl_rs->ac_name ]);
-        }
-    };
-
-    if ($@) {
-        $self->error ("cannot list ACLs: $@");
-        return;
-    }
-    return (@acls);
+    my %options = (join   => 'acl_entries',
+                   select => [ qw/ac_id ac_name/ ]);
+    return (\%search, \%options);
 }
 
-# Returns the array of all ACLs containing the specified entry.  The given
-# identifier is automatically surrounded by wildcards to do a substring
-# search.
+# Return the search and options to find all ACLs containing the specified
+# entry.  The given identifier is automatically surrounded by wildcards to do
+# a substring search.
 sub acls_entry {
     my ($self, $type, $identifier) = @_;
-    my @acls;
-
-    my $schema = $self->{schema};
     my %search = (ae_scheme     => $type,
                   ae_identifier => { like => '%'.$identifier.'%' });
     my %options = (join     => 'acl_entries',
-                   prefetch => 'acl_entries',
-                   order_by => [ qw/ac_id/ ],
                    select   => [ qw/ac_id ac_name/ ],
                    distinct => 1);
-
-    eval {
-        my @acls_rs = $schema->resultset('Acl')->search (\%search, \%options);
-        for my $acl_rs (@acls_rs) {
-            push (@acls, [ $acl_rs->ac_id, $acl_rs->ac_name ]);
-        }
-    };
-
-    if ($@) {
-        $self->error ("cannot list ACLs: $@");
-        return;
-    }
-    return (@acls);
+    return (\%search, \%options);
 }
 
-# Returns the array of all unused ACLs.
+# Return the search and options to find all unused ACLs: those that are not
+# the owner or any other ACL of any object.  Each use is excluded with a NOT
+# EXISTS subquery on the indexed objects column, which SQLite, MySQL, and
+# PostgreSQL all run as an anti-join, so this is a single query.
 sub acls_unused {
     my ($self) = @_;
-    my @acls;
-
-    my $schema = $self->{schema};
-    my %search = (
-                  #'acls_owner.ob_owner'   => undef,
-                  #'acls_get.ob_owner'     => undef,
-                  #'acls_store.ob_owner'   => undef,
-                  #'acls_show.ob_owner'    => undef,
-                  #'acls_destroy.ob_owner' => undef,
-                  #'acls_flags.ob_owner'   => undef,
-                 );
-    my %options = (#join     => [ qw/acls_owner acls_get acls_store acls_show acls_destroy acls_flags/ ],
-                   order_by => [ qw/ac_id/ ],
-                   select   => [ qw/ac_id ac_name/ ]);
+    my $objects = $self->{schema}->resultset('Object');
+    my @unused;
+    for my $column (qw/ob_owner ob_acl_get ob_acl_store ob_acl_show
+                       ob_acl_destroy ob_acl_flags/) {
+        my %search = ("used.$column" => \'= me.ac_id');
+        my %options = (alias => 'used', columns => [ $column ]);
+        my $query = $objects->search (\%search, \%options)->as_query;
+        my ($sql, @bind) = @$$query;
+        push (@unused, \[ "NOT EXISTS $sql", @bind ]);
+    }
+    my %search = (-and => \@unused);
+    my %options = (select => [ qw/ac_id ac_name/ ]);
+    return (\%search, \%options);
+}
 
+# Duplicate ACL detection unfortunately needs to do something more complex
+# than just return a SQL statement, so it's handled differently than other
+# reports.  All ACL entries are read in one scan, ordered by ACL and entry, a
+# digest of the entries of each ACL is computed, and the ACLs are grouped by
+# digest.  Returns a list of sets of duplicates, each a sorted list of ACL
+# names, sorted by their first names.  On error, returns the empty list and
+# sets the internal error.
+sub acls_duplicate {
+    my ($self) = @_;
+    my %groups;
     eval {
-        my @acls_rs = $schema->resultset('Acl')->search (\%search, \%options);
-
-        # FIXME: Almost certainly a way of doing this with the search itself.
-        for my $acl_rs (@acls_rs) {
-            next if $acl_rs->acls_owner->first;
-            next if $acl_rs->acls_get->first;
-            next if $acl_rs->acls_store->first;
-            next if $acl_rs->acls_show->first;
-            next if $acl_rs->acls_destroy->first;
-            next if $acl_rs->acls_flags->first;
-            push (@acls, [ $acl_rs->ac_id, $acl_rs->ac_name ]);
+        my @columns = qw(me.ac_id me.ac_name acl_entries.ae_scheme
+                         acl_entries.ae_identifier);
+        my @names = qw(ac_id ac_name ae_scheme ae_identifier);
+        my %options = (join     => 'acl_entries',
+                       select   => \@columns,
+                       as       => \@names,
+                       order_by => [ @columns[0, 2, 3] ]);
+        my $rs = $self->{schema}->resultset('Acl')->search ({}, \%options);
+        my $cursor = $rs->cursor;
+
+        # Each entry is added to the digest with the lengths of the scheme
+        # and identifier so that no two different lists of entries can be
+        # confused.  ACLs with no entries have one row with null entries.
+        my ($id, $name, $digest);
+        while (my ($acl, $acl_name, $scheme, $identifier) = $cursor->next) {
+            if (!defined ($id) or $acl != $id) {
+                push (@{ $groups{$digest->digest} }, $name) if defined $id;
+                ($id, $name, $digest) = ($acl, $acl_name, Digest::MD5->new);
+            }
+            if (defined $scheme) {
+                $digest->add (pack ('N/a*N/a*', $scheme, $identifier));
+            }
         }
+        push (@{ $groups{$digest->digest} }, $name) if defined $id;
     };
-
     if ($@) {
         $self->error ("cannot list ACLs: $@");
         return;
     }
-    return (@acls);
+    my @result;
+    for my $group (values %groups) {
+        push (@result, [ sort @$group ]) if @$group > 1;
+    }
+    return sort { $a->[0] cmp $b->[0] } @result;
 }
 
-# Obtain a textual representation of the membership of an ACL, returning undef
-# on error and setting the internal error.  Make sure the membership is sorted
-# so that comparisons are possible.
-sub acl_membership {
-    my ($self, $id) = @_;
-    my $acl = eval { Wallet::ACL->new ($id, $self->{schema}) };
-    if ($@) {
-        $self->error ($@);
+# Calls the callback with each ACL stored in the wallet database, possibly
+# limited by some criteria, as a reference to a pair of ACL ID and ACL name,
+# ordered by the given column (ac_id or ac_name).  For the duplicate search,
+# the callback is instead called with each set of duplicate ACL names.  Stops
+# if the callback returns false.  Returns true on success and undef on
+# failure, setting the error.
+sub acls_search {
+    my ($self, $key, $callback, $type, @args) = @_;
+    undef $self->{error};
+
+    # Find the search for the type of report.
+    my ($search, $options);
+    if (!defined $type || $type eq '') {
+        ($search, $options) = $self->acls_all;
+    } elsif ($type eq 'duplicate') {
+        my @groups = $self->acls_duplicate;
+        return if (!@groups && $self->{error});
+        for my $group (@groups) {
+            last unless $callback->($group);
+        }
+        return 1;
+    } elsif ($type eq 'entry') {
+        if (@args == 0) {
+            $self->error ('ACL searches require an argument to search');
+            return;
+        }
+        ($search, $options) = $self->acls_entry (@args);
+    } elsif ($type eq 'empty') {
+        ($search, $options) = $self->acls_empty;
+    } elsif ($type eq 'unused') {
+        ($search, $options) = $self->acls_unused;
+    } elsif ($type eq 'nesting') {
+        if (@args == 0) {
+            $self->error ('ACL nesting search requires an ACL to search');
+            return;
+        }
+        ($search, $options) = $self->acls_nesting (@args);
+    } else {
+        $self->error ("unknown search type: $type");
         return;
     }
-    my @entries = $acl->list;
-    @entries = sort { $a->[0] cmp $b->[0] || $a->[1] cmp $b->[1] } $acl->list;
-    my @members = map { "$_->[0] $_->[1]" } @entries;
-    if (!@members && $acl->error) {
-        $self->error ($acl->error);
+
+    # Perform the search and return on any errors.
+    eval {
+        my $each = sub {
+            my ($acl_rs) = @_;
+            return $callback->([ $acl_rs->ac_id, $acl_rs->ac_name ]);
+        };
+        $self->paged_search ('Acl', $search, $options, [ $key ], $each);
+    };
+    if ($@) {
+        $self->error ("cannot list ACLs: $@");
         return;
     }
-    return join ("\n", @members);
+    return 1;
 }
 
-# Duplicate ACL detection unfortunately needs to do something more complex
-# than just return a SQL statement, so it's handled differently than other
-# reports.  All the work is done here and the results returned as a list of
-# sets of duplicates.
-sub acls_duplicate {
-    my ($self) = @_;
-    my @acls = sort map { $_->[1] } $self->acls;
-    return if (!@acls && $self->{error});
-    return if @acls < 2;
-    my %result;
-    for my $i (0 .. ($#acls - 1)) {
-        my $members = $self->acl_membership ($acls[$i]);
-        return unless defined $members;
-        for my $j (($i + 1) .. $#acls) {
-            my $check = $self->acl_membership ($acls[$j]);
-            return unless defined $check;
-            if ($check eq $members) {
-                $result{$acls[$i]} ||= [];
-                push (@{ $result{$acls[$i]} }, $acls[$j]);
-            }
-        }
-    }
-    my @result;
-    for my $acl (sort keys %result) {
-        push (@result, [ $acl, sort @{ $result{$acl} } ]);
-    }
-    return @result;
+# Calls the callback with each ACL stored in the wallet database, possibly
+# limited by some criteria, in order by name.  See acls_search for the
+# details.
+sub each_acl {
+    my ($self, $callback, @args) = @_;
+    return $self->acls_search ('ac_name', $callback, @args);
 }
 
 # Returns a list of all ACLs stored in the wallet database as a list of pairs
-# of ACL IDs and ACL names, possibly limited by some criteria.  On error and
-# for an empty database, the empty list will be returned.  To distinguish
-# between an empty list and an error, call error(), which will return undef if
-# there was no error.
+# of ACL IDs and ACL names, possibly limited by some criteria, in order by
+# ID.  On error and for an empty database, the empty list will be returned.
+# To distinguish between an empty list and an error, call error(), which will
+# return undef if there was no error.
 sub acls {
-    my ($self, $type, @args) = @_;
-    undef $self->{error};
-
-    # Find the ACLs for any given search.
+    my ($self, @args) = @_;
     my @acls;
-    if (!defined $type || $type eq '') {
-        @acls = $self->acls_all;
-    } else {
-        if ($type eq 'duplicate') {
-            return $self->acls_duplicate;
-        } elsif ($type eq 'entry') {
-            if (@args == 0) {
-                $self->error ('ACL searches require an argument to search');
-                return;
-            } else {
-                @acls = $self->acls_entry (@args);
-            }
-        } elsif ($type eq 'empty') {
-            @acls = $self->acls_empty;
-        } elsif ($type eq 'unused') {
-            @acls = $self->acls_unused;
-        } elsif ($type eq 'nesting') {
-            if (@args == 0) {
-                $self->error ('ACL nesting search requires an ACL to search');
-                return;
-            } else {
-                @acls = $self->acls_nesting (@args);
-            }
-        } else {
-            $self->error ("unknown search type: $type");
-            return;
-        }
-    }
+    my $add = sub { push (@acls, $_[0]); return 1 };
+    $self->acls_search ('ac_id', $add, @args) or return;
     return @acls;
 }
 
-# Returns all ACL entries contained in owner ACLs for matching objects.
-# Objects are specified by type and name, which may be SQL wildcard
-# expressions.  Each list member will be a pair of ACL scheme and ACL
-# identifier, with duplicates removed.  On error and for no matching entries,
-# the empty list will be returned.  To distinguish between an empty return and
-# an error, call error(), which will return undef if there was no error.
-sub owners {
-    my ($self, $type, $name) = @_;
+# Calls the callback with each ACL entry contained in owner ACLs for matching
+# objects, as a reference to a pair of ACL scheme and ACL identifier, with
+# duplicates removed.  Objects are specified by type and name, which may be
+# SQL wildcard expressions.  Stops if the callback returns false.  Returns
+# true on success and undef on failure, setting the error.
+sub each_owner {
+    my ($self, $callback, $type, $name) = @_;
     undef $self->{error};
-    my $schema = $self->{schema};
-
-    my @owners;
     eval {
         my %search = (
                       'acls_owner.ob_type' => { like => $type },
                       'acls_owner.ob_name' => { like => $name });
         my %options = (
                        join     => { 'acls' => 'acls_owner' },
-                       order_by => [ qw/ae_scheme ae_identifier/ ],
+                       columns  => [ qw/ae_scheme ae_identifier/ ],
                        distinct => 1,
                       );
-
-        my @acls_rs = $schema->resultset('AclEntry')->search (\%search,
-                                                              \%options);
-        for my $acl_rs (@acls_rs) {
-            my $scheme = $acl_rs->ae_scheme;
-            my $identifier = $acl_rs->ae_identifier;
-            push (@owners, [ $scheme, $identifier ]);
-        }
+        my $each = sub {
+            my ($acl_rs) = @_;
+            return $callback->([ $acl_rs->ae_scheme, $acl_rs->ae_identifier ]);
+        };
+        $self->paged_search ('AclEntry', \%search, \%options,
+                             [ qw/ae_scheme ae_identifier/ ], $each);
     };
     if ($@) {
         $self->error ("cannot report on owners: $@");
         return;
     }
+    return 1;
+}
+
+# Returns all ACL entries contained in owner ACLs for matching objects.
+# Objects are specified by type and name, which may be SQL wildcard
+# expressions.  Each list member will be a pair of ACL scheme and ACL
+# identifier, with duplicates removed.  On error and for no matching entries,
+# the empty list will be returned.  To distinguish between an empty return and
+# an error, call error(), which will return undef if there was no error.
+sub owners {
+    my ($self, @args) = @_;
+    my @owners;
+    my $add = sub { push (@owners, $_[0]); return 1 };
+    $self->each_owner ($add, @args) or return;
     return @owners;
 }
 
@@ -652,29 +704,142 @@ sub acl_schemes {
 # Auditing
 ##############################################################################
 
+# Check each of the given items with the check function, which returns true
+# if the item fails, in the given number of worker processes, and return the
+# items that fail in their original order.  If a progress callback is given,
+# it is called with the number of items checked so far and the total every
+# $AUDIT_PROGRESS items and at the end.  Throws an exception on failure.
+#
+# The first item is checked in this process before the workers are started,
+# so anything that the policy caches on first use is loaded once and then
+# shared, read-only, by all of the workers.  The rest of the items are split
+# into one contiguous partition per worker, and each worker sends back the
+# index of each item that fails and its progress, so concatenating the
+# failures of each partition in order keeps them in order.
+sub audit_items {
+    my ($self, $items, $check, $workers, $progress) = @_;
+    my $total = @$items;
+    return unless $total;
+    my @failed;
+    push (@failed, $items->[0]) if $check->($items->[0]);
+    my $done = 1;
+
+    # With one worker, just check everything here.
+    if ($workers <= 1 or $total == 1) {
+        for my $i (1 .. $total - 1) {
+            push (@failed, $items->[$i]) if $check->($items->[$i]);
+            $done++;
+            if ($progress and $done % $AUDIT_PROGRESS == 0) {
+                $progress->($done, $total);
+            }
+        }
+        $progress->($done, $total) if $progress;
+        return @failed;
+    }
+
+    # Start the workers, each with a pipe on which to send back results.
+    my $size = int (($total - 1 + $workers - 1) / $workers);
+    my @workers;
+    for (my $start = 1; $start < $total; $start += $size) {
+        my $end = $start + $size - 1;
+        $end = $total - 1 if $end > $total - 1;
+        pipe (my $reader, my $writer) or die "cannot create pipe: $!\n";
+        my $pid = fork;
+        die "cannot fork: $!\n" unless defined $pid;
+        if ($pid == 0) {
+            close $reader;
+            my $output = '';
+            eval {
+                for my $i ($start .. $end) {
+                    $output .= "F $i\n" if $check->($items->[$i]);
+                    if (($i - $start + 1) % $AUDIT_PROGRESS == 0) {
+                        syswrite ($writer, "${output}P $AUDIT_PROGRESS\n");
+                        $output = '';
+                    }
+                }
+                my $count = ($end - $start + 1) % $AUDIT_PROGRESS;
+                $output .= "P $count\n" if $count;
+                syswrite ($writer, "${output}D\n");
+            };
+            if ($@) {
+                my $error = $@;
+                $error =~ s/\n/ /g;
+                syswrite ($writer, "E $error\n");
+            }
+            close $writer;
+            _exit (0);
+        }
+        close $writer;
+        push (@workers, { pid => $pid, reader => $reader, buffer => '',
+                          failed => [] });
+    }
+
+    # Read the results from each worker as they come in.
+    my %workers = map { fileno ($_->{reader}) => $_ } @workers;
+    my $select = IO::Select->new (map { $_->{reader} } @workers);
+    my $error;
+    while ($select->count) {
+        for my $fh ($select->can_read) {
+            my $worker = $workers{fileno ($fh)};
+            my $buffer = \$worker->{buffer};
+            my $count = sysread ($fh, $$buffer, 65536, length ($$buffer));
+            if (!$count) {
+                $select->remove ($fh);
+                close $fh;
+                next;
+            }
+            while ($$buffer =~ s/^(.*)\n//) {
+                my $line = $1;
+                if ($line =~ /^F (\d+)\z/) {
+                    push (@{ $worker->{failed} }, $items->[$1]);
+                } elsif ($line =~ /^P (\d+)\z/) {
+                    $done += $1;
+                    $progress->($done, $total) if $progress;
+                } elsif ($line eq 'D') {
+                    $worker->{finished} = 1;
+                } elsif ($line =~ /^E (.*)/) {
+                    $error = $1;
+                }
+            }
+        }
+    }
+    for my $worker (@workers) {
+        waitpid ($worker->{pid}, 0);
+        $error ||= 'audit worker failed' unless $worker->{finished};
+    }
+    die "$error\n" if $error;
+    push (@failed, @{ $_->{failed} }) for @workers;
+    return @failed;
+}
+
 # Audit the database for violations of local policy.  Returns a list of
 # objects (as type and name pairs) or a list of ACLs (as ID and name pairs).
 # On error and for no matching entries, the empty list will be returned.  To
 # distinguish between an empty return and an error, call error(), which will
-# return undef if there was no error.
+# return undef if there was no error.  Takes an optional reference to a hash
+# of options: workers is the number of worker processes to use (defaulting
+# to $Wallet::Config::AUDIT_WORKERS), and progress is a callback to call
+# with the number of items checked and the total as the audit runs.
 sub audit {
-    my ($self, $type, $audit) = @_;
+    my ($self, $type, $audit, $options) = @_;
     undef $self->{error};
+    $options ||= {};
     unless (defined ($type) and defined ($audit)) {
         $self->error ("type and audit not specified");
         return;
     }
+    my ($items, $check);
     if ($type eq 'objects') {
         if ($audit eq 'name') {
             return unless defined &Wallet::Config::verify_name;
-            my @objects = $self->objects;
-            my @results;
-            for my $object (@objects) {
-                my ($type, $name) = @$object;
-                my $error = Wallet::Config::verify_name ($type, $name);
-                push (@results, $object) if $error;
-            }
-            return @results;
+            $items = [ $self->objects ];
+            return if $self->{error};
+            $check = sub {
+                my ($type, $name) = @{ $_[0] };
+                my @policy = ($self->{schema}, $self->{policy});
+                return Wallet::Config::verify_name ($type, $name, undef,
+                                                    @policy);
+            };
         } else {
             $self->error ("unknown object audit: $audit");
             return;
@@ -682,13 +847,13 @@ sub audit {
     } elsif ($type eq 'acls') {
         if ($audit eq 'name') {
             return unless defined &Wallet::Config::verify_acl_name;
-            my @acls = $self->acls;
-            my @results;
-            for my $acl (@acls) {
-                my $error = Wallet::Config::verify_acl_name ($acl->[1]);
-                push (@results, $acl) if $error;
-            }
-            return @results;
+            $items = [ $self->acls ];
+            return if $self->{error};
+            $check = sub {
+                my @policy = ($self->{schema}, $self->{policy});
+                return Wallet::Config::verify_acl_name ($_[0][1], undef,
+                                                        @policy);
+            };
         } else {
             $self->error ("unknown acl audit: $audit");
             return;
@@ -697,6 +862,15 @@ sub audit {
         $self->error ("unknown audit type: $type");
         return;
     }
+    my $workers = $options->{workers} || $Wallet::Config::AUDIT_WORKERS || 1;
+    my @results = eval {
+        $self->audit_items ($items, $check, $workers, $options->{progress});
+    };
+    if ($@) {
+        $self->error ("cannot audit $type: $@");
+        return;
+    }
+    return @results;
 }
 
 1;
@@ -722,6 +896,8 @@ ACL ACLs wildcard Allbery SQL tuples
         print "@$object\n";
     }
     @objects = $report->audit ('objects', 'name');
+    $report->each_object (sub { print "@{ $_[0] }\n" })
+        or die $report->error, "\n";
 
 =head1 DESCRIPTION
 
@@ -730,6 +906,13 @@ contents of the wallet database.  The format of the results returned
 depend on the type of search, but will generally be returned as a list of
 tuples identifying objects, ACLs, or ACL entries.
 
+The object, ACL, history, and owner reports can also be read one row at a
+time by passing a callback to each_object(), each_acl(), each_history(),
+or each_owner().  These read the database a page of rows at a time (set
+by $Wallet::Report::PAGE_SIZE, 1000 by default), continuing each page
+from the last row of the previous one, so the memory used does not depend
+on the size of the report.  The list methods are implemented with them.
+
 To use this object, several configuration variables must be set (at least
 the database configuration).  For information on those variables and how
 to set them, see L<Wallet::Config>.  For more information on the normal
@@ -741,8 +924,11 @@ user interface to the wallet server, see L<Wallet::Server>.
 
 =item new()
 
-Creates a new wallet report object and connects to the database.  On any
-error, this method throws an exception.
+Creates a new wallet report object and connects to the database.  If
+DB_REPLICA_INFO is set in the wallet configuration, the report object
+connects to that read-only replica of the database instead, falling back
+on the primary database if the replica can't be reached.  On any error,
+this method throws an exception.
 
 =back
 
@@ -768,9 +954,10 @@ and with an identifier containing that value.  C<unused> returns all ACLs
 that are not referenced by any object.
 
 The return value for everything except C<duplicate> is a list of
-references to pairs of ACL ID and name.  For example, if there are two
-ACLs in the database, one with name C<ADMIN> and ID 1 and one with name
-C<group/admins> and ID 3, acls() with no arguments would return:
+references to pairs of ACL ID and name, in order by ID.  For example, if
+there are two ACLs in the database, one with name C<ADMIN> and ID 1 and
+one with name C<group/admins> and ID 3, acls() with no arguments would
+return:
 
     ([ 1, 'ADMIN' ], [ 3, 'group/admins' ])
 
@@ -785,7 +972,7 @@ Returns the empty list on failure.  An error can be distinguished from
 empty search results by calling error().  error() is guaranteed to return
 the error message if there was an error and undef if there was no error.
 
-=item audit(TYPE, AUDIT)
+=item audit(TYPE, AUDIT[, OPTIONS])
 
 Audits the wallet database for violations of local policy.  TYPE is the
 general class of thing to audit, and AUDIT is the specific audit to
@@ -796,10 +983,34 @@ ID and name, that are not accepted by the verify_name() or
 verify_acl_name() function defined in the wallet configuration.  See
 L<Wallet::Config> for more information.
 
+OPTIONS, if given, is a reference to a hash of options.  C<workers> is
+the number of processes across which to split the audit, defaulting to
+the AUDIT_WORKERS setting in the wallet configuration.  The results are
+in the same order however many processes are used.  C<progress> is a
+callback that is called with the number of objects or ACLs checked so far
+and the total number every $Wallet::Report::AUDIT_PROGRESS (1000 by
+default) objects or ACLs and when the audit finishes.
+
 Returns the empty list on failure.  An error can be distinguished from
 empty search results by calling error().  error() is guaranteed to return
 the error message if there was an error and undef if there was no error.
 
+=item each_acl(CALLBACK[, TYPE [, SEARCH ... ]])
+
+=item each_history(CALLBACK, TYPE[, OPTIONS])
+
+=item each_object(CALLBACK[, TYPE [, SEARCH ... ]])
+
+=item each_owner(CALLBACK, TYPE, NAME)
+
+Call CALLBACK with each row of the report that acls(), objects_history(),
+objects(), or owners() respectively would return, as the rows are read
+from the database.  The remaining arguments are the same as for those
+methods, and each row is passed as the same array reference that would be
+in the returned list.  Reading stops if CALLBACK returns false.  The
+order is the same except that each_acl() returns ACLs in order by name
+rather than by ID.  Returns true on success and undef on failure.
+
 =item error()
 
 Returns the error of the last failing operation or undef if no operations
@@ -836,18 +1047,31 @@ empty search result, the caller should call error().  error() is
 guaranteed to return the error message if there was an error and undef if
 there was no error.
 
-=item objects_history(TYPE)
+=item objects_history(TYPE[, OPTIONS])
 
 Returns a dump of the entire object history table.  The return value is
 a list of references to each field in that table, in the following order:
 
     oh_on, oh_by, oh_type, oh_name, oh_action, oh_from
 
+OPTIONS, if given, is a reference to a hash of options.  If the C<type>
+and C<name> options are given, only the history of that object is
+returned.  The C<since>, C<until>, and C<limit> options restrict the
+history to a range of time and a maximum number of entries, starting
+with the oldest, as described in Wallet::History(3).  If the C<epoch>
+option is true, oh_on is returned in seconds since epoch rather than as
+the timestamp string from the database.  The history is read from the
+database a page at a time.
+
 =item objects_hostname(TYPE, HOSTNAME)
 
 Returns a list of all host-based objects for a given hostname.  The
 output is identical to the general objects command, but we need to
-separate this out because the way it searches is very different.
+separate this out because the way it searches is very different.  If the
+object_host() function is defined in the wallet configuration, this is a
+single indexed search on the host stored with each object.  Otherwise,
+the is_for_host() function is called for every object in the database.
+See Wallet::Config(3) for more information.
 
 Returns the empty list on failure.  To distinguish between this and an
 empty search result, the caller should call error().  error() is
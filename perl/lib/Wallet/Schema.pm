@@ -13,6 +13,7 @@ use 5.008;
 use strict;
 use warnings;
 
+use Time::HiRes qw(sleep);
 use Wallet::Config;
 
 use base 'DBIx::Class::Schema';
@@ -20,11 +21,67 @@ use base 'DBIx::Class::Schema';
 # Unlike all of the other wallet modules, this module's version is tied to the
 # version of the schema in the database.  It should only be changed on schema
 # changes, at least until better handling of upgrades is available.
-our $VERSION = '0.10';
-
-__PACKAGE__->load_namespaces;
+our $VERSION = '0.11';
+
+# The result classes, listed here so that they don't have to be found by
+# searching every directory in @INC on each startup as load_namespaces does.
+# This must be kept in sync with the modules in Wallet::Schema::Result.
+our @RESULTS = qw(Acl AclEntry AclHistory AclScheme Duo Enctype Flag
+                  Generation KeytabEnctype KeytabSync Object ObjectHistory
+                  SyncTarget Type);
+for my $result (@RESULTS) {
+    my $class = "Wallet::Schema::Result::$result";
+    __PACKAGE__->ensure_class_loaded ($class);
+    __PACKAGE__->register_class ($result, $class);
+}
 __PACKAGE__->load_components (qw/Schema::Versioned/);
 
+# Database errors that mean that a transaction may succeed if retried: SQLite
+# lock errors, deadlocks, and serialization failures.
+our $RETRY_ERRORS = qr{
+    database\ (?:table\ )?is\ locked
+  | deadlock
+  | could\ not\ serialize
+  | lock\ wait\ timeout
+}xi;
+
+# Statements that change the database.  Running one of these marks the
+# connection as written; see written().
+our $WRITE_STATEMENTS = qr{
+    \A \s* (?: INSERT | UPDATE | DELETE | REPLACE | CREATE | DROP | ALTER ) \b
+}xi;
+
+# The base delay in seconds before retrying a transaction.  The delay before
+# each retry is a random multiple of this that grows with each attempt.
+our $RETRY_DELAY = 0.05;
+
+##############################################################################
+# Internal functions
+##############################################################################
+
+# Return the statements to run on each new SQLite connection to apply the
+# SQLite settings from the wallet configuration.  Dies if any are invalid.
+sub _sqlite_pragmas {
+    my @pragmas;
+    my $timeout = $Wallet::Config::DB_SQLITE_BUSY_TIMEOUT;
+    if (defined $timeout) {
+        die "invalid DB_SQLITE_BUSY_TIMEOUT $timeout\n"
+            unless $timeout =~ /^\d+\z/;
+        push (@pragmas, "PRAGMA busy_timeout = $timeout");
+    }
+    my $mode = $Wallet::Config::DB_SQLITE_JOURNAL_MODE;
+    if (defined $mode) {
+        die "invalid DB_SQLITE_JOURNAL_MODE $mode\n" unless $mode =~ /^\w+\z/;
+        push (@pragmas, "PRAGMA journal_mode = $mode");
+    }
+    my $sync = $Wallet::Config::DB_SQLITE_SYNCHRONOUS;
+    if (defined $sync) {
+        die "invalid DB_SQLITE_SYNCHRONOUS $sync\n" unless $sync =~ /^\w+\z/;
+        push (@pragmas, "PRAGMA synchronous = $sync");
+    }
+    return @pragmas;
+}
+
 ##############################################################################
 # Core overrides
 ##############################################################################
@@ -47,16 +104,102 @@ sub connect {
         $dsn .= ";host=$Wallet::Config::DB_HOST" if $Wallet::Config::DB_HOST;
         $dsn .= ";port=$Wallet::Config::DB_PORT" if $Wallet::Config::DB_PORT;
     }
+    return $class->_connect ($dsn);
+}
+
+# Connect to the read-only replica of the database given by DB_REPLICA_INFO,
+# using the same driver and credentials as the primary database.  Unlike
+# connect, this connects immediately so that callers can fall back on the
+# primary database if the replica can't be reached.  Returns undef if no
+# replica is configured.  Throws an exception on failure.
+sub connect_replica {
+    my ($class) = @_;
+    return unless defined $Wallet::Config::DB_REPLICA_INFO;
+    unless ($Wallet::Config::DB_DRIVER) {
+        die "database connection information not configured\n";
+    }
+    my $dsn = "DBI:$Wallet::Config::DB_DRIVER:";
+    $dsn .= $Wallet::Config::DB_REPLICA_INFO;
+    my $schema = $class->_connect ($dsn);
+    eval { $schema->storage->ensure_connected };
+    if ($@) {
+        die "cannot connect to database replica: $@\n";
+    }
+    return $schema;
+}
+
+# Connect to the given DSN with the database credentials and attributes from
+# the wallet configuration.  Throws an exception on failure.
+sub _connect {
+    my ($class, $dsn) = @_;
     my $user = $Wallet::Config::DB_USER;
     my $pass = $Wallet::Config::DB_PASSWORD;
     my %attrs = (PrintError => 0, RaiseError => 1);
+    if ($Wallet::Config::DB_DRIVER eq 'SQLite') {
+        my @pragmas = _sqlite_pragmas;
+        $attrs{on_connect_do} = \@pragmas if @pragmas;
+    }
+
+    # Note when a statement that changes the database is run, for written().
+    # The flag is kept outside the database handle so that it survives
+    # reconnects.
+    my $state = {};
+    my $note = sub {
+        my ($statement) = @_;
+        $state->{written} = 1 if $statement =~ $WRITE_STATEMENTS;
+        return;
+    };
+    $attrs{Callbacks} = {
+        do             => sub { $note->($_[1]); return },
+        ChildCallbacks => {
+            execute => sub { $note->($_[0]->{Statement}); return },
+        },
+    };
     my $schema = eval { $class->SUPER::connect ($dsn, $user, $pass, \%attrs) };
     if ($@) {
         die "cannot connect to database: $@\n";
     }
+    $schema->{wallet_state} = $state;
     return $schema;
 }
 
+##############################################################################
+# Transactions
+##############################################################################
+
+# Returns true if a statement that changes the database has been run on this
+# connection.  Wallet::Server uses this to send later reads in the same
+# request to this connection rather than to a replica that may not yet have
+# the change.
+sub written {
+    my ($self) = @_;
+    return $self->{wallet_state}{written};
+}
+
+# Call the given code, which should do all of its work in one transaction
+# that it starts and commits, and call it again if it fails with a database
+# error that means the transaction could succeed if retried, up to
+# DB_RETRY_COUNT more times.  Other errors, and the last error if every retry
+# fails, are rethrown.  If a transaction is already open, the code is only
+# called once, since only the outermost transaction can be retried.  Returns
+# the return value of the code in scalar context.
+sub txn_retry {
+    my ($self, $code) = @_;
+    my $nested = $self->storage->transaction_depth;
+    my $retries = $Wallet::Config::DB_RETRY_COUNT || 0;
+    my $attempt = 0;
+    while (1) {
+        my $result = eval { $code->() };
+        return $result unless $@;
+        my $error = $@;
+        if ($nested or $attempt >= $retries or $error !~ $RETRY_ERRORS) {
+            die $error;
+        }
+        $attempt++;
+        sleep ($RETRY_DELAY * $attempt * (0.5 + rand));
+    }
+}
+
 1;
 
 __END__
@@ -67,7 +210,7 @@ __END__
 
 =for stopwords
 RaiseError PrintError AutoCommit ACL verifier API APIs enums keytab backend
-enctypes DBI Allbery
+enctypes DBI Allbery SQLite
 
 =head1 NAME
 
@@ -88,7 +231,47 @@ connect() will obtain the database connection information from the wallet
 configuration; see L<Wallet::Config> for more details.  It will also
 automatically set the RaiseError attribute to true and the PrintError and
 AutoCommit attributes to false, matching the assumptions made by the
-wallet database code.
+wallet database code.  For SQLite databases, it also applies the journal
+mode, busy timeout, and synchronous settings from the configuration to
+each new connection.
+
+connect_replica() connects in the same way to the read-only replica of the
+database given by DB_REPLICA_INFO, using the same driver and credentials,
+and returns undef if DB_REPLICA_INFO is not set.  Unlike connect(), it
+opens the connection immediately and throws an exception if the replica
+can't be reached.  Wallet::Server and
+Wallet::Report use it for commands that only read from the database.
+
+=head1 INSTANCE METHODS
+
+=over 4
+
+=item txn_retry(CODE)
+
+Calls CODE, which should start a transaction, do its work, and commit the
+transaction, and calls it again if it fails with a database error that
+means it may succeed if retried: a SQLite C<database is locked> error, a
+deadlock, or a serialization failure.  It is retried up to
+DB_RETRY_COUNT times (see L<Wallet::Config>), waiting a short, random, and
+increasing time before each retry.  Other errors, and the error from the
+last attempt, are rethrown.  If a transaction is already open when
+txn_retry() is called, CODE is only called once, since a nested
+transaction can't be retried on its own.  Returns whatever CODE returns,
+called in scalar context.
+
+Since CODE may be called more than once, it should not change anything
+outside the database until its transaction is committed.
+
+=item written()
+
+Returns true if a statement that changes the database (an INSERT, UPDATE,
+DELETE, REPLACE, CREATE, DROP, or ALTER statement) has been run on this
+connection, and false otherwise.  Transactions that only read, such as
+those used to list ACL entries, don't count.  Wallet::Server uses this to
+send reads to the primary database rather than to a replica after a
+change, so that the reads see the change.
+
+=back
 
 =head1 SCHEMA
 
@@ -151,6 +334,7 @@ in:
       ae_identifier       varchar(255) not null,
       primary key (ae_id, ae_scheme, ae_identifier));
   create index ae_id on acl_entries (ae_id);
+  create index ae_entry on acl_entries (ae_scheme, ae_identifier);
 
 ACLs may be referred to in the API via either the numeric ID or the
 human-readable name, but internally ACLs are always referenced by numeric
@@ -173,7 +357,7 @@ table.
       ah_by               varchar(255) not null,
       ah_from             varchar(255) not null,
       ah_on               datetime not null);
-  create index ah_acl on acl_history (ah_acl);
+  create index ah_acl on acl_history (ah_acl, ah_on);
 
 ah_action must be one of C<create>, C<destroy>, C<add>, C<remove>, or
 C<rename> (enums aren't used for compatibility with databases other than
@@ -193,7 +377,8 @@ Each object stored in the wallet is represented by an entry in the objects
 table:
 
   create table objects
-     (ob_type             varchar(16)
+     (ob_id               integer auto_increment primary key,
+      ob_type             varchar(16)
           not null references types(ty_name),
       ob_name             varchar(255) not null,
       ob_owner            integer default null references acls(ac_id),
@@ -213,31 +398,39 @@ table:
       ob_downloaded_from  varchar(255) default null,
       ob_downloaded_on    datetime default null,
       ob_comment          varchar(255) default null,
-      primary key (ob_name, ob_type));
+      ob_host             varchar(255) default null,
+      unique (ob_name, ob_type));
   create index ob_owner on objects (ob_owner);
   create index ob_expires on objects (ob_expires);
+  create index ob_stored_on on objects (ob_stored_on);
+  create index ob_downloaded_on on objects (ob_downloaded_on);
+  create index ob_host on objects (ob_host);
 
 Object names are not globally unique but only unique within their type, so
-the table has a joint primary key.  Each object has an owner and then up
+the type and name together are unique.  Each object is also assigned a
+numeric ID, which is used to refer to it from the tables holding its flags
+and type-specific data so that those tables don't repeat the name.  Each
+object has an owner and then up
 to five more specific ACLs.  The owner provides permission for get, store,
 and show operations if no more specific ACL is set.  It does not provide
-permission for destroy or flags.
+permission for destroy or flags.  ob_host holds the host that the object
+is for, if any, as determined by the local object_host policy function.
 
 The ob_acl_flags ACL controls who can set flags on this object.  Each
 object may have zero or more flags associated with it:
 
   create table flags
-     (fl_type             varchar(16)
-          not null references objects(ob_type),
-      fl_name             varchar(255)
-          not null references objects(ob_name),
+     (fl_object           integer
+          not null references objects(ob_id),
       fl_flag             enum('locked', 'unchanging')
           not null,
-      primary key (fl_type, fl_name, fl_flag));
-  create index fl_object on flags (fl_type, fl_name);
+      primary key (fl_object, fl_flag));
+  create index fl_flag on flags (fl_flag);
 
 Every change made to any object in the wallet database will be recorded in
-this table:
+this table.  The history refers to objects by type and name rather than by
+ID, since it is kept after the object is destroyed and may outlive several
+objects with the same name:
 
   create table object_history
      (oh_id               integer auto_increment primary key,
@@ -253,7 +446,8 @@ this table:
       oh_by               varchar(255) not null,
       oh_from             varchar(255) not null,
       oh_on               datetime not null);
-  create index oh_object on object_history (oh_type, oh_name);
+  create index oh_object on object_history (oh_type, oh_name, oh_on);
+  create index oh_on on object_history (oh_on);
 
 oh_action must be one of C<create>, C<destroy>, C<get>, C<store>, or
 C<set>.  oh_field must be one of C<owner>, C<acl_get>, C<acl_store>,
@@ -284,8 +478,8 @@ Duo integration objects store some additional metadata about the
 integration to aid in synchronization with Duo.
 
   create table duo
-     (du_name             varchar(255)
-          not null references objects(ob_name),
+     (du_object           integer primary key
+          references objects(ob_id) on delete cascade,
       du_key              varchar(255) not null);
   create index du_key on duo (du_key);
 
@@ -306,12 +500,11 @@ and then the synchronization targets for a given keytab are stored in this
 table:
 
   create table keytab_sync
-     (ks_name             varchar(255)
-          not null references objects(ob_name),
+     (ks_object           integer
+          not null references objects(ob_id),
       ks_target           varchar(255)
           not null references sync_targets(st_name),
-      primary key (ks_name, ks_target));
-  create index ks_name on keytab_sync (ks_name);
+      primary key (ks_object, ks_target));
 
 The keytab backend supports restricting the allowable enctypes for a given
 keytab.  The permitted enctypes are listed in a normalization table:
@@ -322,12 +515,11 @@ keytab.  The permitted enctypes are listed in a normalization table:
 and then the restrictions for a given keytab are stored in this table:
 
   create table keytab_enctypes
-     (ke_name             varchar(255)
-          not null references objects(ob_name),
+     (ke_object           integer
+          not null references objects(ob_id),
       ke_enctype          varchar(255)
           not null references enctypes(en_name),
-      primary key (ke_name, ke_enctype));
-  create index ke_name on keytab_enctypes (ke_name);
+      primary key (ke_object, ke_enctype));
 
 To use this functionality, you will need to populate the enctypes table
 with the enctypes that a keytab may be restricted to.  Currently, there is
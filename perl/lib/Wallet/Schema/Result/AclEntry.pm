@@ -73,4 +73,14 @@ __PACKAGE__->has_one(
                      { 'foreign.as_name' => 'self.ae_scheme' },
                      { cascade_delete => 0 },
                     );
+
+# Add an index on scheme and identifier for finding the ACLs that contain a
+# given entry.
+sub sqlt_deploy_hook {
+    my ($self, $sqlt_table) = @_;
+    my $name = 'acl_entries_idx_ae_scheme_ae_identifier';
+    $sqlt_table->add_index (name   => $name,
+                            fields => [qw(ae_scheme ae_identifier)]);
+}
+
 1;
@@ -113,11 +113,12 @@ __PACKAGE__->add_columns(
 );
 __PACKAGE__->set_primary_key("ah_id");
 
-# Add an index on the ACL.
+# Add an index on the ACL and timestamp, for retrieving the history of an ACL
+# in order, and on the ACL name.
 sub sqlt_deploy_hook {
     my ($self, $sqlt_table) = @_;
-    my $name = 'acl_history_idx_ah_acl';
-    $sqlt_table->add_index (name => $name, fields => [qw(ah_acl)]);
+    my $name = 'acl_history_idx_ah_acl_ah_on';
+    $sqlt_table->add_index (name => $name, fields => [qw(ah_acl ah_on)]);
     $name = 'acl_history_idx_ah_name';
     $sqlt_table->add_index (name => $name, fields => [qw(ah_name)]);
 }
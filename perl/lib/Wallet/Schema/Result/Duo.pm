@@ -30,11 +30,10 @@ __PACKAGE__->table("duo");
 
 =head1 ACCESSORS
 
-=head2 du_name
+=head2 du_object
 
-  data_type: 'varchar'
+  data_type: 'integer'
   is_nullable: 0
-  size: 255
 
 =head2 du_key
 
@@ -45,21 +44,18 @@ __PACKAGE__->table("duo");
 =cut
 
 __PACKAGE__->add_columns(
-  "du_name",
-  { data_type => "varchar", is_nullable => 0, size => 255 },
-  "du_type",
-  { data_type => "varchar", is_nullable => 0, size => 16 },
+  "du_object",
+  { data_type => "integer", is_nullable => 0 },
   "du_key",
   { data_type => "varchar", is_nullable => 0, size => 255 },
 );
-__PACKAGE__->set_primary_key("du_name", "du_type");
+__PACKAGE__->set_primary_key("du_object");
 
 __PACKAGE__->belongs_to(
                         'object',
                         'Wallet::Schema::Result::Object',
-                        {
-                            'foreign.ob_type' => 'self.du_type',
-                            'foreign.ob_name' => 'self.du_name',
-                        },
+                        { 'foreign.ob_id' => 'self.du_object' },
+                        { on_delete => 'cascade', on_update => 'cascade',
+                          add_fk_index => 0 },
                        );
 1;
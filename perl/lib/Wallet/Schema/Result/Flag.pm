@@ -27,17 +27,10 @@ __PACKAGE__->table("flags");
 
 =head1 ACCESSORS
 
-=head2 fl_type
+=head2 fl_object
 
-  data_type: 'varchar'
-  is_nullable: 0
-  size: 16
-
-=head2 fl_name
-
-  data_type: 'varchar'
+  data_type: 'integer'
   is_nullable: 0
-  size: 255
 
 =head2 fl_flag
 
@@ -48,17 +41,21 @@ __PACKAGE__->table("flags");
 =cut
 
 __PACKAGE__->add_columns(
-  "fl_type" =>
-  { data_type => "varchar", is_nullable => 0, size => 16 },
-  "fl_name" =>
-  { data_type => "varchar", is_nullable => 0, size => 255 },
+  "fl_object" =>
+  { data_type => "integer", is_nullable => 0 },
   "fl_flag" => {
       data_type => 'enum',
       is_enum   => 1,
       extra     => { list => [qw/locked unchanging/] },
   },
 );
-__PACKAGE__->set_primary_key("fl_type", "fl_name", "fl_flag");
-
+__PACKAGE__->set_primary_key("fl_object", "fl_flag");
+
+# Add an index on the flag for finding all objects with a given flag set.
+sub sqlt_deploy_hook {
+    my ($self, $sqlt_table) = @_;
+    my $name = 'flags_idx_fl_flag';
+    $sqlt_table->add_index (name => $name, fields => [qw(fl_flag)]);
+}
 
 1;
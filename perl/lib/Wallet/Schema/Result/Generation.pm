@@ -0,0 +1,61 @@
+# Wallet schema for metadata generation counters.
+#
+# Written by Russ Allbery <eagle@eyrie.org>
+# Copyright 2026 Russ Allbery <eagle@eyrie.org>
+#
+# SPDX-License-Identifier: MIT
+
+package Wallet::Schema::Result::Generation;
+
+use strict;
+use warnings;
+
+use base 'DBIx::Class::Core';
+
+our $VERSION = '1.05';
+
+=for stopwords
+ACL
+
+=head1 NAME
+
+Wallet::Schema::Result::Generation - Wallet schema for generation counters
+
+=head1 DESCRIPTION
+
+This table holds counters that are incremented whenever data cached by
+wallet server processes changes, so that those processes can cheaply
+tell whether their caches are still valid.  The row named C<metadata>
+covers the object types, the ACL schemes, and the C<ADMIN> ACL cached by
+Wallet::Cache.  Wallet::Journal also adds a row for each history journal,
+named C<journal-> followed by a hash of the host name and journal path,
+counting the flushes of that journal.
+
+=cut
+
+__PACKAGE__->table("generations");
+
+=head1 ACCESSORS
+
+=head2 ge_name
+
+  data_type: 'varchar'
+  is_nullable: 0
+  size: 32
+
+=head2 ge_generation
+
+  data_type: 'integer'
+  is_nullable: 0
+
+=cut
+
+__PACKAGE__->add_columns(
+  "ge_name",
+  { data_type => "varchar", is_nullable => 0, size => 32 },
+  "ge_generation",
+  { data_type => "integer", is_nullable => 0 },
+);
+__PACKAGE__->set_primary_key("ge_name");
+
+1;
@@ -30,11 +30,10 @@ __PACKAGE__->table("keytab_enctypes");
 
 =head1 ACCESSORS
 
-=head2 ke_name
+=head2 ke_object
 
-  data_type: 'varchar'
+  data_type: 'integer'
   is_nullable: 0
-  size: 255
 
 =head2 ke_enctype
 
@@ -45,11 +44,11 @@ __PACKAGE__->table("keytab_enctypes");
 =cut
 
 __PACKAGE__->add_columns(
-  "ke_name",
-  { data_type => "varchar", is_nullable => 0, size => 255 },
+  "ke_object",
+  { data_type => "integer", is_nullable => 0 },
   "ke_enctype",
   { data_type => "varchar", is_nullable => 0, size => 255 },
 );
-__PACKAGE__->set_primary_key("ke_name", "ke_enctype");
+__PACKAGE__->set_primary_key("ke_object", "ke_enctype");
 
 1;
@@ -30,11 +30,10 @@ __PACKAGE__->table("keytab_sync");
 
 =head1 ACCESSORS
 
-=head2 ks_name
+=head2 ks_object
 
-  data_type: 'varchar'
+  data_type: 'integer'
   is_nullable: 0
-  size: 255
 
 =head2 ks_target
 
@@ -45,11 +44,11 @@ __PACKAGE__->table("keytab_sync");
 =cut
 
 __PACKAGE__->add_columns(
-  "ks_name",
-  { data_type => "varchar", is_nullable => 0, size => 255 },
+  "ks_object",
+  { data_type => "integer", is_nullable => 0 },
   "ks_target",
   { data_type => "varchar", is_nullable => 0, size => 255 },
 );
-__PACKAGE__->set_primary_key("ks_name", "ks_target");
+__PACKAGE__->set_primary_key("ks_object", "ks_target");
 
 1;
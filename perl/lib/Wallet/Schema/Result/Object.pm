@@ -29,6 +29,12 @@ __PACKAGE__->table("objects");
 
 =head1 ACCESSORS
 
+=head2 ob_id
+
+  data_type: 'integer'
+  is_auto_increment: 1
+  is_nullable: 0
+
 =head2 ob_type
 
   data_type: 'varchar'
@@ -137,9 +143,17 @@ __PACKAGE__->table("objects");
   is_nullable: 1
   size: 255
 
+=head2 ob_host
+
+  data_type: 'varchar'
+  is_nullable: 1
+  size: 255
+
 =cut
 
 __PACKAGE__->add_columns(
+  "ob_id",
+  { data_type => "integer", is_auto_increment => 1, is_nullable => 0 },
   "ob_type",
   { data_type => "varchar", is_nullable => 0, size => 16 },
   "ob_name",
@@ -194,8 +208,12 @@ __PACKAGE__->add_columns(
   },
   "ob_comment",
   { data_type => "varchar", is_nullable => 1, size => 255 },
+  "ob_host",
+  { data_type => "varchar", is_nullable => 1, size => 255 },
 );
-__PACKAGE__->set_primary_key("ob_name", "ob_type");
+__PACKAGE__->set_primary_key("ob_id");
+__PACKAGE__->add_unique_constraint("objects_ob_name_ob_type",
+                                   ["ob_name", "ob_type"]);
 
 __PACKAGE__->has_one(
                      'types',
@@ -206,8 +224,7 @@ __PACKAGE__->has_one(
 __PACKAGE__->has_many(
                       'flags',
                       'Wallet::Schema::Result::Flag',
-                      { 'foreign.fl_type' => 'self.ob_type',
-                        'foreign.fl_name' => 'self.ob_name' },
+                      { 'foreign.fl_object' => 'self.ob_id' },
                       { cascade_copy => 0, cascade_delete => 0 },
                      );
 
@@ -222,17 +239,24 @@ __PACKAGE__->has_many(
 __PACKAGE__->has_many(
                       'keytab_enctypes',
                       'Wallet::Schema::Result::KeytabEnctype',
-                      { 'foreign.ke_name' => 'self.ob_name' },
+                      { 'foreign.ke_object' => 'self.ob_id' },
                       { cascade_copy => 0, cascade_delete => 0 },
                      );
 
 __PACKAGE__->has_many(
                       'keytab_sync',
                       'Wallet::Schema::Result::KeytabSync',
-                      { 'foreign.ks_name' => 'self.ob_name' },
+                      { 'foreign.ks_object' => 'self.ob_id' },
                       { cascade_copy => 0, cascade_delete => 0 },
                      );
 
+__PACKAGE__->might_have(
+                        'duo',
+                        'Wallet::Schema::Result::Duo',
+                        { 'foreign.du_object' => 'self.ob_id' },
+                        { cascade_copy => 0, cascade_delete => 0 },
+                       );
+
 # References for all of the various potential ACLs.
 __PACKAGE__->belongs_to(
                         'acls_owner',
@@ -265,4 +289,15 @@ __PACKAGE__->belongs_to(
                         { 'foreign.ac_id' => 'self.ob_acl_flags' },
                        );
 
+# The ACL columns are indexed because of their foreign keys.  Also add indexes
+# on the timestamps used by the expiration and unused object reports and on
+# the host used by the host-based object report.
+sub sqlt_deploy_hook {
+    my ($self, $sqlt_table) = @_;
+    for my $column (qw(ob_expires ob_stored_on ob_downloaded_on ob_host)) {
+        my $name = "objects_idx_$column";
+        $sqlt_table->add_index (name => $name, fields => [ $column ]);
+    }
+}
+
 1;
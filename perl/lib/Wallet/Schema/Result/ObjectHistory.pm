@@ -127,11 +127,16 @@ __PACKAGE__->add_columns(
 );
 __PACKAGE__->set_primary_key("oh_id");
 
-# Add an index on object type and object name.
+# Add an index on object type, object name, and timestamp for retrieving the
+# history of an object, optionally limited to a range of time, and an index
+# on the timestamp alone for history reports and archiving.
 sub sqlt_deploy_hook {
     my ($self, $sqlt_table) = @_;
-    my $name = 'object_history_idx_oh_type_oh_name';
-    $sqlt_table->add_index (name => $name, fields => [qw(oh_type oh_name)]);
+    my $name = 'object_history_idx_oh_type_oh_name_oh_on';
+    $sqlt_table->add_index (name   => $name,
+                            fields => [qw(oh_type oh_name oh_on)]);
+    $name = 'object_history_idx_oh_on';
+    $sqlt_table->add_index (name => $name, fields => [qw(oh_on)]);
 }
 
 1;
@@ -18,7 +18,9 @@ use strict;
 use warnings;
 
 use Wallet::ACL;
+use Wallet::Cache;
 use Wallet::Config;
+use Wallet::Query;
 use Wallet::Schema;
 
 our $VERSION = '1.05';
@@ -32,16 +34,26 @@ our $VERSION = '1.05';
 # are sending wallet requests.  Opens a connection to the database that will
 # be used for all of the wallet metadata based on the wallet configuration
 # information.  We also instantiate the administrative ACL, which we'll use
-# for various things.  Throw an exception if anything goes wrong.
+# for various things, from the metadata cache after checking that the cache
+# is still valid.  The policy cache is passed to the policy functions in
+# the wallet configuration so that they can remember what they've looked up
+# for the life of this object.  The most common commands load objects and
+# ACLs through the prepared statements of Wallet::Query.  The read-only
+# commands may instead use a replica of the database; see reader.  Throw an
+# exception if anything goes wrong.
 sub new {
     my ($class, $user, $host) = @_;
     my $schema = Wallet::Schema->connect;
-    my $acl = Wallet::ACL->new ('ADMIN', $schema);
+    Wallet::Cache->check ($schema);
+    my $admin = Wallet::Cache->admin ($schema);
+    my $acl = Wallet::ACL->new ('ADMIN', $schema, $admin);
     my $self = {
         schema => $schema,
+        query  => Wallet::Query->new ($schema),
         user   => $user,
         host   => $host,
         admin  => $acl,
+        policy => {},
     };
     bless ($self, $class);
     return $self;
@@ -59,6 +71,30 @@ sub schema {
     return $self->{schema};
 }
 
+# Return the schema, query object, and ADMIN ACL to use for a read-only
+# command.  These are those of the replica database if DB_REPLICA_INFO is set
+# and nothing has been changed in the primary database through this object,
+# so that reads see our own writes, and otherwise those of the primary.  The
+# replica connection is opened the first time it's needed.  If that fails,
+# the primary is used for the life of this object.
+sub reader {
+    my ($self) = @_;
+    my @primary = @$self{qw(schema query admin)};
+    return @primary unless defined $Wallet::Config::DB_REPLICA_INFO;
+    return @primary if $self->{schema}->written;
+    unless (exists $self->{replica}) {
+        $self->{replica} = eval {
+            my $schema = Wallet::Schema->connect_replica;
+            Wallet::Cache->check ($schema);
+            my $admin = Wallet::Cache->admin ($schema);
+            my $acl = Wallet::ACL->new ('ADMIN', $schema, $admin);
+            [ $schema, Wallet::Query->new ($schema), $acl ];
+        };
+    }
+    return @primary unless $self->{replica};
+    return @{ $self->{replica} };
+}
+
 # Set or return the error stashed in the object.
 sub error {
     my ($self, @error) = @_;
@@ -78,24 +114,21 @@ sub DESTROY {
     if ($self->{schema}) {
         $self->{schema}->storage->dbh->disconnect;
     }
+    if ($self->{replica}) {
+        $self->{replica}[0]->storage->dbh->disconnect;
+    }
 }
 
 ##############################################################################
 # Object methods
 ##############################################################################
 
-# Given an object type, return the mapping to a class by querying the
-# database, or undef if no mapping exists.  Also load the relevant module.
+# Given an object type, return the mapping to a class from the metadata
+# cache, or undef if no mapping exists.  Also load the relevant module.
 sub type_mapping {
     my ($self, $type) = @_;
     my $class;
-    eval {
-        my $guard = $self->{schema}->txn_scope_guard;
-        my %search = (ty_name => $type);
-        my $type_rec = $self->{schema}->resultset('Type')->find (\%search);
-        $class = $type_rec->ty_class;
-        $guard->commit;
-    };
+    eval { $class = Wallet::Cache->type_class ($self->{schema}, $type) };
     if ($@) {
         $self->error ($@);
         return;
@@ -127,7 +160,9 @@ sub create_check {
         $self->error ("$user not authorized to create ${type}:${name}");
         return;
     }
-    my ($aname, @acl) = Wallet::Config::default_owner ($type, $name);
+    my ($aname, @acl)
+        = Wallet::Config::default_owner ($type, $name, $schema,
+                                         $self->{policy});
     unless (defined $aname) {
         $self->error ("$user not authorized to create ${type}:${name}");
         return;
@@ -208,7 +243,9 @@ sub create {
         return;
     }
     if (defined (&Wallet::Config::verify_name)) {
-        my $error = Wallet::Config::verify_name ($type, $name, $self->{user});
+        my $error = Wallet::Config::verify_name ($type, $name, $self->{user},
+                                                 $self->{schema},
+                                                 $self->{policy});
         if ($error) {
             $self->error ("${type}:${name} rejected: $error");
             return;
@@ -224,7 +261,9 @@ sub create {
 sub autocreate {
     my ($self, $type, $name) = @_;
     if (defined (&Wallet::Config::verify_name)) {
-        my $error = Wallet::Config::verify_name ($type, $name, $self->{user});
+        my $error = Wallet::Config::verify_name ($type, $name, $self->{user},
+                                                 $self->{schema},
+                                                 $self->{policy});
         if ($error) {
             $self->error ("${type}:${name} rejected: $error");
             return;
@@ -259,7 +298,8 @@ sub rename {
 
     # Validate the new name.
     if (defined (&Wallet::Config::verify_name)) {
-        my $error = Wallet::Config::verify_name ($type, $new_name, $user);
+        my $error = Wallet::Config::verify_name ($type, $new_name, $user,
+                                                 $schema, $self->{policy});
         if ($error) {
             $self->error ("${type}:${name} rejected: $error");
             return;
@@ -305,6 +345,33 @@ sub retrieve {
     }
 }
 
+# Given the name and type of an object, loads the object, the class for its
+# type, and its flags with a single query and returns a Perl object
+# representing it and the loaded data, for use with acl_verify.  If the
+# object or its type isn't found, falls back on retrieve so that the error is
+# the same.  Returns undef and sets the internal error on failure.
+sub load {
+    my ($self, $type, $name) = @_;
+    my $data = eval { $self->{query}->object ($type, $name) };
+    if ($@) {
+        $self->error ($@);
+        return;
+    }
+    return $self->retrieve ($type, $name) unless $data;
+    my $class = $data->{class};
+    eval "require $class";
+    if ($@) {
+        $self->error ($@);
+        return;
+    }
+    my $object = eval { $class->new ($type, $name, $self->{schema}, $data) };
+    if ($@) {
+        $self->error ($@);
+        return;
+    }
+    return ($object, $data);
+}
+
 # Sets the internal error variable to the correct message for permission
 # denied on an object.
 sub object_error {
@@ -326,8 +393,12 @@ sub object_error {
 # the internal error message.  Note that we do not allow any special access to
 # admins for get and store; if they want to do that with objects, they need to
 # set the ACL accordingly.
+#
+# If the object was returned by load, the loaded data may be passed as the
+# third argument.  The ACLs are then taken from it and each ACL needed is
+# loaded with only the entries that could match with one query.
 sub acl_verify {
-    my ($self, $object, $action) = @_;
+    my ($self, $object, $action, $data) = @_;
     my %actions = map { $_ => 1 }
         qw(get store show destroy flags setattr getattr comment);
     unless ($actions{$action}) {
@@ -335,29 +406,53 @@ sub acl_verify {
         return;
     }
     if ($action ne 'get' and $action ne 'store') {
-        return 1 if $self->{admin}->check ($self->{user});
+        my $admin = $self->{admin};
+        my $entries;
+        if ($data) {
+            my $loaded = eval {
+                $self->{query}->acl ($admin->id, $self->{user})
+            };
+            if ($@) {
+                $self->error ($@);
+                return;
+            }
+            $entries = $loaded ? $loaded->{entries} : [];
+        }
+        return 1 if $admin->check ($self->{user}, undef, undef, $entries);
     }
-    my $id;
+    my ($acl_type, $id);
     if ($action eq 'getattr') {
-        $id = $object->acl ('show');
+        $acl_type = 'show';
     } elsif ($action eq 'setattr') {
-        $id = $object->acl ('store');
+        $acl_type = 'store';
     } elsif ($action ne 'comment') {
-        $id = $object->acl ($action);
+        $acl_type = $action;
+    }
+    if (defined $acl_type) {
+        $id = $data ? $data->{"ob_acl_$acl_type"} : $object->acl ($acl_type);
     }
     if (! defined ($id) and $action ne 'flags') {
-        $id = $object->owner;
+        $id = $data ? $data->{ob_owner} : $object->owner;
     }
     unless (defined $id) {
         $self->object_error ($object, $action);
         return;
     }
-    my $acl = eval { Wallet::ACL->new ($id, $self->{schema}) };
+    my ($acl, $entries);
+    eval {
+        my $loaded;
+        if ($data) {
+            $loaded = $self->{query}->acl ($id, $self->{user});
+            die "ACL $id not found\n" unless $loaded;
+            $entries = $loaded->{entries};
+        }
+        $acl = Wallet::ACL->new ($id, $self->{schema}, $loaded);
+    };
     if ($@) {
         $self->error ($@);
         return;
     }
-    my $status = $acl->check ($self->{user});
+    my $status = $acl->check ($self->{user}, undef, undef, $entries);
     if ($status == 1) {
         return 1;
     } elsif (not defined $status) {
@@ -488,7 +583,8 @@ sub owner {
 # object.
 sub check {
     my ($self, $type, $name) = @_;
-    my $object = $self->retrieve ($type, $name);
+    local @$self{qw(schema query admin)} = $self->reader;
+    my ($object) = $self->load ($type, $name);
     if (not defined $object) {
         if ($self->error =~ /^cannot find/) {
             return 0;
@@ -505,9 +601,9 @@ sub check {
 # object using the default ACL mappings (if any).
 sub get {
     my ($self, $type, $name) = @_;
-    my $object = $self->retrieve ($type, $name);
+    my ($object, $loaded) = $self->load ($type, $name);
     return unless defined $object;
-    return unless $self->acl_verify ($object, 'get');
+    return unless $self->acl_verify ($object, 'get', $loaded);
     my $result = $object->get ($self->{user}, $self->{host});
     $self->error ($object->error) unless defined $result;
     return $result;
@@ -520,9 +616,9 @@ sub get {
 # creation of the object using the default ACL mappings (if any).
 sub update {
     my ($self, $type, $name) = @_;
-    my $object = $self->retrieve ($type, $name);
+    my ($object, $loaded) = $self->load ($type, $name);
     return unless defined $object;
-    return unless $self->acl_verify ($object, 'get');
+    return unless $self->acl_verify ($object, 'get', $loaded);
     my $result = $object->update ($self->{user}, $self->{host});
     $self->error ($object->error) unless defined $result;
     return $result;
@@ -535,9 +631,9 @@ sub update {
 # default ACL mappings (if any).
 sub store {
     my ($self, $type, $name, $data) = @_;
-    my $object = $self->retrieve ($type, $name);
+    my ($object, $loaded) = $self->load ($type, $name);
     return unless defined $object;
-    return unless $self->acl_verify ($object, 'store');
+    return unless $self->acl_verify ($object, 'store', $loaded);
     if (not defined ($data)) {
         $self->{error} = "no data supplied to store";
         return;
@@ -552,9 +648,10 @@ sub store {
 # user isn't authorized.
 sub show {
     my ($self, $type, $name) = @_;
-    my $object = $self->retrieve ($type, $name);
+    local @$self{qw(schema query admin)} = $self->reader;
+    my ($object, $loaded) = $self->load ($type, $name);
     return unless defined $object;
-    return unless $self->acl_verify ($object, 'show');
+    return unless $self->acl_verify ($object, 'show', $loaded);
     my $result = $object->show;
     $self->error ($object->error) unless defined $result;
     return $result;
@@ -562,13 +659,15 @@ sub show {
 
 # Return a human-readable description of the object history, or returns undef
 # and sets the internal error if the object can't be found or if the user
-# isn't authorized.
+# isn't authorized.  Takes an optional reference to a hash of options, which
+# are passed to the object's history method.
 sub history {
-    my ($self, $type, $name) = @_;
+    my ($self, $type, $name, $options) = @_;
+    local @$self{qw(schema query admin)} = $self->reader;
     my $object = $self->retrieve ($type, $name);
     return unless defined $object;
     return unless $self->acl_verify ($object, 'show');
-    my $result = $object->history;
+    my $result = $object->history ($options);
     $self->error ($object->error) unless defined $result;
     return $result;
 }
@@ -621,6 +720,7 @@ sub flag_set {
 # and undef if there was an error in checking the existence of the object.
 sub acl_check {
     my ($self, $id) = @_;
+    local @$self{qw(schema query admin)} = $self->reader;
     my $acl = eval { Wallet::ACL->new ($id, $self->{schema}) };
     if ($@) {
         if ($@ =~ /^ACL .* not found/) {
@@ -644,7 +744,9 @@ sub acl_create {
     my $user = $self->{user};
     my $host = $self->{host};
     if (defined (&Wallet::Config::verify_acl_name)) {
-        my $error = Wallet::Config::verify_acl_name ($name, $user);
+        my $error = Wallet::Config::verify_acl_name ($name, $user,
+                                                     $self->{schema},
+                                                     $self->{policy});
         if ($error) {
             $self->error ("$name rejected: $error");
             return;
@@ -676,8 +778,11 @@ sub acl_error {
 }
 
 # Display the history of an ACL or return undef and set the internal error.
+# Takes an optional reference to a hash of options, which are passed to the
+# ACL's history method.
 sub acl_history {
-    my ($self, $id) = @_;
+    my ($self, $id, $options) = @_;
+    local @$self{qw(schema query admin)} = $self->reader;
     unless ($self->{admin}->check ($self->{user})) {
         $self->acl_error ($id, 'history');
         return;
@@ -687,7 +792,7 @@ sub acl_history {
         $self->error ($@);
         return;
     }
-    my $result = $acl->history;
+    my $result = $acl->history ($options);
     if (not defined $result) {
         $self->error ($acl->error);
         return;
@@ -698,6 +803,7 @@ sub acl_history {
 # Display the membership of an ACL or return undef and set the internal error.
 sub acl_show {
     my ($self, $id) = @_;
+    local @$self{qw(schema query admin)} = $self->reader;
     unless ($self->{admin}->check ($self->{user})) {
         $self->acl_error ($id, 'show');
         return;
@@ -733,7 +839,9 @@ sub acl_rename {
         return;
     }
     if (defined (&Wallet::Config::verify_acl_name)) {
-        my $error = Wallet::Config::verify_acl_name ($name, $self->{user});
+        my $error = Wallet::Config::verify_acl_name ($name, $self->{user},
+                                                     $self->{schema},
+                                                     $self->{policy});
         if ($error) {
             $self->error ("$name rejected: $error");
             return;
@@ -890,6 +998,12 @@ To use this object, several configuration variables must be set (at least
 the database configuration).  For information on those variables and how
 to set them, see L<Wallet::Config>.
 
+If DB_REPLICA_INFO is set in the wallet configuration, the read-only
+methods (acl_check(), acl_history(), acl_show(), check(), history(), and
+show()) read from that replica of the database instead of the primary
+database, unless something has already been changed in the primary
+database through the same Wallet::Server object.
+
 =head1 CLASS METHODS
 
 =over 4
@@ -956,7 +1070,7 @@ object.  The ADMIN ACL may not be destroyed.  To destroy an ACL, the
 current user must be authorized by the ADMIN ACL.  Returns true on success
 and false on failure.
 
-=item acl_history(ID)
+=item acl_history(ID[, OPTIONS])
 
 Returns the history of the ACL identified by ID, which may be either the
 ACL name or its numeric ID.  To see the history of an ACL, the current
@@ -964,8 +1078,9 @@ user must be authorized by the ADMIN ACL.  Each change that modifies the
 ACL (not counting changes in the name of the ACL) will be represented by
 two lines.  The first line will have a timestamp of the change followed by
 a description of the change, and the second line will give the user who
-made the change and the host from which the change was made.  Returns
-undef on failure.
+made the change and the host from which the change was made.  OPTIONS,
+if given, is a reference to a hash of options passed to the history()
+method of Wallet::ACL.  Returns undef on failure.
 
 =item acl_remove(ID, SCHEME, IDENTIFIER)
 
@@ -1126,13 +1241,15 @@ special privileges to get objects.
 Returns undef on failure.  The caller should be careful to distinguish
 between undef and the empty string, which is valid object data.
 
-=item history(TYPE, NAME)
+=item history(TYPE, NAME[, OPTIONS])
 
 Returns (as a string) the human-readable history of the object identified
 by TYPE and NAME, or undef on error.  To see the object history, the
 current user must be a member of the ADMIN ACL, authorized by the show
 ACL, or authorized by the owner ACL; however, if the show ACL is set, the
-owner ACL will not be checked.
+owner ACL will not be checked.  OPTIONS, if given, is a reference to a
+hash of options passed to the history() method of the object.  See
+Wallet::Object::Base(3) for the supported options.
 
 =item owner(TYPE, NAME [, OWNER])
 
@@ -1152,9 +1269,18 @@ The owner of an object is permitted to get, store, and show that object,
 but cannot destroy or set flags on that object without being listed on
 those ACLs as well.
 
+=item reader()
+
+Returns the Wallet::Schema object, the Wallet::Query object, and the
+Wallet::ACL object for the C<ADMIN> ACL that the read-only methods use.
+These are for the replica database given by DB_REPLICA_INFO if it is set,
+the replica can be reached, and nothing has been changed in the primary
+database through this object, and otherwise are the same as those used by
+all other methods.  This is used mostly for testing.
+
 =item schema()
 
-Returns the DBIx::Class schema object.
+Returns the DBIx::Class schema object for the primary database.
 
 =item show(TYPE, NAME)
 
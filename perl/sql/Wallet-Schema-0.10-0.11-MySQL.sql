@@ -0,0 +1,83 @@
+-- Convert schema 'sql/Wallet-Schema-0.10-MySQL.sql' to 'Wallet::Schema v0.11':;
+
+BEGIN;
+
+ALTER TABLE acl_history DROP INDEX acl_history_idx_ah_acl,
+                        ADD INDEX acl_history_idx_ah_acl_ah_on (ah_acl, ah_on);
+
+ALTER TABLE object_history DROP INDEX object_history_idx_oh_type_oh_name,
+                           ADD INDEX object_history_idx_oh_type_oh_name_oh_on (oh_type, oh_name, oh_on),
+                           ADD INDEX object_history_idx_oh_on (oh_on);
+
+ALTER TABLE flags ADD INDEX flags_idx_fl_flag (fl_flag);
+
+ALTER TABLE acl_entries ADD INDEX acl_entries_idx_ae_scheme_ae_identifier (ae_scheme, ae_identifier);
+
+ALTER TABLE duo DROP FOREIGN KEY duo_fk_du_type_du_name,
+                DROP INDEX duo_idx_du_type_du_name;
+
+ALTER TABLE objects DROP PRIMARY KEY,
+                    ADD COLUMN ob_id integer NOT NULL auto_increment PRIMARY KEY FIRST,
+                    ADD UNIQUE objects_ob_name_ob_type (ob_name, ob_type),
+                    ADD COLUMN ob_host varchar(255) NULL,
+                    ADD INDEX objects_idx_ob_expires (ob_expires),
+                    ADD INDEX objects_idx_ob_stored_on (ob_stored_on),
+                    ADD INDEX objects_idx_ob_downloaded_on (ob_downloaded_on),
+                    ADD INDEX objects_idx_ob_host (ob_host);
+
+ALTER TABLE flags ADD COLUMN fl_object integer NULL FIRST;
+
+UPDATE flags JOIN objects ON ob_type = fl_type AND ob_name = fl_name SET fl_object = ob_id;
+
+DELETE FROM flags WHERE fl_object IS NULL;
+
+ALTER TABLE flags DROP PRIMARY KEY,
+                  DROP COLUMN fl_type, DROP COLUMN fl_name,
+                  MODIFY COLUMN fl_object integer NOT NULL,
+                  ADD PRIMARY KEY (fl_object, fl_flag);
+
+ALTER TABLE keytab_enctypes ADD COLUMN ke_object integer NULL FIRST;
+
+UPDATE keytab_enctypes JOIN objects ON ob_type = 'keytab' AND ob_name = ke_name SET ke_object = ob_id;
+
+DELETE FROM keytab_enctypes WHERE ke_object IS NULL;
+
+ALTER TABLE keytab_enctypes DROP PRIMARY KEY,
+                            DROP COLUMN ke_name,
+                            MODIFY COLUMN ke_object integer NOT NULL,
+                            ADD PRIMARY KEY (ke_object, ke_enctype);
+
+ALTER TABLE keytab_sync ADD COLUMN ks_object integer NULL FIRST;
+
+UPDATE keytab_sync JOIN objects ON ob_type = 'keytab' AND ob_name = ks_name SET ks_object = ob_id;
+
+DELETE FROM keytab_sync WHERE ks_object IS NULL;
+
+ALTER TABLE keytab_sync DROP PRIMARY KEY,
+                        DROP COLUMN ks_name,
+                        MODIFY COLUMN ks_object integer NOT NULL,
+                        ADD PRIMARY KEY (ks_object, ks_target);
+
+ALTER TABLE duo ADD COLUMN du_object integer NULL FIRST;
+
+UPDATE duo JOIN objects ON ob_type = du_type AND ob_name = du_name SET du_object = ob_id;
+
+DELETE FROM duo WHERE du_object IS NULL;
+
+ALTER TABLE duo DROP PRIMARY KEY,
+                DROP COLUMN du_type, DROP COLUMN du_name,
+                MODIFY COLUMN du_object integer NOT NULL,
+                ADD PRIMARY KEY (du_object),
+                ADD CONSTRAINT duo_fk_du_object FOREIGN KEY (du_object) REFERENCES objects (ob_id) ON DELETE CASCADE ON UPDATE CASCADE;
+
+CREATE TABLE generations (
+  ge_name varchar(32) NOT NULL,
+  ge_generation integer NOT NULL,
+  PRIMARY KEY (ge_name)
+);
+
+INSERT INTO generations (ge_name, ge_generation) VALUES ('metadata', 1);
+
+
+COMMIT;
+
@@ -0,0 +1,114 @@
+-- Convert schema 'sql/Wallet-Schema-0.10-PostgreSQL.sql' to 'sql/Wallet-Schema-0.11-PostgreSQL.sql':;
+
+BEGIN;
+
+DROP INDEX acl_history_idx_ah_acl;
+
+CREATE INDEX acl_history_idx_ah_acl_ah_on on acl_history (ah_acl, ah_on);
+
+DROP INDEX object_history_idx_oh_type_oh_name;
+
+CREATE INDEX object_history_idx_oh_type_oh_name_oh_on on object_history (oh_type, oh_name, oh_on);
+
+CREATE INDEX object_history_idx_oh_on on object_history (oh_on);
+
+CREATE INDEX flags_idx_fl_flag on flags (fl_flag);
+
+CREATE INDEX acl_entries_idx_ae_scheme_ae_identifier on acl_entries (ae_scheme, ae_identifier);
+
+CREATE INDEX objects_idx_ob_expires on objects (ob_expires);
+
+CREATE INDEX objects_idx_ob_stored_on on objects (ob_stored_on);
+
+CREATE INDEX objects_idx_ob_downloaded_on on objects (ob_downloaded_on);
+
+ALTER TABLE duo DROP CONSTRAINT duo_fk_du_type_du_name;
+
+DROP INDEX duo_idx_du_type_du_name;
+
+ALTER TABLE objects DROP CONSTRAINT objects_pkey;
+
+ALTER TABLE objects ADD COLUMN ob_id serial NOT NULL;
+
+ALTER TABLE objects ADD PRIMARY KEY (ob_id);
+
+ALTER TABLE objects ADD CONSTRAINT objects_ob_name_ob_type UNIQUE (ob_name, ob_type);
+
+ALTER TABLE objects ADD COLUMN ob_host character varying(255);
+
+CREATE INDEX objects_idx_ob_host on objects (ob_host);
+
+ALTER TABLE flags ADD COLUMN fl_object integer;
+
+UPDATE flags SET fl_object = ob_id FROM objects WHERE ob_type = fl_type AND ob_name = fl_name;
+
+DELETE FROM flags WHERE fl_object IS NULL;
+
+ALTER TABLE flags DROP CONSTRAINT flags_pkey;
+
+ALTER TABLE flags DROP COLUMN fl_type;
+
+ALTER TABLE flags DROP COLUMN fl_name;
+
+ALTER TABLE flags ALTER COLUMN fl_object SET NOT NULL;
+
+ALTER TABLE flags ADD PRIMARY KEY (fl_object, fl_flag);
+
+ALTER TABLE keytab_enctypes ADD COLUMN ke_object integer;
+
+UPDATE keytab_enctypes SET ke_object = ob_id FROM objects WHERE ob_type = 'keytab' AND ob_name = ke_name;
+
+DELETE FROM keytab_enctypes WHERE ke_object IS NULL;
+
+ALTER TABLE keytab_enctypes DROP CONSTRAINT keytab_enctypes_pkey;
+
+ALTER TABLE keytab_enctypes DROP COLUMN ke_name;
+
+ALTER TABLE keytab_enctypes ALTER COLUMN ke_object SET NOT NULL;
+
+ALTER TABLE keytab_enctypes ADD PRIMARY KEY (ke_object, ke_enctype);
+
+ALTER TABLE keytab_sync ADD COLUMN ks_object integer;
+
+UPDATE keytab_sync SET ks_object = ob_id FROM objects WHERE ob_type = 'keytab' AND ob_name = ks_name;
+
+DELETE FROM keytab_sync WHERE ks_object IS NULL;
+
+ALTER TABLE keytab_sync DROP CONSTRAINT keytab_sync_pkey;
+
+ALTER TABLE keytab_sync DROP COLUMN ks_name;
+
+ALTER TABLE keytab_sync ALTER COLUMN ks_object SET NOT NULL;
+
+ALTER TABLE keytab_sync ADD PRIMARY KEY (ks_object, ks_target);
+
+ALTER TABLE duo ADD COLUMN du_object integer;
+
+UPDATE duo SET du_object = ob_id FROM objects WHERE ob_type = du_type AND ob_name = du_name;
+
+DELETE FROM duo WHERE du_object IS NULL;
+
+ALTER TABLE duo DROP CONSTRAINT duo_pkey;
+
+ALTER TABLE duo DROP COLUMN du_type;
+
+ALTER TABLE duo DROP COLUMN du_name;
+
+ALTER TABLE duo ALTER COLUMN du_object SET NOT NULL;
+
+ALTER TABLE duo ADD PRIMARY KEY (du_object);
+
+ALTER TABLE duo ADD CONSTRAINT duo_fk_du_object FOREIGN KEY (du_object)
+  REFERENCES objects (ob_id) ON DELETE CASCADE ON UPDATE CASCADE DEFERRABLE;
+
+CREATE TABLE generations (
+  ge_name character varying(32) NOT NULL,
+  ge_generation integer NOT NULL,
+  PRIMARY KEY (ge_name)
+);
+
+INSERT INTO generations (ge_name, ge_generation) VALUES ('metadata', 1);
+
+
+COMMIT;
+
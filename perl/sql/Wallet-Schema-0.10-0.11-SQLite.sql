@@ -0,0 +1,196 @@
+-- Convert schema 'sql/Wallet-Schema-0.10-SQLite.sql' to 'sql/Wallet-Schema-0.11-SQLite.sql':;
+
+BEGIN;
+
+DROP INDEX acl_history_idx_ah_acl;
+
+CREATE INDEX acl_history_idx_ah_acl_ah_on ON acl_history (ah_acl, ah_on);
+
+DROP INDEX object_history_idx_oh_type_oh_name;
+
+CREATE INDEX object_history_idx_oh_type_oh_name_oh_on ON object_history (oh_type, oh_name, oh_on);
+
+CREATE INDEX object_history_idx_oh_on ON object_history (oh_on);
+
+CREATE INDEX acl_entries_idx_ae_scheme_ae_identifier ON acl_entries (ae_scheme, ae_identifier);
+
+CREATE TEMPORARY TABLE objects_temp_alter (
+  ob_type varchar(16) NOT NULL,
+  ob_name varchar(255) NOT NULL,
+  ob_owner integer,
+  ob_acl_get integer,
+  ob_acl_store integer,
+  ob_acl_show integer,
+  ob_acl_destroy integer,
+  ob_acl_flags integer,
+  ob_expires datetime,
+  ob_created_by varchar(255) NOT NULL,
+  ob_created_from varchar(255) NOT NULL,
+  ob_created_on datetime NOT NULL,
+  ob_stored_by varchar(255),
+  ob_stored_from varchar(255),
+  ob_stored_on datetime,
+  ob_downloaded_by varchar(255),
+  ob_downloaded_from varchar(255),
+  ob_downloaded_on datetime,
+  ob_comment varchar(255),
+  PRIMARY KEY (ob_name, ob_type)
+);
+
+INSERT INTO objects_temp_alter( ob_type, ob_name, ob_owner, ob_acl_get, ob_acl_store, ob_acl_show, ob_acl_destroy, ob_acl_flags, ob_expires, ob_created_by, ob_created_from, ob_created_on, ob_stored_by, ob_stored_from, ob_stored_on, ob_downloaded_by, ob_downloaded_from, ob_downloaded_on, ob_comment) SELECT ob_type, ob_name, ob_owner, ob_acl_get, ob_acl_store, ob_acl_show, ob_acl_destroy, ob_acl_flags, ob_expires, ob_created_by, ob_created_from, ob_created_on, ob_stored_by, ob_stored_from, ob_stored_on, ob_downloaded_by, ob_downloaded_from, ob_downloaded_on, ob_comment FROM objects;
+
+CREATE TEMPORARY TABLE flags_temp_alter (
+  fl_type varchar(16) NOT NULL,
+  fl_name varchar(255) NOT NULL,
+  fl_flag enum NOT NULL,
+  PRIMARY KEY (fl_type, fl_name, fl_flag)
+);
+
+INSERT INTO flags_temp_alter( fl_type, fl_name, fl_flag) SELECT fl_type, fl_name, fl_flag FROM flags;
+
+CREATE TEMPORARY TABLE keytab_enctypes_temp_alter (
+  ke_name varchar(255) NOT NULL,
+  ke_enctype varchar(255) NOT NULL,
+  PRIMARY KEY (ke_name, ke_enctype)
+);
+
+INSERT INTO keytab_enctypes_temp_alter( ke_name, ke_enctype) SELECT ke_name, ke_enctype FROM keytab_enctypes;
+
+CREATE TEMPORARY TABLE keytab_sync_temp_alter (
+  ks_name varchar(255) NOT NULL,
+  ks_target varchar(255) NOT NULL,
+  PRIMARY KEY (ks_name, ks_target)
+);
+
+INSERT INTO keytab_sync_temp_alter( ks_name, ks_target) SELECT ks_name, ks_target FROM keytab_sync;
+
+CREATE TEMPORARY TABLE duo_temp_alter (
+  du_name varchar(255) NOT NULL,
+  du_type varchar(16) NOT NULL,
+  du_key varchar(255) NOT NULL,
+  PRIMARY KEY (du_name, du_type)
+);
+
+INSERT INTO duo_temp_alter( du_name, du_type, du_key) SELECT du_name, du_type, du_key FROM duo;
+
+DROP TABLE duo;
+
+DROP TABLE keytab_sync;
+
+DROP TABLE keytab_enctypes;
+
+DROP TABLE flags;
+
+DROP TABLE objects;
+
+CREATE TABLE objects (
+  ob_id INTEGER PRIMARY KEY NOT NULL,
+  ob_type varchar(16) NOT NULL,
+  ob_name varchar(255) NOT NULL,
+  ob_owner integer,
+  ob_acl_get integer,
+  ob_acl_store integer,
+  ob_acl_show integer,
+  ob_acl_destroy integer,
+  ob_acl_flags integer,
+  ob_expires datetime,
+  ob_created_by varchar(255) NOT NULL,
+  ob_created_from varchar(255) NOT NULL,
+  ob_created_on datetime NOT NULL,
+  ob_stored_by varchar(255),
+  ob_stored_from varchar(255),
+  ob_stored_on datetime,
+  ob_downloaded_by varchar(255),
+  ob_downloaded_from varchar(255),
+  ob_downloaded_on datetime,
+  ob_comment varchar(255),
+  ob_host varchar(255),
+  FOREIGN KEY (ob_acl_destroy) REFERENCES acls(ac_id) ON DELETE CASCADE ON UPDATE CASCADE,
+  FOREIGN KEY (ob_acl_flags) REFERENCES acls(ac_id) ON DELETE CASCADE ON UPDATE CASCADE,
+  FOREIGN KEY (ob_acl_get) REFERENCES acls(ac_id) ON DELETE CASCADE ON UPDATE CASCADE,
+  FOREIGN KEY (ob_owner) REFERENCES acls(ac_id) ON DELETE CASCADE ON UPDATE CASCADE,
+  FOREIGN KEY (ob_acl_show) REFERENCES acls(ac_id) ON DELETE CASCADE ON UPDATE CASCADE,
+  FOREIGN KEY (ob_acl_store) REFERENCES acls(ac_id) ON DELETE CASCADE ON UPDATE CASCADE,
+  FOREIGN KEY (ob_type) REFERENCES types(ty_name)
+);
+
+CREATE INDEX objects_idx_ob_acl_destroy ON objects (ob_acl_destroy);
+
+CREATE INDEX objects_idx_ob_acl_flags ON objects (ob_acl_flags);
+
+CREATE INDEX objects_idx_ob_acl_get ON objects (ob_acl_get);
+
+CREATE INDEX objects_idx_ob_owner ON objects (ob_owner);
+
+CREATE INDEX objects_idx_ob_acl_show ON objects (ob_acl_show);
+
+CREATE INDEX objects_idx_ob_acl_store ON objects (ob_acl_store);
+
+CREATE INDEX objects_idx_ob_type ON objects (ob_type);
+
+CREATE INDEX objects_idx_ob_expires ON objects (ob_expires);
+
+CREATE INDEX objects_idx_ob_stored_on ON objects (ob_stored_on);
+
+CREATE INDEX objects_idx_ob_downloaded_on ON objects (ob_downloaded_on);
+
+CREATE INDEX objects_idx_ob_host ON objects (ob_host);
+
+CREATE UNIQUE INDEX objects_ob_name_ob_type ON objects (ob_name, ob_type);
+
+INSERT INTO objects( ob_type, ob_name, ob_owner, ob_acl_get, ob_acl_store, ob_acl_show, ob_acl_destroy, ob_acl_flags, ob_expires, ob_created_by, ob_created_from, ob_created_on, ob_stored_by, ob_stored_from, ob_stored_on, ob_downloaded_by, ob_downloaded_from, ob_downloaded_on, ob_comment) SELECT ob_type, ob_name, ob_owner, ob_acl_get, ob_acl_store, ob_acl_show, ob_acl_destroy, ob_acl_flags, ob_expires, ob_created_by, ob_created_from, ob_created_on, ob_stored_by, ob_stored_from, ob_stored_on, ob_downloaded_by, ob_downloaded_from, ob_downloaded_on, ob_comment FROM objects_temp_alter;
+
+CREATE TABLE flags (
+  fl_object integer NOT NULL,
+  fl_flag enum NOT NULL,
+  PRIMARY KEY (fl_object, fl_flag)
+);
+
+CREATE INDEX flags_idx_fl_flag ON flags (fl_flag);
+
+INSERT INTO flags( fl_object, fl_flag) SELECT ob_id, fl_flag FROM flags_temp_alter JOIN objects ON ob_type = fl_type AND ob_name = fl_name;
+
+CREATE TABLE keytab_enctypes (
+  ke_object integer NOT NULL,
+  ke_enctype varchar(255) NOT NULL,
+  PRIMARY KEY (ke_object, ke_enctype)
+);
+
+INSERT INTO keytab_enctypes( ke_object, ke_enctype) SELECT ob_id, ke_enctype FROM keytab_enctypes_temp_alter JOIN objects ON ob_type = 'keytab' AND ob_name = ke_name;
+
+CREATE TABLE keytab_sync (
+  ks_object integer NOT NULL,
+  ks_target varchar(255) NOT NULL,
+  PRIMARY KEY (ks_object, ks_target)
+);
+
+INSERT INTO keytab_sync( ks_object, ks_target) SELECT ob_id, ks_target FROM keytab_sync_temp_alter JOIN objects ON ob_type = 'keytab' AND ob_name = ks_name;
+
+CREATE TABLE duo (
+  du_object integer NOT NULL,
+  du_key varchar(255) NOT NULL,
+  PRIMARY KEY (du_object),
+  FOREIGN KEY (du_object) REFERENCES objects(ob_id) ON DELETE CASCADE ON UPDATE CASCADE
+);
+
+INSERT INTO duo( du_object, du_key) SELECT ob_id, du_key FROM duo_temp_alter JOIN objects ON ob_type = du_type AND ob_name = du_name;
+
+DROP TABLE objects_temp_alter;
+
+DROP TABLE flags_temp_alter;
+
+DROP TABLE keytab_enctypes_temp_alter;
+
+DROP TABLE keytab_sync_temp_alter;
+
+DROP TABLE duo_temp_alter;
+
+CREATE TABLE generations (
+  ge_name varchar(32) NOT NULL,
+  ge_generation integer NOT NULL,
+  PRIMARY KEY (ge_name)
+);
+
+INSERT INTO generations (ge_name, ge_generation) VALUES ('metadata', 1);
+
+COMMIT;
@@ -12,11 +12,12 @@ use strict;
 use warnings;
 
 use POSIX qw(strftime);
-use Test::More tests => 115;
+use Test::More tests => 143;
 
 use Wallet::ACL;
 use Wallet::Admin;
 use Wallet::Object::Base;
+use Wallet::Query;
 
 use lib 't/lib';
 use Util;
@@ -139,8 +140,10 @@ Members of ACL test (id: 2) are:
 EOE
 is ($acl->show, $expected, ' and show returns correctly');
 is ($acl->check ($user2), 1, ' and checking the good entry still works');
+is (scalar ($acl->check_errors), '', ' without consulting the bad entry');
+is ($acl->check ($user1), 0, ' but checking another user fails');
 is (scalar ($acl->check_errors), "malformed krb5 ACL\n",
-    ' but now with the right error');
+    ' with the right error');
 my @errors = $acl->check_errors;
 is (scalar (@errors), 1, ' and the error return is right in list context');
 is ($errors[0], 'malformed krb5 ACL', ' with the same text');
@@ -221,6 +224,17 @@ $date  rename from test
     by $admin from $host
 EOO
 is ($acl->history, $history, 'History is correct');
+is ($acl->history ({ limit => 2 }),
+    "$date  create\n    by $admin from $host\n"
+    . "$date  add krb5 $user1\n    by $admin from $host\n",
+    ' and can be limited');
+is ($acl->history ({ since => $trace[2], until => $trace[2] + 1 }), $history,
+    ' and can be restricted to a range of time');
+is ($acl->history ({ since => $trace[2] + 1 }), '',
+    ' and nothing is shown after the last change');
+is ($acl->history ({ limit => 'foo' }), undef, 'Invalid history limit fails');
+is ($acl->error, 'cannot read history for example: invalid limit foo',
+    ' with the right error');
 
 # Test destroy.
 $acl->destroy (@trace);
@@ -308,6 +322,52 @@ is ($obj_new->owner, 'example-new',
 is ($obj_unrelated->owner, 'example-other',
     ' and unrelated object ownership is correct');
 
+# Test checking a large ACL, which should find krb5 entries directly and fall
+# back on evaluating only the other entries.
+my $acl_large = eval { Wallet::ACL->create ('example-large', $schema, @trace) };
+ok (defined ($acl_large), 'Creating a large ACL');
+my $added = 0;
+for my $i (1 .. 100) {
+    $added++ if $acl_large->add ('krb5', "user$i\@EXAMPLE.COM", @trace);
+}
+is ($added, 100, ' and adding 100 krb5 entries');
+ok ($acl_large->add ('nested', 'example-new', @trace),
+    ' and adding a nested entry');
+ok ($acl_new->add ('krb5', $user1, @trace), ' and adding to the nested ACL');
+is ($acl_large->check ('user50@EXAMPLE.COM'), 1, ' and a member checks');
+is (scalar ($acl_large->check_errors), '', ' with no errors');
+is ($acl_large->check ('user500@EXAMPLE.COM'), 0, ' and a non-member fails');
+is (scalar ($acl_large->check_errors), '', ' with no errors');
+is ($acl_large->check ($user1), 1, ' and the nested ACL is still checked');
+is ($acl_large->check_krb5 ('user1@EXAMPLE.COM'), 1,
+    ' and check_krb5 finds a direct entry');
+is ($acl_large->check_krb5 ($user1), 0, ' but not a nested one');
+is ($acl_large->check_krb5 ('User1@EXAMPLE.COM'), 0,
+    ' or one differing only in case');
+is ($acl_large->check ('User50@EXAMPLE.COM'), 0,
+    ' and a member differing only in case fails');
+
+# The same checks with the entries preloaded by Wallet::Query.
+my $query = Wallet::Query->new ($schema);
+my $loaded = $query->acl ($acl_large->id, 'user50@EXAMPLE.COM');
+is ($loaded->{name}, 'example-large', 'Loading the ACL with a query');
+is_deeply ([ sort { $a->[0] cmp $b->[0] } @{ $loaded->{entries} } ],
+           [ [ 'krb5', 'user50@EXAMPLE.COM' ], [ 'nested', 'example-new' ] ],
+           ' with only the entries that could match');
+my $acl_loaded = Wallet::ACL->new ($acl_large->id, $schema, $loaded);
+is ($acl_loaded->name, 'example-large', ' and creating an ACL from it');
+is ($acl_loaded->check ('user50@EXAMPLE.COM', undef, undef,
+                        $loaded->{entries}),
+    1, ' and a member checks');
+$loaded = $query->acl ($acl_large->id, $user1);
+is (scalar (@{ $loaded->{entries} }), 1, ' and a non-member loads one entry');
+is ($acl_loaded->check ($user1, undef, undef, $loaded->{entries}), 1,
+    ' and the nested ACL is still checked');
+$loaded = $query->acl ($acl_large->id, $user2);
+is ($acl_loaded->check ($user2, undef, undef, $loaded->{entries}), 0,
+    ' but another user fails');
+is ($query->acl (99999, $user1), undef, 'Loading a missing ACL fails');
+
 # Clean up.
 $setup->destroy;
 END {
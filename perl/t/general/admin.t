@@ -11,7 +11,7 @@
 use strict;
 use warnings;
 
-use Test::More tests => 26;
+use Test::More tests => 31;
 
 use Wallet::Admin;
 use Wallet::Report;
@@ -69,7 +69,7 @@ is ($admin->reinitialize ('admin@EXAMPLE.COM'), 1,
 SKIP: {
     my @path = (split (':', $ENV{PATH}));
     my ($sqlite) = grep { -x $_ } map { "$_/sqlite3" } @path;
-    skip 'sqlite3 not found', 7 unless $sqlite;
+    skip 'sqlite3 not found', 12 unless $sqlite;
 
     # Delete all tables and then redump them straight from the SQL file to
     # avoid getting the version table.
@@ -99,6 +99,29 @@ SKIP: {
       . " version DESC";
     $version = $admin->dbh->selectall_arrayref ($sql);
     is ($version->[0][0], '0.09', ' and the schema version is correct');
+
+    # Upgrade to 0.10.
+    $Wallet::Schema::VERSION = '0.10';
+    $admin = eval { Wallet::Admin->new };
+    $retval = $admin->upgrade;
+    is ($retval, 1, ' and performing an upgrade to 0.10 succeeds');
+    $version = $admin->dbh->selectall_arrayref ($sql);
+    is ($version->[0][0], '0.10', ' and the schema version is correct');
+
+    # Upgrade to 0.11, which adds the history indexes.
+    $Wallet::Schema::VERSION = '0.11';
+    $admin = eval { Wallet::Admin->new };
+    $retval = $admin->upgrade;
+    is ($retval, 1, ' and performing an upgrade to 0.11 succeeds');
+    $version = $admin->dbh->selectall_arrayref ($sql);
+    is ($version->[0][0], '0.11', ' and the schema version is correct');
+    $sql = "select name from sqlite_master where type = 'index' and"
+      . " tbl_name = 'object_history' order by name";
+    my $indexes = $admin->dbh->selectcol_arrayref ($sql);
+    is_deeply ($indexes,
+               [ 'object_history_idx_oh_on',
+                 'object_history_idx_oh_type_oh_name_oh_on' ],
+               ' and the history indexes exist');
 }
 
 # Clean up.
@@ -0,0 +1,148 @@
+#!/usr/bin/perl
+#
+# Tests for archiving object and ACL history.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use POSIX qw(strftime);
+use Test::More tests => 31;
+
+use Wallet::ACL;
+use Wallet::Admin;
+use Wallet::Archive;
+use Wallet::Config;
+use Wallet::Object::Base;
+
+use lib 't/lib';
+use Util;
+
+# Some global defaults to use.
+my $user = 'admin@EXAMPLE.COM';
+my $host = 'localhost';
+my $time = time;
+my $old = $time - 400 * 24 * 60 * 60;
+my $princ = 'service/test@EXAMPLE.COM';
+my $date = strftime ('%Y-%m-%d %H:%M:%S', localtime $time);
+my $olddate = strftime ('%Y-%m-%d %H:%M:%S', localtime $old);
+my $month = strftime ('%Y-%m', gmtime $old);
+
+# Rows survive a round trip through the archive format, even with special
+# characters and NULL values.
+my $archive = Wallet::Archive->new ('archive-test');
+my @columns = @{ $Wallet::Archive::TABLES{acl_history}{columns} };
+my @values = (1, 2, "a\tb\n%c", 'add', undef, '%N', $user, $host, $time);
+my $line = $archive->encode (\@values);
+my %row;
+@row{@columns} = @values;
+is_deeply ($archive->decode ('acl_history', $line), \%row,
+           'Encoding and decoding a row works');
+is ($archive->decode ('acl_history', "1\t2\n"), undef,
+    ' and a malformed line is rejected');
+
+# Use Wallet::Admin to set up the database.
+db_setup;
+my $admin = eval { Wallet::Admin->new };
+is ($@, '', 'Database connection succeeded');
+is ($admin->reinitialize ($user), 1, 'Database initialization succeeded');
+my $schema = $admin->schema;
+
+# Without an archive directory configured, archiving fails.
+is ($admin->history_archive ($time), undef,
+    'Archiving without a directory fails');
+is ($admin->error, 'history archive not configured', ' with the right error');
+
+# Create an object and an ACL with old history and then add some new history.
+my $object = eval {
+    Wallet::Object::Base->create ('keytab', $princ, $schema, $user, $host,
+                                  $old);
+  };
+ok (defined ($object), 'Creating an object succeeds');
+is ($object->log_action ('get', $user, $host, $time), 1,
+    ' and logging a get succeeds');
+my $acl = eval { Wallet::ACL->create ('test', $schema, $user, $host, $old) };
+ok (defined ($acl), 'Creating an ACL succeeds');
+is ($acl->add ('krb5', $princ, $user, $host, $old), 1,
+    ' and adding an entry succeeds');
+is ($acl->remove ('krb5', $princ, $user, $host, $time), 1,
+    ' and removing it succeeds');
+my $objects = $schema->resultset('ObjectHistory')->count;
+my $acls = $schema->resultset('AclHistory')->count;
+
+# Archive the old history.
+$Wallet::Config::HISTORY_ARCHIVE_DIR = 'archive-test';
+system ('rm', '-rf', 'archive-test');
+is ($admin->history_archive ($time - 60), undef,
+    'Archiving to a missing directory fails');
+mkdir 'archive-test';
+
+# If deleting the archived rows fails, they're archived again the next time,
+# but archived history still shows them only once.
+{
+    no warnings qw(once redefine);
+    local *DBIx::Class::ResultSet::delete = sub { die "simulated failure\n" };
+    is ($admin->history_archive ($time - 60), undef,
+        'Archiving fails if the rows cannot be deleted');
+}
+is ($admin->history_archive ($time - 60), 3, 'Archiving old history works');
+ok (-s "archive-test/object_history-$month.gz",
+    ' and the object history archive exists');
+ok (-s "archive-test/acl_history-$month.gz",
+    ' and the ACL history archive exists');
+ok (-s "archive-test/object_history-$month.idx",
+    ' and the object history index exists');
+is ($schema->resultset('ObjectHistory')->count, $objects - 1,
+    ' and the object history was removed from the database');
+is ($schema->resultset('AclHistory')->count, $acls - 2,
+    ' and the ACL history was removed from the database');
+is ($admin->history_archive ($time - 60), 0,
+    ' and archiving again does nothing');
+
+# Object history only includes archived history if requested.
+my $output = "$date  get\n    by $user from $host\n";
+is ($object->history, $output, 'Object history omits archived history');
+is ($object->history ({ archive => 1 }),
+    "$olddate  create\n    by $user from $host\n" . $output,
+    ' and includes it if requested');
+
+# The same for ACL history.
+$output = "$date  remove krb5 $princ\n    by $user from $host\n";
+is ($acl->history, $output, 'ACL history omits archived history');
+is ($acl->history ({ archive => 1 }),
+    "$olddate  create\n    by $user from $host\n"
+    . "$olddate  add krb5 $princ\n    by $user from $host\n" . $output,
+    ' and includes it if requested');
+
+# Archived rows can be looked up directly, skipping months outside the
+# requested range and months whose index doesn't list the object.
+my %search = (oh_type => 'keytab', oh_name => $princ);
+my @rows = $archive->rows ('object_history', \%search);
+is (scalar (@rows), 1, 'Looking up archived rows works');
+is ($rows[0]{oh_action}, 'create', ' and returns the right row');
+@rows = $archive->rows ('object_history', \%search, $old - 60, $time);
+is (scalar (@rows), 1, ' including with a range covering the month');
+@rows = $archive->rows ('object_history', \%search, $time - 60);
+is (scalar (@rows), 0, ' but months before the range are skipped');
+@rows = $archive->rows ('object_history', \%search, undef, $old - 40 * 86400);
+is (scalar (@rows), 0, ' as are months after the range');
+my $index = "archive-test/object_history-$month.idx";
+rename ($index, "$index.save") or die "cannot rename $index: $!\n";
+open (my $fh, '>', $index) or die "cannot create $index: $!\n";
+print {$fh} $archive->encode ([ 'file', 'other' ]);
+close $fh;
+@rows = $archive->rows ('object_history', \%search);
+is (scalar (@rows), 0, ' and months whose index omits the object');
+unlink $index;
+@rows = $archive->rows ('object_history', \%search);
+is (scalar (@rows), 1, ' but months without an index are read');
+rename ("$index.save", $index) or die "cannot rename $index.save: $!\n";
+
+# Clean up.
+$Wallet::Config::HISTORY_ARCHIVE_DIR = undef;
+$admin->destroy;
+END {
+    unlink 'wallet-db';
+    system ('rm', '-rf', 'archive-test');
+}
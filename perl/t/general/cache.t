@@ -0,0 +1,105 @@
+#!/usr/bin/perl
+#
+# Tests for the process-wide cache of wallet metadata.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use Test::More tests => 24;
+
+use Wallet::ACL;
+use Wallet::Admin;
+use Wallet::Cache;
+use Wallet::Server;
+
+use lib 't/lib';
+use Util;
+
+# Set up a database.
+db_setup;
+my $admin = eval { Wallet::Admin->new };
+is ($@, '', 'Wallet::Admin creation did not die');
+is ($admin->reinitialize ('admin@EXAMPLE.COM'), 1,
+    ' and initialization succeeds');
+my $schema = $admin->schema;
+my $dbh = $admin->dbh;
+
+# The generation counter starts at the initialization time.
+my $cache = Wallet::Cache->check ($schema);
+cmp_ok ($cache->{generation}, '>', 1, 'Generation counter is set');
+my $generation = $cache->{generation};
+
+# Lookups are cached, including negative lookups.
+is (Wallet::Cache->type_class ($schema, 'file'), 'Wallet::Object::File',
+    'Looking up the file type works');
+is (Wallet::Cache->type_class ($schema, 'base'), undef,
+    ' and an unknown type returns undef');
+is (Wallet::Cache->scheme_class ($schema, 'krb5'), 'Wallet::ACL::Krb5',
+    'Looking up the krb5 scheme works');
+is_deeply (Wallet::Cache->admin ($schema), { id => 1, name => 'ADMIN' },
+           'Looking up the ADMIN ACL works');
+$dbh->do ("UPDATE types SET ty_class = 'Wallet::Object::Base'"
+          . " WHERE ty_name = 'file'");
+$dbh->do ("INSERT INTO types (ty_name, ty_class)"
+          . " VALUES ('base', 'Wallet::Object::Base')");
+is (Wallet::Cache->type_class ($schema, 'file'), 'Wallet::Object::File',
+    'Changes without a new generation are not seen');
+is (Wallet::Cache->type_class ($schema, 'base'), undef,
+    ' including for negative lookups');
+Wallet::Cache->check ($schema);
+is (Wallet::Cache->type_class ($schema, 'file'), 'Wallet::Object::File',
+    ' even after checking the generation');
+
+# Changing the generation in the database, as another process would, causes
+# the cache to be discarded at the next check.
+$dbh->do ('UPDATE generations SET ge_generation = ge_generation + 1');
+Wallet::Cache->check ($schema);
+is (Wallet::Cache->type_class ($schema, 'file'), 'Wallet::Object::Base',
+    'Changes are seen after the generation changes');
+is (Wallet::Cache->type_class ($schema, 'base'), 'Wallet::Object::Base',
+    ' including for negative lookups');
+$dbh->do ("UPDATE types SET ty_class = 'Wallet::Object::File'"
+          . " WHERE ty_name = 'file'");
+$dbh->do ("DELETE FROM types WHERE ty_name = 'base'");
+Wallet::Cache->clear ($schema);
+is (Wallet::Cache->type_class ($schema, 'base'), undef,
+    'Clearing the cache discards it');
+
+# Registering a type increments the generation and is seen by the server.
+is (Wallet::Cache->type_class ($schema, 'base'), undef,
+    'The base type is not registered');
+is ($admin->register_object ('base', 'Wallet::Object::Base'), 1,
+    ' and registering it works');
+is (Wallet::Cache->check ($schema)->{generation}, $generation + 2,
+    ' and increments the generation');
+my $server = eval { Wallet::Server->new ('admin@EXAMPLE.COM', 'localhost') };
+is ($@, '', 'Creating a server instance did not die');
+is ($server->create ('base', 'service/admin'), 1,
+    ' and creating an object of the new type works');
+
+# Renaming the ADMIN ACL increments the generation.
+my $acl = Wallet::ACL->new ('ADMIN', $schema);
+is ($acl->rename ('ADMIN', 'admin@EXAMPLE.COM', 'localhost'), 1,
+    'Renaming the ADMIN ACL to itself works');
+is (Wallet::Cache->check ($schema)->{generation}, $generation + 3,
+    ' and increments the generation');
+
+# So does creating a new ADMIN ACL after renaming the old one away.
+is ($acl->rename ('old-admin', 'admin@EXAMPLE.COM', 'localhost'), 1,
+    'Renaming the ADMIN ACL away works');
+$acl = eval {
+    Wallet::ACL->create ('ADMIN', $schema, 'admin@EXAMPLE.COM', 'localhost');
+  };
+ok (defined ($acl), ' and creating a new ADMIN ACL works');
+is (Wallet::Cache->check ($schema)->{generation}, $generation + 5,
+    ' and increments the generation');
+is_deeply (Wallet::Cache->admin ($schema), { id => $acl->id, name => 'ADMIN' },
+           ' so the new ADMIN ACL is seen');
+
+# Clean up.
+$admin->destroy;
+END {
+    unlink 'wallet-db';
+}
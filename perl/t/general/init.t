@@ -11,7 +11,7 @@
 use strict;
 use warnings;
 
-use Test::More tests => 18;
+use Test::More tests => 24;
 
 use Wallet::ACL;
 use Wallet::Admin;
@@ -51,6 +51,34 @@ isnt ($entries[0], undef, ' which is a valid entry');
 is ($entries[0][0], 'krb5', ' of krb5 scheme');
 is ($entries[0][1], 'admin@EXAMPLE.ORG', ' with the right user');
 
+# The schema lists its result classes rather than searching for them, so make
+# sure the list is complete.
+my $path = 'lib/Wallet/Schema/Result';
+opendir (my $dir, $path) or die "cannot open $path: $!\n";
+my @results = sort map { /^(\w+)\.pm\z/ ? $1 : () } readdir $dir;
+closedir $dir;
+is_deeply ([ sort $admin->schema->sources ], \@results,
+           'Schema registers every result class');
+
+# Transactions that fail because the database is locked are retried a
+# limited number of times, but other failures aren't retried.
+my $schema = $admin->schema;
+$Wallet::Schema::RETRY_DELAY = 0;
+my $calls = 0;
+my $code = sub { die "database is locked\n" if ++$calls < 3; return 'ok' };
+is ($schema->txn_retry ($code), 'ok', 'Locked transactions are retried');
+is ($calls, 3, ' until they succeed');
+$calls = 0;
+$code = sub { $calls++; die "database is locked\n" };
+eval { $schema->txn_retry ($code) };
+is ($@, "database is locked\n", ' and the last error is rethrown');
+is ($calls, $Wallet::Config::DB_RETRY_COUNT + 1,
+    ' after DB_RETRY_COUNT retries');
+$calls = 0;
+$code = sub { $calls++; die "some other error\n" };
+eval { $schema->txn_retry ($code) };
+is ($calls, 1, 'Other failures are not retried');
+
 # Test cleanup.
 is ($admin->destroy, 1, 'Destroying the database works');
 $acl = eval { Wallet::ACL->new ('ADMIN', $admin->schema) };
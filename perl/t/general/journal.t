@@ -0,0 +1,149 @@
+#!/usr/bin/perl
+#
+# Tests for the history journal.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use POSIX qw(strftime);
+use Test::More tests => 40;
+
+use Wallet::Admin;
+use Wallet::Config;
+use Wallet::Journal;
+use Wallet::Object::Base;
+
+use lib 't/lib';
+use Util;
+
+# Some global defaults to use.
+my $user = 'admin@EXAMPLE.COM';
+my $host = 'localhost';
+my $time = time;
+my @trace = ($user, $host, $time);
+my $princ = 'service/test@EXAMPLE.COM';
+my $date = strftime ('%Y-%m-%d %H:%M:%S', localtime $time);
+my $later = strftime ('%Y-%m-%d %H:%M:%S', localtime ($time + 10));
+
+# Records survive a round trip through the journal format, even with special
+# characters.
+my $journal = Wallet::Journal->new ('journal-test');
+unlink 'journal-test';
+is ($journal->append ('get', 'file', "a\tb\n%c", $user, $host, $time), 1,
+    'Appending a record works');
+is ($journal->sync, 1, ' and syncing works');
+my @entries = $journal->entries;
+is_deeply (\@entries,
+           [ { time => $time, action => 'get', type => 'file',
+               name => "a\tb\n%c", by => $user, from => $host } ],
+           ' and the record reads back correctly');
+@entries = $journal->entries ('file', 'other');
+is (scalar (@entries), 0, 'Filtering by object works');
+undef $journal;
+unlink 'journal-test';
+
+# Use Wallet::Admin to set up the database.
+db_setup;
+my $admin = eval { Wallet::Admin->new };
+is ($@, '', 'Database connection succeeded');
+is ($admin->reinitialize ($user), 1, 'Database initialization succeeded');
+my $schema = $admin->schema;
+
+# Without a journal configured, flushing fails.
+is ($admin->history_flush, undef, 'Flushing without a journal fails');
+is ($admin->error, 'history journal not configured', ' with the right error');
+
+# Create an object and then turn on the journal.
+my $object = eval {
+    Wallet::Object::Base->create ('keytab', $princ, $schema, @trace)
+  };
+ok (defined ($object), 'Creating an object succeeds');
+$Wallet::Config::HISTORY_JOURNAL = 'history-journal';
+unlink 'history-journal';
+is ($admin->history_flush, 0, 'Flushing an empty journal succeeds');
+my $rows = $schema->resultset('ObjectHistory')->count;
+
+# Record some actions, which should go to the journal.
+is ($object->log_action ('get', @trace), 1, 'Logging a get succeeds');
+is ($object->log_action ('store', $user, $host, $time + 10), 1,
+    ' as does logging a store');
+is ($object->log_action ('get', 'other@EXAMPLE.COM', 'remote', $time + 10),
+    1, ' and another get');
+ok (-s 'history-journal', ' and the journal has data');
+is ($schema->resultset('ObjectHistory')->count, $rows,
+    ' but the database does not');
+my $record = $schema->resultset('Object')
+    ->find ({ ob_type => 'keytab', ob_name => $princ });
+is ($record->ob_downloaded_by, undef, ' and the object has no get trace');
+
+# History includes the pending actions.
+my $output = <<"EOO";
+$date  create
+    by $user from $host
+$date  get
+    by $user from $host
+$later  store
+    by $user from $host
+$later  get
+    by other\@EXAMPLE.COM from remote
+EOO
+is ($object->history, $output, 'History includes pending actions');
+
+# Flush the journal.
+is ($admin->history_flush, 3, 'Flushing the journal succeeds');
+is ($admin->history_flush, 0, ' and a second flush does nothing');
+ok (!-s 'history-journal', ' and the journal is empty');
+is ($schema->resultset('ObjectHistory')->count, $rows + 3,
+    ' and the database has the history');
+is ($object->history, $output, ' and history is the same');
+$record = $schema->resultset('Object')
+    ->find ({ ob_type => 'keytab', ob_name => $princ });
+is ($record->ob_downloaded_by, 'other@EXAMPLE.COM',
+    ' and the get trace is the latest get');
+is ($record->ob_downloaded_from, 'remote', ' with the right host');
+is ($record->ob_downloaded_on->epoch, $time + 10, ' and the right time');
+is ($record->ob_stored_by, $user, ' and the store trace is set');
+is ($record->ob_stored_on->epoch, $time + 10, ' with the right time');
+
+# Actions after the flush are merged after the flushed history.
+is ($object->log_action ('get', $user, $host, $time + 10), 1,
+    'Logging another get succeeds');
+is ($object->history, $output . "$later  get\n    by $user from $host\n",
+    ' and history includes it');
+is ($admin->history_flush, 1, ' and it can be flushed');
+
+# If a flush fails before committing, the records are flushed the next time.
+$rows = $schema->resultset('ObjectHistory')->count;
+is ($object->log_action ('get', @trace), 1, 'Logging a get succeeds');
+{
+    no warnings qw(once redefine);
+    local *DBIx::Class::ResultSet::populate = sub { die "simulated\n" };
+    is ($admin->history_flush, undef, ' and a failed flush fails');
+}
+is ($schema->resultset('ObjectHistory')->count, $rows,
+    ' without adding history');
+is ($admin->history_flush, 1, ' but the next flush succeeds');
+is ($schema->resultset('ObjectHistory')->count, $rows + 1,
+    ' and adds the history');
+
+# If the journal can't be emptied after a flush is committed, the next flush
+# doesn't add the history again but does flush newer records.
+is ($object->log_action ('get', @trace), 1, 'Logging a get succeeds');
+{
+    no warnings qw(once redefine);
+    local *Wallet::Journal::discard = sub { die "simulated\n" };
+    is ($admin->history_flush, undef, ' and a flush that cannot empty fails');
+}
+is ($object->log_action ('store', @trace), 1, ' and logging a store succeeds');
+is ($admin->history_flush, 1, ' but the next flush only flushes the store');
+is ($schema->resultset('ObjectHistory')->count, $rows + 3,
+    ' so the get is only added once');
+
+# Clean up.
+$Wallet::Config::HISTORY_JOURNAL = undef;
+$admin->destroy;
+END {
+    unlink ('wallet-db', 'history-journal', 'journal-test');
+}
@@ -0,0 +1,107 @@
+#!/usr/bin/perl
+#
+# Tests for sending read-only commands and reports to a database replica.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use File::Copy qw(copy);
+use Test::More;
+
+use Wallet::ACL;
+use Wallet::Admin;
+use Wallet::Config;
+use Wallet::Report;
+use Wallet::Server;
+
+use lib 't/lib';
+use Util;
+
+# The replica is simulated with a copy of a SQLite database file.
+db_setup;
+if ($Wallet::Config::DB_DRIVER ne 'SQLite') {
+    plan skip_all => 'Replica tests require SQLite';
+}
+plan tests => 23;
+
+# Some global defaults to use.
+my $user = 'admin@EXAMPLE.COM';
+my $host = 'localhost';
+
+# Set up a database with one object, copy it to the replica, and then create
+# a second object only in the primary database.
+my $admin = eval { Wallet::Admin->new };
+is ($@, '', 'Wallet::Admin creation did not die');
+is ($admin->reinitialize ($user), 1, ' and initialization succeeds');
+my $server = Wallet::Server->new ($user, $host);
+is ($server->create ('base', 'both'), 1, 'Creating an object works');
+undef $server;
+$admin->schema->storage->disconnect;
+ok (copy ('wallet-db', 'wallet-db-replica'), 'Copying the database works');
+$server = Wallet::Server->new ($user, $host);
+is ($server->create ('base', 'primary'), 1, 'Creating a second object works');
+undef $server;
+
+# Without a replica, everything uses the primary database.
+$server = Wallet::Server->new ($user, $host);
+my ($schema) = $server->reader;
+is ($schema, $server->schema, 'Without a replica, reads use the primary');
+is ($server->check ('base', 'primary'), 1, ' and see all objects');
+undef $server;
+
+# With a replica, the read-only commands use it and don't see the object
+# only in the primary database.
+$Wallet::Config::DB_REPLICA_INFO = 'wallet-db-replica';
+$server = Wallet::Server->new ($user, $host);
+($schema) = $server->reader;
+isnt ($schema, $server->schema, 'With a replica, reads use the replica');
+is ($server->check ('base', 'both'), 1, ' and see objects in the replica');
+is ($server->check ('base', 'primary'), 0, ' but not those only in primary');
+is ($server->show ('base', 'primary'), undef, ' so show fails');
+is ($server->error, 'cannot find base:primary', ' with the right error');
+ok (defined ($server->acl_show ('ADMIN')), ' but ACL show works');
+
+# Reading the primary database inside a transaction isn't a change, so reads
+# still use the replica afterwards.
+my $acl = Wallet::ACL->new ('ADMIN', $server->schema);
+ok (scalar ($acl->list), 'Listing an ACL in the primary works');
+ok (defined ($acl->history), ' as does showing its history');
+($schema) = $server->reader;
+isnt ($schema, $server->schema, ' and reads still use the replica');
+
+# After a change, reads go to the primary database.
+is ($server->comment ('base', 'both', 'Changed'), 1,
+    'Changing a comment works');
+($schema) = $server->reader;
+is ($schema, $server->schema, ' and then reads use the primary');
+is ($server->check ('base', 'primary'), 1, ' and see all objects');
+like ($server->show ('base', 'both'), qr/Comment: Changed/,
+      ' including the change');
+undef $server;
+
+# Reports use the replica.
+my $report = Wallet::Report->new;
+is_deeply ([ $report->objects ], [ [ 'base', 'both' ] ],
+           'Reports use the replica');
+undef $report;
+
+# If the replica can't be reached, the primary database is used.
+$Wallet::Config::DB_REPLICA_INFO = 'nonexistent/wallet-db';
+$server = Wallet::Server->new ($user, $host);
+is ($server->check ('base', 'primary'), 1,
+    'An unreachable replica falls back on the primary');
+$report = Wallet::Report->new;
+my @objects = $report->objects;
+is (scalar (@objects), 2, ' including for reports');
+undef $report;
+undef $server;
+
+# Clean up.
+$Wallet::Config::DB_REPLICA_INFO = undef;
+$admin = Wallet::Admin->new;
+$admin->destroy;
+END {
+    unlink ('wallet-db', 'wallet-db-replica');
+}
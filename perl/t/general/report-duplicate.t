@@ -0,0 +1,89 @@
+#!/usr/bin/perl
+#
+# Scaling benchmark for the duplicate ACL report.
+#
+# Builds synthetic wallet databases with increasing numbers of ACLs, some of
+# which duplicate others, and times the duplicate ACL report on each so that
+# the growth of the run time with the number of ACLs can be seen.  This is
+# slow, so it is only run for package maintainers.  Set WALLET_BENCH_ACLS to
+# a space-separated list of sizes to change the sizes used.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use lib 't/lib';
+
+use Test::RRA qw(skip_unless_author);
+use Util;
+
+use Test::More;
+use Time::HiRes qw(time);
+
+use Wallet::Admin;
+use Wallet::Report;
+
+# This test is slow, so only run it for package maintainers.
+skip_unless_author('Duplicate ACL report benchmark');
+
+# The numbers of ACLs to try.
+my @sizes = split (' ', $ENV{WALLET_BENCH_ACLS} || '1000 4000 16000 64000');
+plan tests => 2 + 2 * @sizes;
+
+# Use Wallet::Admin to set up the database.
+db_setup;
+my $user = 'admin@EXAMPLE.COM';
+my $admin = eval { Wallet::Admin->new };
+is ($@, '', 'Database connection succeeded');
+my $schema = $admin->schema;
+
+# Populate the database with the given number of ACLs.  Each ACL has three
+# entries, and every fourth ACL has the same entries as the one before it,
+# so there are a quarter as many sets of duplicates as ACLs.  Returns the
+# expected number of sets of duplicates.
+sub populate {
+    my ($count) = @_;
+    $admin->reinitialize ($user) or die $admin->error, "\n";
+    my $guard = $schema->txn_scope_guard;
+    my @acls = ([ qw(ac_id ac_name) ]);
+    my @entries = ([ qw(ae_id ae_scheme ae_identifier) ]);
+    my $sets = 0;
+    for my $i (1 .. $count) {
+        push (@acls, [ $i + 1, "acl-$i" ]);
+        my $base = ($i % 4 == 0) ? $i - 1 : $i;
+        $sets++ if $i % 4 == 0;
+        for my $j (1 .. 3) {
+            push (@entries, [ $i + 1, 'krb5', "user$base-$j\@EXAMPLE.COM" ]);
+        }
+    }
+    $schema->resultset('Acl')->populate (\@acls);
+    $schema->resultset('AclEntry')->populate (\@entries);
+    $guard->commit;
+    return $sets;
+}
+
+# Time the report for each size.
+my @times;
+for my $count (@sizes) {
+    my $sets = populate ($count);
+    my $report = Wallet::Report->new;
+    my $start = time;
+    my @duplicates = $report->acls ('duplicate');
+    my $elapsed = time - $start;
+    is ($report->error, undef, "Duplicate report for $count ACLs succeeds");
+    is (scalar (@duplicates), $sets, ' and finds the right number of sets');
+    push (@times, [ $count, $elapsed ]);
+}
+note (sprintf ('%8s %10s %14s', 'ACLs', 'seconds', 'usec per ACL'));
+for my $time (@times) {
+    my ($count, $elapsed) = @$time;
+    note (sprintf ('%8d %9.3fs %14.1f', $count, $elapsed,
+                   $elapsed / $count * 1_000_000));
+}
+
+# Clean up.
+is ($admin->destroy, 1, 'Destruction succeeded');
+END {
+    unlink 'wallet-db';
+}
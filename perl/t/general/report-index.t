@@ -0,0 +1,154 @@
+#!/usr/bin/perl
+#
+# Benchmark of the wallet reports with and without the report indexes.
+#
+# Builds a large synthetic wallet database, times each Wallet::Report query,
+# drops the indexes added for those queries, and times them again, checking
+# that the results don't change.  This is slow, so it is only run for package
+# maintainers.  Set WALLET_BENCH_OBJECTS to change the number of objects.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use lib 't/lib';
+
+use Test::RRA qw(skip_unless_author);
+use Util;
+
+use DateTime;
+use Test::More;
+use Time::HiRes qw(time);
+
+use Wallet::Admin;
+use Wallet::Config;
+use Wallet::Report;
+
+# This test is slow, so only run it for package maintainers.
+skip_unless_author('Report index benchmark');
+
+# Dropping indexes is done with SQLite syntax.
+db_setup;
+if ($Wallet::Config::DB_DRIVER ne 'SQLite') {
+    plan skip_all => 'Report index benchmark requires SQLite';
+}
+
+# The indexes to drop for the unindexed run.
+my @INDEXES = qw(acl_entries_idx_ae_scheme_ae_identifier flags_idx_fl_flag
+                 objects_idx_ob_downloaded_on objects_idx_ob_expires
+                 objects_idx_ob_stored_on);
+
+# The reports to time, as a description, the report method, and its
+# arguments.
+my @REPORTS = (
+    [ 'all objects',        'objects' ],
+    [ 'objects by type',    'objects', 'type', 'file' ],
+    [ 'objects by owner',   'objects', 'owner', 'acl-7' ],
+    [ 'objects by flag',    'objects', 'flag', 'locked' ],
+    [ 'objects by ACL',     'objects', 'acl', 'acl-7' ],
+    [ 'unused objects',     'objects', 'unused' ],
+    [ 'unstored objects',   'objects', 'unstored' ],
+    [ 'all ACLs',           'acls' ],
+    [ 'duplicate ACLs',     'acls', 'duplicate' ],
+    [ 'empty ACLs',         'acls', 'empty' ],
+    [ 'ACLs by entry',      'acls', 'entry', 'krb5', 'user7@' ],
+    [ 'ACLs nesting',       'acls', 'nesting', 'acl-7' ],
+    [ 'unused ACLs',        'acls', 'unused' ],
+    [ 'owners',             'owners', 'file', 'host/1%' ],
+);
+plan tests => 3 + @REPORTS;
+
+# Some global defaults to use.
+my $user = 'admin@EXAMPLE.COM';
+my $host = 'localhost';
+my $count = $ENV{WALLET_BENCH_OBJECTS} || 20_000;
+my $acls = int ($count / 10) || 1;
+
+# Use Wallet::Admin to set up the database.
+my $admin = eval { Wallet::Admin->new };
+is ($@, '', 'Database connection succeeded');
+is ($admin->reinitialize ($user), 1, 'Database initialization succeeded');
+my $schema = $admin->schema;
+my $parser = $schema->storage->datetime_parser;
+
+# Format a time in seconds since epoch for the database.
+sub db_date {
+    my ($time) = @_;
+    return $parser->format_datetime (DateTime->from_epoch (epoch => $time));
+}
+
+# Populate the database.  Every tenth ACL is empty and every hundredth is
+# nested in another ACL.  Objects alternate between keytab and file types,
+# about half have been downloaded, and every twentieth one is locked.
+my $now = time;
+my $created = db_date ($now - 86400);
+my $guard = $schema->txn_scope_guard;
+my @rows = ([ qw(ac_id ac_name) ]);
+push (@rows, [ $_ + 1, "acl-$_" ]) for 1 .. $acls;
+$schema->resultset('Acl')->populate (\@rows);
+@rows = ([ qw(ae_id ae_scheme ae_identifier) ]);
+for my $i (1 .. $acls) {
+    next if $i % 10 == 0;
+    push (@rows, [ $i + 1, 'krb5', "user$i\@EXAMPLE.COM" ]);
+    push (@rows, [ $i + 1, 'krb5', "user" . ($i + 1) . "\@EXAMPLE.COM" ]);
+    if ($i % 100 == 7) {
+        push (@rows, [ $i + 1, 'nested', 'acl-' . ($i % 100) ]);
+    }
+}
+$schema->resultset('AclEntry')->populate (\@rows);
+@rows = ([ qw(ob_id ob_type ob_name ob_owner ob_acl_get ob_expires
+              ob_created_by ob_created_from ob_created_on ob_downloaded_on
+              ob_stored_on) ]);
+my @flags = ([ qw(fl_object fl_flag) ]);
+for my $i (1 .. $count) {
+    my $type = ($i % 2) ? 'keytab' : 'file';
+    my $name = "host/$i.example.com";
+    my $owner = ($i % $acls) + 2;
+    my $expires = ($i % 3) ? undef : db_date ($now + $i);
+    my $downloaded = ($i % 2 == 0 or $i % 5 == 0) ? db_date ($now) : undef;
+    my $stored = ($i % 4 == 0) ? db_date ($now) : undef;
+    push (@rows, [ $i, $type, $name, $owner, ($i % 3 ? undef : $owner),
+                   $expires, $user, $host, $created, $downloaded, $stored ]);
+    push (@flags, [ $i, 'locked' ]) if $i % 20 == 0;
+}
+$schema->resultset('Object')->populate (\@rows);
+$schema->resultset('Flag')->populate (\@flags);
+$guard->commit;
+$schema->storage->dbh->do ('ANALYZE');
+
+# Run each report, returning a reference to a hash of descriptions to results
+# and a reference to a hash of descriptions to times.
+sub run_reports {
+    my $report = Wallet::Report->new;
+    my (%results, %times);
+    for my $spec (@REPORTS) {
+        my ($desc, $method, @args) = @$spec;
+        my $start = time;
+        my @result = $report->$method (@args);
+        $times{$desc} = time - $start;
+        $results{$desc} = [ @result ];
+    }
+    return (\%results, \%times);
+}
+
+# Run the reports with and without the indexes and compare.
+my ($indexed, $fast) = run_reports;
+my $dbh = $schema->storage->dbh;
+$dbh->do ("DROP INDEX $_") for @INDEXES;
+$dbh->do ('ANALYZE');
+my ($unindexed, $slow) = run_reports;
+note (sprintf ('%-20s %10s %10s', 'report', 'indexed', 'unindexed'));
+for my $spec (@REPORTS) {
+    my $desc = $spec->[0];
+    note (sprintf ('%-20s %9.3fs %9.3fs', $desc, $fast->{$desc},
+                   $slow->{$desc}));
+    is_deeply ($indexed->{$desc}, $unindexed->{$desc},
+               "Results of $desc are the same without the indexes");
+}
+
+# Clean up.
+is ($admin->destroy, 1, 'Destruction succeeded');
+END {
+    unlink 'wallet-db';
+}
@@ -0,0 +1,101 @@
+#!/usr/bin/perl
+#
+# Benchmark of the unused ACL and unused and unstored object reports.
+#
+# Builds a large synthetic wallet database, runs each of the reports, and
+# checks the results against the ones expected from how the database was
+# built, noting the time each report took.  This is slow, so it is only run
+# for package maintainers.  Set WALLET_BENCH_ACLS to change the number of
+# ACLs.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use lib 't/lib';
+
+use Test::RRA qw(skip_unless_author);
+use Util;
+
+use DateTime;
+use Test::More;
+use Time::HiRes qw(time);
+
+use Wallet::Admin;
+use Wallet::Report;
+
+# This test is slow, so only run it for package maintainers.
+skip_unless_author('Unused report benchmark');
+plan tests => 6;
+
+# Some global defaults to use.
+my $user = 'admin@EXAMPLE.COM';
+my $host = 'localhost';
+my $acls = $ENV{WALLET_BENCH_ACLS} || 100_000;
+
+# Use Wallet::Admin to set up the database.
+db_setup;
+my $admin = eval { Wallet::Admin->new };
+is ($@, '', 'Database connection succeeded');
+is ($admin->reinitialize ($user), 1, 'Database initialization succeeded');
+my $schema = $admin->schema;
+my $parser = $schema->storage->datetime_parser;
+my $now = $parser->format_datetime (DateTime->now);
+
+# Populate the database.  There is one object for every two ACLs, owned by
+# every other ACL.  The other ACL columns of every seventh object are set to
+# ACLs spread across the rest, leaving a bit under half of the ACLs unused.
+# Every third object has been downloaded and every fifth has been stored.
+my (%used, @unused, @unstored);
+my $guard = $schema->txn_scope_guard;
+my @rows = ([ qw(ac_id ac_name) ]);
+push (@rows, [ $_ + 1, "acl-$_" ]) for 1 .. $acls;
+$schema->resultset('Acl')->populate (\@rows);
+@rows = ([ qw(ob_type ob_name ob_owner ob_acl_get ob_acl_store ob_acl_show
+              ob_acl_destroy ob_acl_flags ob_created_by ob_created_from
+              ob_created_on ob_downloaded_on ob_stored_on) ]);
+for my $i (1 .. int ($acls / 2)) {
+    my $type = ($i % 2) ? 'keytab' : 'file';
+    my $name = sprintf ('host/%06d.example.com', $i);
+    my @ids = ($i * 2 + 1, (undef) x 5);
+    if ($i % 7 == 0) {
+        @ids[1 .. 5] = map { ($i * 2 + 10 * $_) % $acls + 2 } 1 .. 5;
+    }
+    $used{$_} = 1 for grep { defined } @ids;
+    my $downloaded = ($i % 3 == 0) ? $now : undef;
+    my $stored = ($i % 5 == 0) ? $now : undef;
+    push (@rows, [ $type, $name, @ids, $user, $host, $now, $downloaded,
+                   $stored ]);
+    push (@unused, [ $type, $name ]) unless $downloaded;
+    push (@unstored, [ $type, $name ]) if (!$stored and $type eq 'file');
+}
+$schema->resultset('Object')->populate (\@rows);
+$guard->commit;
+$schema->storage->dbh->do ('ANALYZE');
+
+# The ADMIN ACL is used by nothing but isn't reported specially.
+my @acls = map { [ $_ + 1, "acl-$_" ] } grep { !$used{$_ + 1} } 1 .. $acls;
+unshift (@acls, [ 1, 'ADMIN' ]);
+@unused = sort { $a->[0] cmp $b->[0] or $a->[1] cmp $b->[1] } @unused;
+@unstored = sort { $a->[1] cmp $b->[1] } @unstored;
+
+# Run each report, check its results, and note how long it took.
+my $report = Wallet::Report->new;
+my @reports = ([ 'unused ACLs',      'acls',    \@acls ],
+               [ 'unused objects',   'objects', \@unused ],
+               [ 'unstored objects', 'objects', \@unstored ]);
+for my $spec (@reports) {
+    my ($desc, $method, $expected) = @$spec;
+    my $type = ($desc =~ /^(\S+)/)[0];
+    my $start = time;
+    my @result = $report->$method ($type);
+    note (sprintf ('%-20s %9.3fs', $desc, time - $start));
+    is_deeply (\@result, $expected, "Report of $desc is correct");
+}
+
+# Clean up.
+is ($admin->destroy, 1, 'Destruction succeeded');
+END {
+    unlink 'wallet-db';
+}
@@ -11,7 +11,8 @@
 use strict;
 use warnings;
 
-use Test::More tests => 223;
+use POSIX qw(strftime);
+use Test::More tests => 246;
 
 use Wallet::Admin;
 use Wallet::Report;
@@ -267,6 +268,13 @@ package main;
 is (scalar (@lines), 1, 'Searching for naming violations finds one');
 is ($lines[0][0], 'base', ' and the first has the right type');
 is ($lines[0][1], 'service/admin', ' and the right name');
+my @progress;
+my %options = (workers  => 3,
+               progress => sub { push (@progress, [ @_ ]) });
+my @audit = $report->audit ('objects', 'name', \%options);
+is_deeply (\@audit, \@lines, ' and the same with three workers');
+my $count = () = $report->objects;
+is_deeply ($progress[-1], [ $count, $count ], ' with the right progress');
 
 # Set an ACL naming policy and then look for objects that fail that policy.
 # Use the same deactivation trick as above.
@@ -299,6 +307,24 @@ is (scalar (@lines), 1, 'Searching for host-based objects finds one');
 is ($lines[0][0], 'base', ' and the first has the right type');
 is ($lines[0][1], 'service/admin', ' and the right name');
 
+# Now define a host mapping, which makes the host report search on the host
+# stored with each object.  Existing objects have no stored host until it's
+# backfilled.
+*Wallet::Config::object_host = sub {
+    my ($type, $name) = @_;
+    my ($service, $principal) = split ('/', $name, 2);
+    return unless $service && $principal;
+    return $principal;
+};
+@lines = $report->objects_hostname ('host', 'admin');
+is (scalar (@lines), 0, 'Searching by stored host finds nothing at first');
+is ($admin->hosts_backfill, 1, ' but backfilling the hosts updates one');
+@lines = $report->objects_hostname ('host', 'admin');
+is (scalar (@lines), 1, ' and then searching by stored host finds it');
+is ($lines[0][0], 'base', ' and the first has the right type');
+is ($lines[0][1], 'service/admin', ' and the right name');
+is ($admin->hosts_backfill, 0, ' and backfilling again does nothing');
+
 # Set up a file bucket so that we can create an object we can retrieve.
 system ('rm -rf test-files') == 0 or die "cannot remove test-files\n";
 mkdir 'test-files' or die "cannot create test-files: $!\n";
@@ -360,6 +386,15 @@ is (scalar (@{ $acls[0] }), 2, ' with two members');
 is ($acls[0][0], 'second', ' and the first member is correct');
 is ($acls[0][1], 'third', ' and the second member is correct');
 
+# Make the fourth ACL match as well.  All three are reported as one set.
+is ($server->acl_add ('fourth', 'base', 'foo'), 1,
+    'Adding another line to the fourth ACL works');
+@acls = $report->acls ('duplicate');
+is (scalar (@acls), 1, 'There is one set of duplicate ACLs');
+is_deeply ($acls[0], [ qw(fourth second third) ], ' with all three members');
+is ($server->acl_remove ('fourth', 'base', 'foo'), 1,
+    ' and removing the line from the fourth ACL works');
+
 # Add yet another line to the third ACL.  Now all ACLs are distinct.
 is ($server->acl_add ('third', 'base', 'baz'), 1,
     'Adding another line to the third ACL works');
@@ -374,6 +409,39 @@ is ($server->acl_add ('fourth', 'nested', 'second'), 1,
 is (scalar (@acls), 1, ' and the nested report shows one nesting');
 is ($acls[0][1], 'fourth', ' with the correct ACL nesting it');
 
+# Reports read a page at a time give the same results regardless of the page
+# size, and can be read one row at a time.
+@objects = $report->objects;
+@acls = $report->acls;
+{
+    local $Wallet::Report::PAGE_SIZE = 1;
+    is_deeply ([ $report->objects ], \@objects,
+               'Objects report is the same with one row per page');
+    is_deeply ([ $report->acls ], \@acls,
+               ' as is the ACL report');
+    my @seen;
+    my $add = sub { push (@seen, $_[0]); return 1 };
+    is ($report->each_object ($add), 1, 'Reading objects one at a time works');
+    is_deeply (\@seen, \@objects, ' and returns the same objects');
+    @seen = ();
+    is ($report->each_acl ($add), 1, 'Reading ACLs one at a time works');
+    is_deeply (\@seen, [ sort { $a->[1] cmp $b->[1] } @acls ],
+               ' and returns them in order by name');
+    @seen = ();
+    $add = sub { push (@seen, $_[0]); return 0 };
+    is ($report->each_object ($add), 1, 'Stopping the objects report works');
+    is (scalar (@seen), 1, ' and only one object was read');
+}
+
+# History can be returned with the times in seconds since epoch.
+my @history = $report->objects_history ('history');
+my @epoch = $report->objects_history ('history', { epoch => 1 });
+ok (scalar (@history) > 0, 'Object history report returns history');
+is (strftime ('%Y-%m-%d %H:%M:%S', gmtime $epoch[0][0]), $history[0][0],
+    ' and the epoch time matches the database time');
+is_deeply ([ map { [ @$_[1 .. 5] ] } @epoch ],
+           [ map { [ @$_[1 .. 5] ] } @history ], ' as do the other fields');
+
 # Clean up.
 $admin->destroy;
 system ('rm -r test-files') == 0 or die "cannot remove test-files\n";
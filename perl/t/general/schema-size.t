@@ -0,0 +1,187 @@
+#!/usr/bin/perl
+#
+# Comparison of the database size before and after integer object IDs.
+#
+# Builds the same synthetic wallet database with the SQLite DDL for schema
+# 0.10, where the tables holding flags and type-specific data refer to objects
+# by type and name, and schema 0.11, where they refer to the numeric object
+# ID, and reports the space used by each table and its indexes.  Object history
+# is also built and reported, but it still refers to objects by type and name
+# in 0.11 so that the history of destroyed objects is kept.  This is slow, so
+# it is only run for package maintainers.  Set WALLET_BENCH_OBJECTS to change
+# the number of objects.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use lib 't/lib';
+
+use Test::RRA qw(skip_unless_author);
+
+use DBI;
+use Test::More;
+
+# This test is slow, so only run it for package maintainers.
+skip_unless_author('Schema size comparison');
+
+# The tables whose size should shrink with numeric object IDs.
+my @TABLES = qw(flags keytab_enctypes keytab_sync duo);
+
+# Indexes added in schema 0.11 for the reports, which are unrelated to object
+# IDs and are dropped before comparing sizes.
+my @INDEXES = qw(flags_idx_fl_flag objects_idx_ob_downloaded_on
+                 objects_idx_ob_expires objects_idx_ob_host
+                 objects_idx_ob_stored_on);
+
+# The statement to add object history, which is the same in both versions.
+my $HISTORY = 'INSERT INTO object_history (oh_type, oh_name, oh_action,'
+    . " oh_by, oh_from, oh_on) VALUES (?, ?, ?, 'admin\@EXAMPLE.COM',"
+    . " 'localhost', '2024-01-01 00:00:00')";
+
+# The statements to populate each version of the schema, keyed by version and
+# then table.  Each statement takes the columns identifying the object in that
+# version, followed by the table-specific data.
+my %INSERT = (
+    '0.10' => {
+        objects => 'INSERT INTO objects (ob_type, ob_name, ob_owner,'
+            . ' ob_created_by, ob_created_from, ob_created_on)'
+            . " VALUES (?, ?, 1, 'admin\@EXAMPLE.COM', 'localhost',"
+            . " '2024-01-01 00:00:00')",
+        flags   => 'INSERT INTO flags (fl_type, fl_name, fl_flag)'
+            . ' VALUES (?, ?, ?)',
+        keytab_enctypes => 'INSERT INTO keytab_enctypes (ke_name, ke_enctype)'
+            . ' VALUES (?, ?)',
+        keytab_sync => 'INSERT INTO keytab_sync (ks_name, ks_target)'
+            . ' VALUES (?, ?)',
+        duo => 'INSERT INTO duo (du_type, du_name, du_key) VALUES (?, ?, ?)',
+    },
+    '0.11' => {
+        objects => 'INSERT INTO objects (ob_id, ob_type, ob_name, ob_owner,'
+            . ' ob_created_by, ob_created_from, ob_created_on)'
+            . " VALUES (?, ?, ?, 1, 'admin\@EXAMPLE.COM', 'localhost',"
+            . " '2024-01-01 00:00:00')",
+        flags   => 'INSERT INTO flags (fl_object, fl_flag) VALUES (?, ?)',
+        keytab_enctypes => 'INSERT INTO keytab_enctypes'
+            . ' (ke_object, ke_enctype) VALUES (?, ?)',
+        keytab_sync => 'INSERT INTO keytab_sync (ks_object, ks_target)'
+            . ' VALUES (?, ?)',
+        duo => 'INSERT INTO duo (du_object, du_key) VALUES (?, ?)',
+    },
+);
+
+# Create a database with the DDL for the given schema version and fill it
+# with the synthetic objects.  Returns the database handle.
+sub build {
+    my ($version, $count) = @_;
+    my $file = "wallet-size-$version";
+    unlink $file;
+    my $dbh = DBI->connect ("dbi:SQLite:dbname=$file", '', '',
+                            { RaiseError => 1, PrintError => 0 });
+    open (my $ddl, '<', "sql/Wallet-Schema-$version-SQLite.sql")
+        or BAIL_OUT ("cannot open DDL for $version: $!");
+    my $sql = join ('', grep { !/^\s*--/ } <$ddl>);
+    close $ddl;
+    for my $statement (split (/;\s*\n/, $sql)) {
+        next if $statement =~ /^\s*(BEGIN|COMMIT)\b/;
+        next unless $statement =~ /\S/;
+        $dbh->do ($statement);
+    }
+
+    # Each object is a keytab, a file, or occasionally a Duo integration.
+    # Keytabs have two enctype restrictions and every tenth is synchronized,
+    # and every twentieth object is locked.  Every object has a create, a
+    # store or get, and a get in its history.
+    my %sth = map { $_ => $dbh->prepare ($INSERT{$version}{$_}) }
+        keys %{ $INSERT{$version} };
+    $sth{history} = $dbh->prepare ($HISTORY);
+    $dbh->begin_work;
+    $dbh->do ("INSERT INTO acls (ac_id, ac_name) VALUES (1, 'ADMIN')");
+    for my $id (1 .. $count) {
+        my $host = "host$id.example.com";
+        my ($type, $name) = ('file', "$host/ssl-key");
+        if ($id % 50 == 0) {
+            ($type, $name) = ('duo', $host);
+        } elsif ($id % 2) {
+            ($type, $name) = ('keytab', "host/$host\@EXAMPLE.COM");
+        }
+        my $old = ($version eq '0.10');
+        my @key = $old ? ($type, $name) : ($id);
+        my @keytab = $old ? ($name) : ($id);
+        $sth{objects}->execute ($old ? () : ($id), $type, $name);
+        $sth{flags}->execute (@key, 'locked') if $id % 20 == 0;
+        for my $action ('create', ($type eq 'file' ? 'store' : 'get'), 'get') {
+            $sth{history}->execute ($type, $name, $action);
+        }
+        if ($type eq 'keytab') {
+            for my $enctype (qw(aes128-cts-hmac-sha1-96
+                                aes256-cts-hmac-sha1-96)) {
+                $sth{keytab_enctypes}->execute (@keytab, $enctype);
+            }
+            $sth{keytab_sync}->execute (@keytab, 'kaserver') if $id % 10 == 1;
+        } elsif ($type eq 'duo') {
+            $sth{duo}->execute (@key, sprintf ('DI%018d', $id));
+        }
+    }
+    $dbh->commit;
+    if ($version eq '0.11') {
+        $dbh->do ("DROP INDEX $_") for @INDEXES;
+    }
+    $dbh->do ('VACUUM');
+    return $dbh;
+}
+
+# Returns a hash of table names to the bytes used by that table and all of its
+# indexes, or undef if SQLite was built without the dbstat virtual table.
+sub sizes {
+    my ($dbh) = @_;
+    my $sql = 'SELECT tbl_name, SUM(pgsize) FROM dbstat'
+        . ' JOIN sqlite_master ON sqlite_master.name = dbstat.name'
+        . ' GROUP BY tbl_name';
+    my $rows = eval { $dbh->selectall_arrayref ($sql) };
+    return unless $rows;
+    return { map { @$_ } @$rows };
+}
+
+# Build both databases.
+my $count = $ENV{WALLET_BENCH_OBJECTS} || 20_000;
+my %sizes;
+for my $version (qw(0.10 0.11)) {
+    my $dbh = build ($version, $count);
+    $sizes{$version} = sizes ($dbh);
+    unless ($sizes{$version}) {
+        plan skip_all => 'SQLite does not support dbstat';
+    }
+    $dbh->disconnect;
+}
+plan tests => @TABLES + 1;
+
+# Report the sizes and check that every table referring to objects shrank.
+my ($old, $new) = @sizes{qw(0.10 0.11)};
+diag (sprintf ('%-16s %10s %10s %7s', 'table', '0.10', '0.11', 'change'));
+my ($old_total, $new_total) = (0, 0);
+for my $table (@TABLES, 'objects') {
+    my $change = ($new->{$table} - $old->{$table}) / $old->{$table} * 100;
+    diag (sprintf ('%-16s %10d %10d %6.1f%%', $table, $old->{$table},
+                   $new->{$table}, $change));
+    $old_total += $old->{$table};
+    $new_total += $new->{$table};
+}
+for my $table (@TABLES) {
+    cmp_ok ($new->{$table}, '<', $old->{$table}, "$table is smaller");
+}
+cmp_ok ($new_total, '<', $old_total, 'Object tables are smaller in total');
+
+# Report object history separately.  Its rows are identical in both versions,
+# so any difference comes from the history indexes added in 0.11 for range
+# searches.
+my $table = 'object_history';
+my $change = ($new->{$table} - $old->{$table}) / $old->{$table} * 100;
+diag (sprintf ('%-16s %10d %10d %6.1f%% (not converted)', $table,
+               $old->{$table}, $new->{$table}, $change));
+
+# Clean up.
+END {
+    unlink ('wallet-size-0.10', 'wallet-size-0.11');
+}
@@ -0,0 +1,141 @@
+#!/usr/bin/perl
+#
+# Benchmark of the database access done by the common server commands.
+#
+# Runs check, show, get, and store on a file object many times as a user
+# who isn't an administrator, noting the number of SQL statements executed
+# and the average latency of each command, compares the object and ACL
+# lookup done through Wallet::Query with the one done through DBIx::Class,
+# and checks the number of statements needed to show an object and its
+# history.
+# This is slow, so it is only run for package maintainers.  Set
+# WALLET_BENCH_ITERATIONS to change the number of times each command is run.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use lib 't/lib';
+
+use Test::RRA qw(skip_unless_author);
+use Util;
+
+use File::Path qw(remove_tree);
+use Test::More;
+use Time::HiRes qw(time);
+
+use Wallet::Admin;
+use Wallet::Config;
+use Wallet::Server;
+
+# This test is slow, so only run it for package maintainers.
+skip_unless_author('Server query benchmark');
+plan tests => 17;
+
+# Some global defaults to use.
+my $admin = 'admin@EXAMPLE.COM';
+my $user = 'alice@EXAMPLE.COM';
+my $host = 'localhost';
+my $iterations = $ENV{WALLET_BENCH_ITERATIONS} || 1000;
+
+# Use Wallet::Admin to set up the database and a file object owned by an ACL
+# with a few entries, one of them for our user.
+db_setup;
+mkdir 'test-files' or die "cannot create test-files: $!\n";
+$Wallet::Config::FILE_BUCKET = 'test-files';
+my $setup = eval { Wallet::Admin->new };
+is ($@, '', 'Database connection succeeded');
+is ($setup->reinitialize ($admin), 1, 'Database initialization succeeded');
+my $server = eval { Wallet::Server->new ($admin, $host) };
+ok ($server->acl_create ('bench'), 'Creating an ACL');
+for my $i (1 .. 10) {
+    $server->acl_add ('bench', 'krb5', "user$i\@EXAMPLE.COM");
+}
+ok ($server->acl_add ('bench', 'krb5', $user), ' and adding our user');
+ok ($server->create ('file', 'bench'), 'Creating an object');
+ok ($server->owner ('file', 'bench', 'bench'), ' and setting its owner');
+for my $type (qw(get store show destroy)) {
+    $server->acl_create ("bench-$type");
+    $server->acl_add ("bench-$type", 'krb5', $user);
+    $server->acl ('file', 'bench', $type, "bench-$type");
+}
+undef $server;
+
+# Count the statements executed on the server's database handle, forgetting
+# the statements prepared before the callback was installed.
+$server = Wallet::Server->new ($user, $host);
+my $count = 0;
+$server->dbh->{Callbacks}
+    = { ChildCallbacks => { execute => sub { $count++; return } } };
+%{ $server->dbh->{CachedKids} } = ();
+
+# Showing an object with five ACLs and its history resolves all the ACLs at
+# once, so each needs two statements beyond loading the object.  Do this
+# first, while the history is short enough to be read with one query.
+my $object = $server->retrieve ('file', 'bench');
+for my $method (qw(show history)) {
+    $count = 0;
+    ok (defined ($object->$method), "Object $method succeeds");
+    note ("object $method: $count statements");
+    cmp_ok ($count, '<=', 2, " and needs at most two statements");
+}
+
+# Run a command the given number of times and return the average number of
+# statements it executed and its average latency in microseconds.
+sub measure {
+    my ($code) = @_;
+    $code->();
+    $count = 0;
+    my $start = time;
+    for (1 .. $iterations) {
+        $code->();
+    }
+    my $elapsed = time - $start;
+    return ($count / $iterations, $elapsed / $iterations * 1_000_000);
+}
+
+# Time each command and check that it works.
+my @commands = (
+    [ 'check', sub { $server->check ('file', 'bench') } ],
+    [ 'show',  sub { $server->show ('file', 'bench') } ],
+    [ 'store', sub { $server->store ('file', 'bench', 'data') } ],
+    [ 'get',   sub { $server->get ('file', 'bench') } ],
+);
+note (sprintf ('%-10s %10s %10s', 'command', 'queries', 'usec'));
+for my $command (@commands) {
+    my ($name, $code) = @$command;
+    ok (defined ($code->()), "Running $name succeeds");
+    note (sprintf ('%-10s %10.1f %10.1f', $name, measure ($code)));
+}
+
+# Compare the lookup and authorization of an object through Wallet::Query
+# with the same work done through DBIx::Class.
+my %lookup = (
+    query => sub {
+        my ($object, $data) = $server->load ('file', 'bench');
+        return $server->acl_verify ($object, 'show', $data);
+    },
+    dbic => sub {
+        my $object = $server->retrieve ('file', 'bench');
+        return $server->acl_verify ($object, 'show');
+    },
+);
+my %queries;
+note (sprintf ('%-10s %10s %10s', 'lookup', 'queries', 'usec'));
+for my $name (qw(dbic query)) {
+    is ($lookup{$name}->(), 1, "Authorization through $name succeeds");
+    my ($queries, $usec) = measure ($lookup{$name});
+    note (sprintf ('%-10s %10.1f %10.1f', $name, $queries, $usec));
+    $queries{$name} = $queries;
+}
+cmp_ok ($queries{query}, '<', $queries{dbic},
+        'Wallet::Query needs fewer statements');
+
+# Clean up.
+undef $server;
+$setup->destroy;
+END {
+    remove_tree ('test-files');
+    unlink 'wallet-db';
+}
@@ -0,0 +1,137 @@
+#!/usr/bin/perl
+#
+# Stress test of concurrent writes to a SQLite wallet database.
+#
+# Forks several processes that each connect to the same SQLite database in
+# WAL mode, as concurrent remctld children would, and that store and get
+# their own file objects, change the comment on a shared object, and add and
+# remove entries in a shared ACL as fast as they can, checking that none of
+# these writes fail with lock errors and that all of them are recorded.  This
+# is slow, so it is only run for package maintainers.  Set
+# WALLET_STRESS_CHILDREN and WALLET_STRESS_ITERATIONS to change the number of
+# processes and the number of times each runs through its writes.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use lib 't/lib';
+
+use Test::RRA qw(skip_unless_author);
+use Util;
+
+use File::Path qw(remove_tree);
+use POSIX qw(_exit);
+use Test::More;
+use Time::HiRes qw(time);
+
+use Wallet::Admin;
+use Wallet::Config;
+use Wallet::Server;
+
+# This test is slow, so only run it for package maintainers.
+skip_unless_author('SQLite stress test');
+
+# The concurrency settings are specific to SQLite.
+db_setup;
+if ($Wallet::Config::DB_DRIVER ne 'SQLite') {
+    plan skip_all => 'SQLite stress test requires SQLite';
+}
+$Wallet::Config::DB_SQLITE_JOURNAL_MODE = 'WAL';
+$Wallet::Config::DB_SQLITE_SYNCHRONOUS = 'NORMAL';
+$Wallet::Config::DB_SQLITE_BUSY_TIMEOUT = 5000;
+
+# Some global defaults to use.
+my $admin = 'admin@EXAMPLE.COM';
+my $host = 'localhost';
+my $children = $ENV{WALLET_STRESS_CHILDREN} || 8;
+my $iterations = $ENV{WALLET_STRESS_ITERATIONS} || 100;
+plan tests => 5 + $children;
+
+# Set up the database with a file object for each child, a shared object, and
+# a shared ACL.
+mkdir 'test-files' or die "cannot create test-files: $!\n";
+$Wallet::Config::FILE_BUCKET = 'test-files';
+my $setup = eval { Wallet::Admin->new };
+is ($@, '', 'Database connection succeeded');
+is ($setup->reinitialize ($admin), 1, 'Database initialization succeeded');
+my $server = Wallet::Server->new ($admin, $host);
+for my $child (1 .. $children) {
+    $server->create ('file', "stress-$child");
+}
+$server->create ('file', 'shared');
+$server->acl_create ('stress');
+my $mode = $setup->dbh->selectrow_array ('PRAGMA journal_mode');
+is (lc $mode, 'wal', 'Database is in WAL mode');
+undef $server;
+$setup->schema->storage->disconnect;
+undef $setup;
+
+# Do the writes for one child and return the number of failures, printing
+# each failure to standard error.
+sub writes {
+    my ($child) = @_;
+    my $server = Wallet::Server->new ($admin, $host);
+    my $failures = 0;
+    my $check = sub {
+        my ($result) = @_;
+        return if defined $result;
+        warn "child $child: ", $server->error, "\n";
+        $failures++;
+    };
+    for my $i (1 .. $iterations) {
+        my $member = "child$child-$i\@EXAMPLE.COM";
+        $check->($server->store ('file', "stress-$child", "data $i"));
+        $check->($server->get ('file', "stress-$child"));
+        $check->($server->comment ('file', 'shared', "child $child $i"));
+        $check->($server->acl_add ('stress', 'krb5', $member));
+        $check->($server->acl_remove ('stress', 'krb5', $member));
+    }
+    return $failures;
+}
+
+# Fork the children and wait for them.  Children exit without running END
+# blocks so that they don't remove the database.
+my $start = time;
+my %pids;
+for my $child (1 .. $children) {
+    my $pid = fork;
+    die "cannot fork: $!\n" unless defined $pid;
+    if ($pid == 0) {
+        my $failures = eval { writes ($child) };
+        warn "child $child: $@" if $@;
+        _exit ($@ ? 255 : ($failures > 254 ? 254 : $failures));
+    }
+    $pids{$pid} = $child;
+}
+my %status;
+while (%pids) {
+    my $pid = wait;
+    last if $pid < 0;
+    $status{ delete $pids{$pid} } = $? >> 8;
+}
+my $elapsed = time - $start;
+for my $child (1 .. $children) {
+    is ($status{$child}, 0, "Child $child had no failures");
+}
+my $writes = $children * $iterations * 5;
+note (sprintf ('%d writes in %.1fs, %.0f writes/s', $writes, $elapsed,
+               $writes / $elapsed));
+
+# Check that every write was recorded.
+$setup = Wallet::Admin->new;
+my $schema = $setup->schema;
+my %search = (oh_action => 'store', oh_name => { -like => 'stress-%' });
+is ($schema->resultset('ObjectHistory')->search (\%search)->count,
+    $children * $iterations, 'All stores were recorded');
+%search = (ah_action => [ 'add', 'remove' ]);
+is ($schema->resultset('AclHistory')->search (\%search)->count,
+    $children * $iterations * 2, 'All ACL changes were recorded');
+
+# Clean up.
+$setup->destroy;
+END {
+    remove_tree ('test-files');
+    unlink ('wallet-db', 'wallet-db-wal', 'wallet-db-shm');
+}
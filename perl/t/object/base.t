@@ -12,7 +12,7 @@ use strict;
 use warnings;
 
 use POSIX qw(strftime);
-use Test::More tests => 139;
+use Test::More tests => 156;
 
 use Wallet::ACL;
 use Wallet::Admin;
@@ -352,6 +352,49 @@ $date  create
 EOO
 is ($object->history, $output, ' and the history is correct');
 
+# History can be restricted to a range of time and a number of entries.
+my $later = $trace[2] + 60;
+is ($object->log_action ('get', $user, $host, $later), 1,
+    'Logging a later get succeeds');
+my $laterdate = strftime ('%Y-%m-%d %H:%M:%S', localtime $later);
+my $get = "$laterdate  get\n    by $user from $host\n";
+is ($object->history ({ since => $later }), $get,
+    ' and history since then shows only that get');
+is ($object->history ({ until => $later }), $output,
+    ' and history until then omits it');
+my ($first) = ($output =~ /\A(.*\n.*\n)/);
+is ($object->history ({ limit => 1 }), $first,
+    ' and history can be limited');
+is ($object->history ({ since => 'bogus' }), undef,
+    'Invalid history date fails');
+is ($object->error, "cannot read history for keytab:$princ: invalid since"
+    . ' date bogus', ' with the right error');
+
+# The object row and flags are loaded once and then kept with the object,
+# including the changes made through it.
+$object = eval { Wallet::Object::Base->new ('keytab', $princ, $schema) };
+is ($object->comment ('cached', @trace), 1, 'Setting a comment works');
+is ($object->flag_set ('locked', @trace), 1, ' as does setting a flag');
+my $dbh = $admin->dbh;
+$dbh->do ('DELETE FROM flags');
+$dbh->do ("UPDATE objects SET ob_comment = 'changed'");
+is ($object->flag_check ('locked'), 1, ' and the flag is cached');
+is ($object->comment, 'cached', ' as is the comment');
+$object = eval { Wallet::Object::Base->new ('keytab', $princ, $schema) };
+is ($object->flag_check ('locked'), 0, 'A new object sees the changes');
+is ($object->comment, 'changed', ' to both');
+
+# Invalid stored timestamps, such as the zero date MySQL may store, are
+# treated as unset rather than causing errors.
+$dbh->do ("UPDATE objects SET ob_expires = '0000-00-00 00:00:00'");
+$object = eval { Wallet::Object::Base->new ('keytab', $princ, $schema) };
+is ($object->expires, undef, 'An invalid expiration is not returned');
+unlike ($object->show, qr/^\s*Expires:/m, ' and is not shown');
+is ($object->error, undef, ' without an error');
+is ($object->expires ($now, @trace), 1, ' and setting expires works');
+like ($object->history, qr/  set expires to \Q$now\E\n[^\n]*\n\z/,
+      ' and logs the old value as unset');
+
 # Clean up.
 $admin->destroy;
 END {
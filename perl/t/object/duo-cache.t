@@ -0,0 +1,154 @@
+#!/usr/bin/perl
+#
+# Tests for the cache of Duo integration secret keys.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use File::Copy qw(copy);
+use File::Path qw(remove_tree);
+use Test::More;
+
+BEGIN {
+    eval 'use Net::Duo';
+    plan skip_all => 'Net::Duo required for testing duo'
+      if $@;
+    eval 'use Net::Duo::Mock::Agent';
+    plan skip_all => 'Net::Duo::Mock::Agent required for testing duo'
+      if $@;
+    eval 'use Crypt::AuthEnc::GCM';
+    plan skip_all => 'CryptX required for testing the Duo cache'
+      if $@;
+}
+
+BEGIN {
+    use_ok('Wallet::Admin');
+    use_ok('Wallet::Config');
+    use_ok('Wallet::Object::Duo');
+}
+
+use lib 't/lib';
+use Util;
+
+# Some global defaults to use.
+my $user = 'admin@EXAMPLE.COM';
+my $host = 'localhost';
+my @trace = ($user, $host, time);
+my $key = 'DIRWIH0ZZPV4G88B37VQ';
+my $secret = 'QO4ZLqQVRIOZYkHfdPDORfcNf8LeXIbCWwHazY7o';
+my $cache = "test-duo-cache/$key";
+
+# The expected output of get.
+my $expected = <<"EOO";
+Integration key: $key
+Secret key:      $secret
+Host:            example-admin.duosecurity.com
+EOO
+
+# Use Wallet::Admin to set up the database.
+db_setup;
+my $admin = eval { Wallet::Admin->new };
+is ($@, '', 'Database connection succeeded');
+is ($admin->reinitialize ($user), 1, 'Database initialization succeeded');
+my $schema = $admin->schema;
+
+# Set up the Duo configuration, using a copy of the key file so that its
+# modification time can be changed.  The mock agent fails any request that
+# it wasn't told to expect, so gets that use the cache must not call Duo.
+my $mock = Net::Duo::Mock::Agent->new ({ key_file => 't/data/duo/keys.json' });
+mkdir 'test-duo-cache' or die "cannot create test-duo-cache: $!\n";
+copy ('t/data/duo/keys.json', 'test-duo-keys.json')
+    or die "cannot copy t/data/duo/keys.json: $!\n";
+$Wallet::Config::DUO_AGENT     = $mock;
+$Wallet::Config::DUO_KEY_FILE  = 'test-duo-keys.json';
+$Wallet::Config::DUO_CACHE     = 'test-duo-cache';
+$Wallet::Config::DUO_CACHE_TTL = 3600;
+
+# Expect a request for the integration.
+sub expect_get {
+    $mock->expect (
+        {
+            method        => 'GET',
+            uri           => "/admin/v1/integrations/$key",
+            response_file => 't/data/duo/integration.json',
+        }
+    );
+}
+
+# Creating an integration caches its secret key, encrypted.
+$mock->expect (
+    {
+        method        => 'POST',
+        uri           => '/admin/v1/integrations',
+        content       => {
+            name  => 'test (unix)',
+            notes => 'Managed by wallet',
+            type  => 'unix',
+        },
+        response_file => 't/data/duo/integration.json',
+    }
+);
+my $object = Wallet::Object::Duo->create ('duo', 'test', $schema, @trace);
+isa_ok ($object, 'Wallet::Object::Duo');
+ok (-f $cache, 'Creating an integration caches its secret key');
+is ((stat $cache)[2] & 07777, 0600, '...with the right permissions');
+open (my $fh, '<', $cache) or die "cannot open $cache: $!\n";
+my $data = do { local $/; <$fh> };
+close $fh;
+unlike ($data, qr/\Q$secret\E/, '...and encrypted');
+
+# Gets use the cache without calling Duo.
+$object = Wallet::Object::Duo->new ('duo', 'test', $schema);
+is (eval { $object->get (@trace) }, $expected, 'Get uses the cache');
+is ($@, '', '...without calling Duo');
+is (eval { $object->get (@trace) }, $expected, '...and again');
+
+# An expired cache entry is retrieved from Duo again and recached.
+$Wallet::Config::DUO_CACHE_TTL = 0;
+expect_get;
+is ($object->get (@trace), $expected, 'Get with an expired cache works');
+$Wallet::Config::DUO_CACHE_TTL = 3600;
+is (eval { $object->get (@trace) }, $expected, '...and refreshes the cache');
+
+# A damaged cache file is ignored and replaced.
+open ($fh, '+<', $cache) or die "cannot open $cache: $!\n";
+binmode $fh;
+seek ($fh, 20, 0);
+print {$fh} 'x';
+close $fh;
+expect_get;
+is ($object->get (@trace), $expected, 'Get with a damaged cache works');
+is (eval { $object->get (@trace) }, $expected, '...and fixes the cache');
+
+# A cache file for another integration is rejected.
+is (Wallet::Object::Duo::_cache_read ('DIOTHER'), undef,
+    'Missing cache entries are not found');
+rename ($cache, 'test-duo-cache/DIOTHER') or die "cannot rename: $!\n";
+is (Wallet::Object::Duo::_cache_read ('DIOTHER'), undef,
+    '...nor are cache entries for another integration');
+rename ('test-duo-cache/DIOTHER', $cache) or die "cannot rename: $!\n";
+
+# The key file is only parsed again if it changes.
+my $config = Wallet::Object::Duo::_key_file ();
+is (Wallet::Object::Duo::_key_file (), $config, 'The key file is memoized');
+utime (time + 10, time + 10, 'test-duo-keys.json');
+isnt (Wallet::Object::Duo::_key_file (), $config,
+      '...but read again if it changes');
+
+# Destroying the integration removes it from the cache.  Destroy itself can't
+# be fully tested since Net::Duo::Mock::Agent can't expect two calls.
+expect_get;
+$object->destroy (@trace);
+ok (!-f $cache, 'Destroying an integration removes it from the cache');
+
+# Clean up.
+$admin->destroy;
+END {
+    remove_tree ('test-duo-cache');
+    unlink ('test-duo-keys.json', 'wallet-db');
+}
+
+# Done testing.
+done_testing ();
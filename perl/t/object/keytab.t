@@ -569,9 +569,9 @@ EOO
 
     # Create a synchronization manually so that we can test the display and
     # removal code.
-    my $sql = "insert into keytab_sync (ks_name, ks_target) values
-        ('wallet/one', 'kaserver')";
-    $dbh->do ($sql);
+    my $sql = "insert into keytab_sync (ks_object, ks_target) values
+        (?, 'kaserver')";
+    $dbh->do ($sql, undef, $one->id);
     @targets = $one->attr ('sync');
     is (scalar (@targets), 1, ' and now one target is set');
     is ($targets[0], 'kaserver', ' and it is correct');
@@ -16,7 +16,7 @@ use 5.008;
 use strict;
 use warnings;
 
-use Test::More tests => 130;
+use Test::More tests => 136;
 
 use lib 't/lib';
 use Util;
@@ -25,7 +25,7 @@ use Util;
 BEGIN {
     use_ok('Wallet::Admin');
     use_ok('Wallet::Policy::Stanford',
-           qw(default_owner verify_name is_for_host));
+           qw(default_owner verify_name is_for_host object_host));
     use_ok('Wallet::Server');
 }
 
@@ -130,6 +130,16 @@ for my $name (@VALID_FILES) {
     }
 }
 
+# Check the host mapping used to record the host of each object.
+is(object_host('keytab', 'host/example.stanford.edu'), 'example.stanford.edu',
+   'Host of a host-based keytab');
+is(object_host('keytab', 'service/example'), undef,
+   'No host for a service keytab');
+is(object_host('file', 'ssl-key/example.stanford.edu/mysql'),
+   'example.stanford.edu', 'Host of a host-based file');
+is(object_host('file', 'config/its-idg/example/foo'), undef,
+   'No host for a group file');
+
 # Now we need an actual database.  Use Wallet::Admin to set it up.  These
 # remaining tests require creating NetDB ACLs, so need a Stanford Kerberos
 # principal currently.
@@ -221,6 +231,22 @@ SKIP: {
         '...and when netdb-root ACL already exists'
     );
 
+    # The schema and policy cache are used if the server passes them, and
+    # the ACL lookup is remembered in the cache.
+    my %cache;
+    is_deeply(
+        [default_owner('keytab', 'webauth/foo.stanford.edu',
+                       $server->schema, \%cache)],
+        [
+            'host/foo.stanford.edu',
+            ['netdb-root', 'foo.stanford.edu'],
+            ['krb5', 'host/foo.stanford.edu@stanford.edu']
+        ],
+        '...and with the schema and policy cache'
+    );
+    is(scalar(@{ $cache{acl_members}{'host/foo.stanford.edu'} }), 2,
+       '...which remembers the ACL members');
+
     # Now with a root instance.
     local $ENV{REMOTE_USER} = 'admin/root@stanford.edu';
     is_deeply(
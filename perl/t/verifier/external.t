@@ -9,7 +9,7 @@
 use strict;
 use warnings;
 
-use Test::More tests => 9;
+use Test::More tests => 25;
 
 use Wallet::ACL::External;
 use Wallet::Config;
@@ -32,3 +32,43 @@ is ($verifier->error, 'some error', ' and right error');
 is ($verifier->check (undef, 'eagle@eyrie.org', 'file', 'test'), undef,
     'Undefined principal');
 is ($verifier->error, 'no principal specified', ' and right error');
+
+# Switch to a persistent helper and check the same verifications.
+$Wallet::Config::EXTERNAL_COMMAND    = 't/data/acl-persistent';
+$Wallet::Config::EXTERNAL_PERSISTENT = 1;
+$Wallet::Config::EXTERNAL_TIMEOUT    = 1;
+$verifier = Wallet::ACL::External->new;
+ok (defined $verifier, 'Persistent Wallet::ACL::External creation');
+is ($verifier->check ('eagle@eyrie.org', 'test success', 'file', 'test'),
+    1, 'Success');
+my $pid = $verifier->{helper}{pid};
+is ($verifier->check ('eagle@eyrie.org', 'test failure', 'file', 'test'),
+    0, 'Failure');
+is ($verifier->{helper}{pid}, $pid, ' and the helper was reused');
+is ($verifier->check ('eagle@eyrie.org', 'test error', 'file', 'test'),
+    undef, 'Error');
+is ($verifier->error, 'some error', ' and right error');
+
+# A helper that exits is restarted, and one that hangs times out.
+is ($verifier->check ('eagle@eyrie.org', 'test crash', 'file', 'test'),
+    undef, 'Crash');
+is ($verifier->error, 'external ACL command t/data/acl-persistent exited',
+    ' and right error');
+is ($verifier->check ('eagle@eyrie.org', 'test success', 'file', 'test'),
+    1, ' and the helper is restarted');
+isnt ($verifier->{helper}{pid}, $pid, ' as a new process');
+is ($verifier->check ('eagle@eyrie.org', 'test hang', 'file', 'test'),
+    undef, 'Hang');
+is ($verifier->error, 'external ACL command t/data/acl-persistent timed out',
+    ' and right error');
+is ($verifier->check ('eagle@eyrie.org', 'test success', 'file', 'test'),
+    1, ' and the helper is restarted');
+
+# A helper that ignores SIGTERM is killed once it has had EXTERNAL_TIMEOUT
+# seconds to exit.
+$pid = $verifier->{helper}{pid};
+my $start = time;
+is ($verifier->check ('eagle@eyrie.org', 'test stubborn', 'file', 'test'),
+    undef, 'Hang ignoring SIGTERM');
+ok (time - $start < 5, ' and the helper is stopped promptly');
+ok (!kill (0, $pid), ' by killing it');
@@ -0,0 +1,196 @@
+#!/usr/bin/perl
+#
+# Tests for the LDAP attribute ACL verifier against a local stand-in for the
+# LDAP server.
+#
+# These tests check the search filters and reconnection behavior of the LDAP
+# attribute verifier without requiring access to a real directory server.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use Test::More;
+
+BEGIN {
+    eval 'use Net::LDAP 0.27 ()';
+    plan skip_all => 'Net::LDAP required for testing ldap-attr'
+        if $@;
+    eval 'use Authen::SASL ()';
+    plan skip_all => 'Authen::SASL required for testing ldap-attr'
+        if $@;
+}
+
+use Net::LDAP::Constant qw(LDAP_SERVER_DOWN LDAP_SUCCESS);
+use Wallet::Config;
+
+# A stand-in for a search result.  Holds a result code and a count.
+package Test::LDAP::Result;
+
+sub new {
+    my ($class, $code, $count) = @_;
+    return bless ({ code => $code, count => $count }, $class);
+}
+sub code  { return $_[0]{code} }
+sub count { return $_[0]{count} }
+sub error { return $_[0]{code} ? 'server down' : 'success' }
+
+# A stand-in for a Net::LDAP connection.  It knows about one entry, with a
+# principal and a set of attribute values, and records the filters that it
+# was asked about.  It can be told to act like a dropped connection or to
+# fail to bind.
+package Test::LDAP;
+
+our (@FILTERS, $DOWN, $BIND_CODE);
+
+sub new {
+    my ($class) = @_;
+    return bless ({}, $class);
+}
+
+sub bind {
+    my ($self) = @_;
+    return Test::LDAP::Result->new ($BIND_CODE || main::LDAP_SUCCESS (), 0);
+}
+
+sub search {
+    my ($self, %options) = @_;
+    push (@FILTERS, $options{filter});
+    if ($DOWN) {
+        $DOWN--;
+        return Test::LDAP::Result->new (main::LDAP_SERVER_DOWN (), 0);
+    }
+    my $filter = $options{filter};
+    my $count = 0;
+    if ($filter =~ /^\(&\(uid=alice\)/) {
+        my @wanted = ($filter =~ /\((\w+=[^()]*)\)/g);
+        shift @wanted;
+        for my $wanted (@wanted) {
+            $count = 1 if $wanted eq 'eduPersonEntitlement=wallet';
+        }
+    }
+    return Test::LDAP::Result->new (main::LDAP_SUCCESS (), $count);
+}
+
+# Subclasses of the verifiers that use the stand-in connection and count how
+# many times they connected.
+package Test::Verifier;
+
+our $CONNECTS = 0;
+our @ISA = qw(Wallet::ACL::LDAP::Attribute);
+
+sub ldap_connect {
+    my ($self) = @_;
+    $CONNECTS++;
+    $self->{ldap} = Test::LDAP->new;
+    return 1;
+}
+
+package Test::Verifier::Root;
+
+our @ISA = qw(Wallet::ACL::LDAP::Attribute::Root);
+
+sub ldap_connect { return Test::Verifier::ldap_connect (@_) }
+
+package main;
+
+plan tests => 29;
+
+require_ok ('Wallet::ACL::LDAP::Attribute');
+require_ok ('Wallet::ACL::LDAP::Attribute::Root');
+
+# Set up our configuration.
+$Wallet::Config::LDAP_HOST        = 'localhost';
+$Wallet::Config::LDAP_BASE        = 'cn=people,dc=example,dc=com';
+$Wallet::Config::LDAP_FILTER_ATTR = 'uid';
+$Wallet::Config::LDAP_CACHE       = '/nonexistent';
+
+# Remove the realm from principal names.
+package Wallet::Config;
+sub ldap_map_principal {
+    my ($principal) = @_;
+    $principal =~ s/\@.*//;
+    return $principal;
+}
+package main;
+
+# A single check is done with one search combining both filters.
+my $verifier = Test::Verifier->new;
+isa_ok ($verifier, 'Wallet::ACL::LDAP::Attribute');
+is ($Test::Verifier::CONNECTS, 1, 'Connected once');
+is ($verifier->check ('alice@EXAMPLE.COM', 'eduPersonEntitlement=wallet'),
+    1, 'Checking matching attribute succeeds');
+is ($verifier->error, undef, '...with no error');
+is_deeply (\@Test::LDAP::FILTERS,
+           [ '(&(uid=alice)(eduPersonEntitlement=wallet))' ],
+           '...with a single combined search');
+is ($verifier->check ('alice@EXAMPLE.COM', 'eduPersonEntitlement=BOGUS'),
+    0, 'Checking non-matching attribute fails');
+is ($verifier->error, undef, '...with no error');
+is ($verifier->check ('alice@EXAMPLE.COM', 'eduPersonEntitlement'), undef,
+    'Checking malformed ACL fails');
+is ($verifier->error, 'malformed ldap-attr ACL', '...with correct error');
+
+# Several ACLs are checked with a single OR filter.
+@Test::LDAP::FILTERS = ();
+my @acls = ('eduPersonEntitlement=other', 'eduPersonEntitlement=wallet');
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@acls), 1,
+    'Checking multiple attributes succeeds');
+is_deeply (\@Test::LDAP::FILTERS,
+           [ '(&(uid=alice)(|(eduPersonEntitlement=other)'
+             . '(eduPersonEntitlement=wallet)))' ],
+           '...with a single OR search');
+@acls = ('eduPersonEntitlement', 'eduPersonEntitlement=wallet');
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@acls), 1,
+    'Malformed ACL ignored if another ACL matches');
+
+# Special characters in the principal and value are escaped.
+@Test::LDAP::FILTERS = ();
+is ($verifier->check ('a*)(uid=*@EXAMPLE.COM', 'cn=wallet*'), 0,
+    'Checking principal with filter characters fails');
+is ($Test::LDAP::FILTERS[0], '(&(uid=a\2a\29\28uid=\2a)(cn=wallet\2a))',
+    '...with special characters escaped');
+
+# If the server drops the connection, we reconnect and retry.
+$Test::LDAP::DOWN = 1;
+is ($verifier->check ('alice@EXAMPLE.COM', 'eduPersonEntitlement=wallet'),
+    1, 'Checking after dropped connection succeeds');
+is ($Test::Verifier::CONNECTS, 2, '...after reconnecting');
+$Test::LDAP::DOWN = 2;
+is ($verifier->check ('alice@EXAMPLE.COM', 'eduPersonEntitlement=wallet'),
+    undef, 'Checking fails if reconnecting does not help');
+is ($verifier->error, 'cannot search for alice in LDAP: server down',
+    '...with correct error');
+
+# The root verifier strips /root before checking.
+$verifier = Test::Verifier::Root->new;
+@acls = ('eduPersonEntitlement=wallet');
+is ($verifier->check_multiple ('alice/root@EXAMPLE.COM', \@acls), 1,
+    'Checking root instance succeeds');
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@acls), 0,
+    '...and non-root instance fails');
+is ($verifier->check ('alice/root@EXAMPLE.COM', 'eduPersonEntitlement=wallet'),
+    1, 'Checking root instance with check succeeds');
+is ($verifier->check ('alice@EXAMPLE.COM', 'eduPersonEntitlement=wallet'),
+    0, '...and non-root instance fails');
+
+# Attribute names that aren't plain words are rejected rather than put in
+# the filter.
+$verifier = Test::Verifier->new;
+@Test::LDAP::FILTERS = ();
+is ($verifier->check ('alice@EXAMPLE.COM', 'uid)(objectClass=*'), undef,
+    'Checking attribute with filter characters fails');
+is ($verifier->error, 'malformed ldap-attr ACL', '...as malformed');
+is (scalar (@Test::LDAP::FILTERS), 0, '...without searching');
+
+# A failed bind is reported when creating the verifier.
+{
+    no warnings 'redefine';
+    local *Net::LDAP::new = sub { return Test::LDAP->new };
+    local $Test::LDAP::BIND_CODE = LDAP_SERVER_DOWN;
+    $verifier = eval { Wallet::ACL::LDAP::Attribute->new };
+    is ($verifier, undef, 'Creating verifier with a failed bind fails');
+    is ($@, "LDAP attribute ACL support not available: server down\n",
+        '...with correct error');
+}
@@ -0,0 +1,193 @@
+#!/usr/bin/perl
+#
+# Tests for the NetDB wallet ACL verifiers against a fake NetDB backend.
+#
+# These tests check role caching and batched lookups by replacing
+# Net::Remctl with a stand-in that answers netdb commands from a fixed table
+# of roles, so they don't require access to a NetDB server.
+#
+# SPDX-License-Identifier: MIT
+
+use strict;
+use warnings;
+
+use Test::More tests => 33;
+
+# A stand-in for a remctl output token.
+package Test::Remctl::Output;
+
+sub new {
+    my ($class, %token) = @_;
+    return bless ({ %token }, $class);
+}
+sub type   { return $_[0]{type} }
+sub stream { return $_[0]{stream} }
+sub data   { return $_[0]{data} }
+sub status { return $_[0]{status} }
+
+# A stand-in for Net::Remctl that implements netdb node-roles and a batched
+# netdb node-roles-batch from %ROLES and records the commands it was sent.
+package Net::Remctl;
+
+our (%ROLES, @COMMANDS);
+
+sub new {
+    my ($class) = @_;
+    return bless ({ output => [] }, $class);
+}
+sub open  { return 1 }
+sub error { return 'fake error' }
+
+sub command {
+    my ($self, $command, $subcommand, $principal, @nodes) = @_;
+    push (@COMMANDS, join (' ', $command, $subcommand, $principal, @nodes));
+    my @output;
+    if ($principal eq 'broken') {
+        push (@output, { type => 'output', stream => 2, data => "no user\n" });
+        push (@output, { type => 'status', status => 1 });
+    } elsif ($subcommand eq 'node-roles' and $nodes[0] eq 'gone.example.com') {
+        push (@output, { type => 'output', stream => 2, data => "no node\n" });
+        push (@output, { type => 'status', status => 1 });
+    } elsif ($subcommand eq 'node-roles') {
+        my $roles = $ROLES{$principal}{$nodes[0]} || [];
+        my $data = join (' ', @$roles) . "\n";
+        push (@output, { type => 'output', stream => 1, data => $data });
+        push (@output, { type => 'status', status => 0 });
+    } elsif ($subcommand eq 'node-roles-batch') {
+        for my $node (@nodes) {
+            my $roles = $ROLES{$principal}{$node} || [];
+            my $data = join (' ', $node, @$roles) . "\n";
+            push (@output, { type => 'output', stream => 1, data => $data });
+        }
+        push (@output, { type => 'status', status => 0 });
+    } else {
+        return;
+    }
+    $self->{output} = [ map { Test::Remctl::Output->new (%$_) } @output ];
+    return 1;
+}
+
+sub output {
+    my ($self) = @_;
+    return shift @{ $self->{output} };
+}
+
+package main;
+
+$INC{'Net/Remctl.pm'} = __FILE__;
+
+use Wallet::ACL::NetDB;
+use Wallet::ACL::NetDB::Root;
+use Wallet::Config;
+
+# The roles known to our fake NetDB.
+%Net::Remctl::ROLES = (
+    alice => {
+        'one.example.com'   => [ 'user' ],
+        'two.example.com'   => [ 'admin', 'team' ],
+        'three.example.com' => [ 'other' ],
+    },
+);
+
+# Set up our configuration.
+$Wallet::Config::NETDB_REALM        = 'EXAMPLE.COM';
+$Wallet::Config::NETDB_REMCTL_CACHE = '/nonexistent';
+$Wallet::Config::NETDB_REMCTL_HOST  = 'netdb.example.com';
+
+# Check individual nodes.
+my $verifier = eval { Wallet::ACL::NetDB->new };
+is ($@, q{}, 'Creating verifier succeeds');
+isa_ok ($verifier, 'Wallet::ACL::NetDB');
+is ($verifier->check ('alice@EXAMPLE.COM', 'one.example.com'), 1,
+    'Checking user role succeeds');
+is ($verifier->check ('alice@EXAMPLE.COM', 'three.example.com'), 0,
+    'Checking other role fails');
+is ($verifier->check ('alice@EXAMPLE.COM', 'four.example.com'), 0,
+    'Checking node with no roles fails');
+is ($verifier->check ('alice@EXAMPLE.COM', ''), undef,
+    'Checking empty ACL fails');
+is ($verifier->error, 'malformed netdb ACL', '...with correct error');
+is ($verifier->check ('broken@EXAMPLE.COM', 'one.example.com'), undef,
+    'Checking when NetDB fails fails');
+is ($verifier->error, 'error checking NetDB ACL: no user',
+    '...with correct error');
+is (scalar (@Net::Remctl::COMMANDS), 4, 'Four remctl commands were sent');
+is ($Net::Remctl::COMMANDS[0], 'netdb node-roles alice one.example.com',
+    '...with the right arguments');
+
+# Repeated checks use the cache.
+@Net::Remctl::COMMANDS = ();
+is ($verifier->check ('alice@EXAMPLE.COM', 'one.example.com'), 1,
+    'Checking user role again succeeds');
+is ($verifier->check ('alice@EXAMPLE.COM', 'three.example.com'), 0,
+    'Checking other role again fails');
+is (scalar (@Net::Remctl::COMMANDS), 0, '...without any remctl commands');
+
+# The cache expires after the TTL.
+for my $node (values %{ $verifier->{cache}{alice} }) {
+    $node->[0] -= $Wallet::Config::NETDB_CACHE_TTL;
+}
+is ($verifier->check ('alice@EXAMPLE.COM', 'one.example.com'), 1,
+    'Checking user role after cache expires succeeds');
+is (scalar (@Net::Remctl::COMMANDS), 1, '...with a new remctl command');
+
+# Caching can be disabled.
+$Wallet::Config::NETDB_CACHE_TTL = 0;
+$verifier = Wallet::ACL::NetDB->new;
+@Net::Remctl::COMMANDS = ();
+$verifier->check ('alice@EXAMPLE.COM', 'one.example.com');
+$verifier->check ('alice@EXAMPLE.COM', 'one.example.com');
+is (scalar (@Net::Remctl::COMMANDS), 2, 'Disabling the cache works');
+$Wallet::Config::NETDB_CACHE_TTL = 60;
+
+# Without batching, check_multiple looks up each node.
+my @nodes = ('three.example.com', 'four.example.com', 'two.example.com');
+@Net::Remctl::COMMANDS = ();
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@nodes), 1,
+    'Checking multiple nodes succeeds');
+is (scalar (@Net::Remctl::COMMANDS), 3, '...with one command per node');
+
+# A node whose lookup fails doesn't stop the rest from being checked, but is
+# reported as an error if nothing else grants access.
+my @stale = ('gone.example.com', 'one.example.com');
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@stale), 1,
+    'A failed lookup does not stop later nodes granting access');
+@stale = ('gone.example.com', 'three.example.com');
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@stale), undef,
+    '...but is an error if no node grants access');
+is ($verifier->error, 'error checking NetDB ACL: no node',
+    '...with correct error');
+ok (!exists $verifier->{cache}{alice}{'gone.example.com'},
+    '...and the failure is not cached');
+
+# With batching, check_multiple uses a single remctl call.
+$Wallet::Config::NETDB_REMCTL_BATCH = 'node-roles-batch';
+$verifier = Wallet::ACL::NetDB->new;
+@Net::Remctl::COMMANDS = ();
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@nodes), 1,
+    'Checking multiple nodes with batching succeeds');
+is_deeply (\@Net::Remctl::COMMANDS,
+           [ 'netdb node-roles-batch alice ' . join (' ', @nodes) ],
+           '...with a single remctl command');
+is_deeply ($verifier->roles ('alice', @nodes),
+           { 'three.example.com' => [ 'other' ],
+             'four.example.com'  => [],
+             'two.example.com'   => [ 'admin', 'team' ] },
+           'Roles are returned for each node');
+is (scalar (@Net::Remctl::COMMANDS), 1, '...from the cache');
+@nodes = ('three.example.com', '', 'four.example.com');
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@nodes), undef,
+    'Checking multiple nodes with a malformed ACL fails');
+is ($verifier->error, 'malformed netdb ACL', '...with correct error');
+
+# The root verifier strips /root before checking.
+$verifier = Wallet::ACL::NetDB::Root->new;
+@nodes = ('one.example.com');
+is ($verifier->check_multiple ('alice/root@EXAMPLE.COM', \@nodes), 1,
+    'Checking root instance succeeds');
+is ($verifier->check_multiple ('alice@EXAMPLE.COM', \@nodes), 0,
+    '...and non-root instance fails');
+is ($verifier->check ('alice/root@EXAMPLE.COM', 'one.example.com'), 1,
+    'Checking root instance with check succeeds');
+is ($verifier->check ('alice@EXAMPLE.COM', 'one.example.com'), 0,
+    '...and non-root instance fails');